@@ -0,0 +1,124 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "CCDBenchmark.h"
+#include "ManagerPhysics.h"
+#include "ManagerSceneCommands.h"
+#include "extensions/PxRaycastCCD.h"
+
+using namespace Aftr;
+using namespace physx;
+
+namespace {
+	// Step rates tried, shortest step first
+	const float STEP_HZ[] = { 240, 120, 90, 60, 45, 30, 20, 15, 10 };
+	const float SIMULATED_S = 15; // Long enough for the highest cube to land and settle
+	// About as thin as the ground gets, triangle meshes and heightfields have no thickness at all
+	const float SLAB_HALF_THICKNESS = 0.05f;
+
+	struct Trial {
+		size_t fell_through = 0;
+		size_t unsettled = 0; // Above the slab but not lying on it
+		double ms_per_simulated_s = 0;
+	};
+
+	Trial drop(CCDMode mode, float speed, float step_s, size_t cubes, PxCpuDispatcher* dispatcher) {
+		PxPhysics* physics = ManagerPhysics::gPhysics;
+		PxSceneDesc desc(physics->getTolerancesScale());
+		desc.gravity = ManagerPhysics::scene->getGravity();
+		desc.cpuDispatcher = dispatcher;
+		desc.filterShader = ManagerPhysics::filterShader;
+		desc.flags |= PxSceneFlag::eENABLE_CCD;
+		PxScene* scene = physics->createScene(desc);
+		RaycastCCDManager* raycast = mode == CCDMode::Raycast ? new RaycastCCDManager(scene) : nullptr;
+
+		// Same boxes as the drop zone spawns, far enough apart that they never meet
+		SceneSpawn cube;
+		PxVec3 half_extents(cube.half_extents.x, cube.half_extents.y, cube.half_extents.z);
+		PxMaterial* material = physics->createMaterial(0.5f, 0.3f, 0.2f);
+		size_t side = (size_t)std::ceil(std::sqrt((double)cubes));
+		float spacing = 4 * half_extents.maxElement();
+		float half_width = side * spacing / 2 + 20;
+		PxRigidStatic* slab = PxCreateStatic(*physics, PxTransform(PxVec3(0, 0, -SLAB_HALF_THICKNESS)),
+			PxBoxGeometry(half_width, half_width, SLAB_HALF_THICKNESS), *material);
+		scene->addActor(*slab);
+		std::vector<PxRigidDynamic*> bodies;
+		for (size_t i = 0; i < cubes; i++) {
+			// Spread over the heights the drop zone reaches, some already falling fast
+			PxVec3 at((i % side) * spacing - side * spacing / 2, (i / side) * spacing - side * spacing / 2, 100 + 300.0f * i / cubes);
+			PxRigidDynamic* body = PxCreateDynamic(*physics, PxTransform(at), PxBoxGeometry(half_extents), *material, cube.density);
+			body->setLinearVelocity(PxVec3(0, 0, -20.0f * (i % 3)));
+			scene->addActor(*body);
+			if (raycast != nullptr) {
+				PxShape* shape = nullptr;
+				body->getShapes(&shape, 1);
+				raycast->registerRaycastCCDObject(body, shape);
+			}
+			else if (mode != CCDMode::None) {
+				ManagerPhysics::classifyCCD(body, mode, speed);
+			}
+			bodies.push_back(body);
+		}
+
+		Trial trial;
+		unsigned int steps = (unsigned int)std::ceil(SIMULATED_S / step_s);
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < steps; i++) {
+			scene->simulate(step_s);
+			scene->fetchResults(true);
+			if (raycast != nullptr) {
+				raycast->doRaycastCCD(true);
+			}
+			else if (mode != CCDMode::None && speed > 0) {
+				for (PxRigidDynamic* body : bodies)
+					ManagerPhysics::classifyCCD(body, mode, speed);
+			}
+		}
+		trial.ms_per_simulated_s = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / (steps * step_s);
+
+		// Lying on the slab puts the center one half extent up, whichever face it landed on
+		for (PxRigidDynamic* body : bodies) {
+			PxVec3 p = body->getGlobalPose().p;
+			if (p.z < 0)
+				trial.fell_through++;
+			else if (std::fabs(p.z - half_extents.z) > 0.25f || body->getLinearVelocity().magnitude() > 0.5f)
+				trial.unsettled++;
+		}
+
+		delete raycast;
+		for (PxRigidDynamic* body : bodies)
+			body->release();
+		slab->release();
+		scene->release();
+		material->release();
+		return trial;
+	}
+}
+
+void CCDBenchmark::run(size_t cubes) {
+	PxDefaultCpuDispatcher* dispatcher = PxDefaultCpuDispatcherCreate(1); // One thread, like the main scene
+	float speed = ManagerPhysics::getCCDSpeed();
+	std::cout << "CCD benchmark, " << cubes << " cubes dropped from 100 to 400 high, " << SIMULATED_S << " s each, velocity class above "
+		<< speed << std::endl;
+	for (CCDMode mode : { CCDMode::None, CCDMode::Speculative, CCDMode::Sweep, CCDMode::Raycast }) {
+		float largest_hz = 0;
+		Trial stable;
+		for (float hz : STEP_HZ) {
+			Trial trial = drop(mode, speed, 1.0f / hz, cubes, dispatcher);
+			if (trial.fell_through > 0 || trial.unsettled > 0) {
+				std::cout << "  " << ManagerPhysics::toString(mode) << " fails at " << 1000.0f / hz << " ms, " << trial.fell_through
+					<< " fell through and " << trial.unsettled << " didn't settle" << std::endl;
+				break;
+			}
+			largest_hz = hz;
+			stable = trial;
+		}
+		if (largest_hz == 0)
+			std::cout << "  " << ManagerPhysics::toString(mode) << " largest stable step = none" << std::endl;
+		else
+			std::cout << "  " << ManagerPhysics::toString(mode) << " largest stable step = " << 1000.0f / largest_hz << " ms steps/s = "
+				<< largest_hz << " ms per simulated second = " << stable.ms_per_simulated_s << std::endl;
+	}
+	dispatcher->release();
+}
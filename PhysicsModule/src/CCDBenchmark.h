@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Aftr
+{
+	// Finds the largest fixed step each CCD mode can take before fast drops start going through the ground
+	class CCDBenchmark {
+		public:
+			// Drops this many cubes from drop zone heights onto a thin slab in a private scene, once per mode and step
+			// length. A step passes if every cube comes to rest lying on the slab. Prints the largest passing step per
+			// mode, the steps per second it needs and what a simulated second costs
+			static void run(size_t cubes);
+	};
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "CharacterBenchmark.h"
+#include "ManagerCharacter.h"
+#include "ManagerPhysics.h"
+#include "ManagerSceneCommands.h"
+
+using namespace Aftr;
+using namespace physx;
+
+namespace {
+	const size_t PILE_CUBES[] = { 0, 500, 2000, 8000 };
+	const unsigned int PILE_LAYERS = 4;
+	const float FRAME_S = 1.0f / 60;
+	const float SPEED = 8; // About how fast the camera flies
+	const float HEIGHT = 1.5f; // Capsule center, inside the pile's bottom layer
+
+	// Average microseconds per move. At a volume growth of 1 the cache only covers the move itself, so every move
+	// queries the scene again
+	double circle(size_t cubes, float volume_growth, size_t frames, PxCpuDispatcher* dispatcher) {
+		PxPhysics* physics = ManagerPhysics::gPhysics;
+		PxSceneDesc scene_desc(physics->getTolerancesScale());
+		scene_desc.gravity = ManagerPhysics::scene->getGravity();
+		scene_desc.cpuDispatcher = dispatcher;
+		scene_desc.filterShader = ManagerPhysics::filterShader;
+		scene_desc.staticKineFilteringMode = PxPairFilteringMode::eKEEP;
+		PxScene* scene = physics->createScene(scene_desc);
+		PxMaterial* material = physics->createMaterial(0.5f, 0.3f, 0.2f);
+		PxRigidStatic* ground = PxCreatePlane(*physics, PxPlane(0, 0, 1, 0), *material);
+		scene->addActor(*ground);
+
+		// Same boxes as the drop zone spawns, stacked touching and asleep like a pile that has settled
+		SceneSpawn cube;
+		PxVec3 half_extents(cube.half_extents.x, cube.half_extents.y, cube.half_extents.z);
+		size_t side = (size_t)std::ceil(std::sqrt((double)cubes / PILE_LAYERS));
+		std::vector<PxRigidDynamic*> bodies;
+		for (size_t i = 0; i < cubes; i++) {
+			size_t layer = i / (side * side);
+			size_t slot = i % (side * side);
+			PxVec3 at(((slot % side) + 0.5f - side / 2.0f) * 2 * half_extents.x, ((slot / side) + 0.5f - side / 2.0f) * 2 * half_extents.y,
+				(2 * layer + 1) * half_extents.z);
+			PxRigidDynamic* body = PxCreateDynamic(*physics, PxTransform(at), PxBoxGeometry(half_extents), *material, cube.density);
+			scene->addActor(*body);
+			body->putToSleep();
+			bodies.push_back(body);
+		}
+
+		// Round through the pile, and box obstacles instead of walls in the scene around it
+		float radius = std::max(10.0f, 0.75f * side * half_extents.x);
+		PxControllerManager* manager = PxCreateControllerManager(*scene);
+		manager->setPreciseSweeps(false);
+		PxObstacleContext* obstacles = manager->createObstacleContext();
+		for (int i = 0; i < 4; i++) {
+			PxBoxObstacle wall;
+			PxVec3 normal(i == 0 ? 1.0f : i == 1 ? -1.0f : 0.0f, i == 2 ? 1.0f : i == 3 ? -1.0f : 0.0f, 0);
+			wall.mPos = PxExtendedVec3(normal.x * (radius + 10), normal.y * (radius + 10), 5);
+			wall.mHalfExtents = PxVec3(normal.x != 0 ? 1 : radius + 10, normal.y != 0 ? 1 : radius + 10, 5);
+			obstacles->addObstacle(wall);
+		}
+		CharacterPushReport report;
+		PxCapsuleControllerDesc desc = ManagerCharacter::describe(0.5f, 1.0f, material);
+		desc.position = PxExtendedVec3(radius, 0, HEIGHT);
+		desc.volumeGrowth = volume_growth;
+		desc.reportCallback = &report;
+		PxController* controller = manager->createController(desc);
+
+		report.move_s = FRAME_S;
+		double total_us = 0;
+		for (size_t frame = 1; frame <= frames; frame++) {
+			float angle = SPEED * FRAME_S * frame / radius;
+			PxVec3 target(radius * std::cos(angle), radius * std::sin(angle), HEIGHT);
+			PxVec3 displacement = target - toVec3(controller->getPosition());
+			auto start = std::chrono::steady_clock::now();
+			controller->move(displacement, 0.001f, FRAME_S, PxControllerFilters(), obstacles);
+			total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			scene->simulate(FRAME_S);
+			scene->fetchResults(true);
+		}
+
+		manager->release();
+		for (PxRigidDynamic* body : bodies)
+			body->release();
+		ground->release();
+		scene->release();
+		material->release();
+		return frames > 0 ? total_us / frames : 0;
+	}
+}
+
+void CharacterBenchmark::run(size_t frames) {
+	PxDefaultCpuDispatcher* dispatcher = PxDefaultCpuDispatcherCreate(1); // One thread, like the main scene
+	std::cout << "Character benchmark, " << frames << " moves at " << SPEED << " m/s through piles " << PILE_LAYERS << " cubes high" << std::endl;
+	for (size_t cubes : PILE_CUBES) {
+		double cached = circle(cubes, 1.5f, frames, dispatcher);
+		double uncached = circle(cubes, 1.0f, frames, dispatcher);
+		std::cout << "  " << cubes << " cubes: " << cached << " us per move cached, " << uncached << " us uncached" << std::endl;
+	}
+	dispatcher->release();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Aftr
+{
+	// Measures what one camera controller move costs next to cube piles of growing size
+	class CharacterBenchmark {
+		public:
+			// Builds a resting pile of each size in a private scene and runs a capsule controller in circles through it
+			// for this many 60 Hz frames, once with the controller's geometry cache and once without. Prints the
+			// average move time for each
+			static void run(size_t frames);
+	};
+}
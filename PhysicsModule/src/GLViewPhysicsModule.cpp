@@ -31,6 +31,7 @@
 #include "WONVPhysX.h"
 #include "WONVDynSphere.h"
 #include "AftrGLRendererBase.h"
+#include "WOGUILabel.h"
 
 //If we want to use way points, we need to include this.
 #include "PhysicsModuleWayPoints.h"
@@ -39,17 +40,46 @@
 
 // Include the physics manager
 #include "ManagerPhysics.h"
+#include "ManagerReplication.h"
+#include "ManagerSceneCommands.h"
+#include "ManagerSceneQueries.h"
+#include "ManagerLookahead.h"
+#include "ManagerPoseRecorder.h"
+#include "ManagerCollisionMeshes.h"
+#include "ManagerLevelGeometry.h"
+#include "ManagerTerrain.h"
+#include "ManagerSimulationEvents.h"
+#include "ManagerTriggers.h"
+#include "ManagerCharacter.h"
+#include "ManagerVehicles.h"
+#include "ManagerRagdolls.h"
+#include "ManagerShards.h"
 
 // Net Message includes
 #include "NetMsg.h"
 #include "NetMessengerClient.h"
-#include "NetMsgNewSharedObject.h"
 #include "NetMsgMoveSphere.h"
 #include "NetMsgObjectOrientation.h"
+#include "NetMsgObjectOrientationBatch.h"
+#include "NetTelemetry.h"
+#include "NetMsgSchemaBenchmark.h"
+#include "NetTransportBenchmark.h"
+#include "ReplicationBenchmark.h"
+#include "SceneQueryBenchmark.h"
+#include "CCDBenchmark.h"
+#include "CharacterBenchmark.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
 
 using namespace Aftr;
 using namespace physx;
 
+// Velocity change in one step, beyond gravity, that counts as a contact for replication priority
+static const float CONTACT_VELOCITY_CHANGE = 2.0f;
+
 GLViewPhysicsModule* GLViewPhysicsModule::New( const std::vector< std::string >& args )
 {
    GLViewPhysicsModule* glv = new GLViewPhysicsModule( args );
@@ -88,6 +118,21 @@ void GLViewPhysicsModule::init(float gravityScalar,
 
 // Overload the shutdown method to shutdown new managers
 void GLViewPhysicsModule::shutdownEngine() {
+	ManagerPoseRecorder::shutdown();
+	ManagerLookahead::shutdown();
+	ManagerVehicles::shutdown();
+	ManagerRagdolls::shutdown();
+	ManagerTriggers::shutdown();
+	ManagerCharacter::shutdown();
+	ManagerTerrain::shutdown();
+	ManagerLevelGeometry::shutdown();
+	ManagerCollisionMeshes::shutdown();
+	ManagerSceneQueries::shutdown();
+	ManagerSceneCommands::shutdown();
+	ManagerShards::shutdown();
+	ManagerReplication::shutdown();
+	NetTelemetry::shutdown();
+	ManagerSimulationEvents::shutdown();
 	ManagerPhysics::shutdown();
 	GLView::shutdownEngine();
 }
@@ -108,13 +153,60 @@ void GLViewPhysicsModule::onCreate()
    this->setActorChaseType( STANDARDEZNAV ); //Default is STANDARDEZNAV mode
    //this->setNumPhysicsStepsPerRender( 0 ); //pause physics engine on start up; will remain paused till set to 1
 
-	// Set up the NetMessenger Client. Must be done here due to reliance on the managers
-   if (ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort") == "12683") {
-	   client = NetMessengerClient::New("127.0.0.1", "12682");
+	// Set up the viewer connections. Must be done here due to reliance on the managers
+   NetTelemetry::init("PhysicsModule");
+   ManagerPhysics::initStepping();
+   ManagerSimulationEvents::init();
+   if (ManagerSimulationEvents::reportsContacts())
+	   contact_reader = ManagerSimulationEvents::subscribe();
+   ManagerTriggers::init(this->cam->getPosition());
+   ManagerCharacter::init(this->cam->getPosition());
+   ManagerSceneCommands::init();
+   ManagerVehicles::init();
+   ManagerRagdolls::init();
+   ManagerReplication::init();
+   ManagerSceneQueries::init();
+   ManagerLookahead::init();
+   ManagerPoseRecorder::init();
+   ManagerCollisionMeshes::init();
+   // The infinite plane only stands in when the level has no collision of its own
+   if (ManagerLevelGeometry::init() == 0 && !ManagerTerrain::isLoaded()) {
+	   PxMaterial* gMaterial = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	   PxRigidStatic* groundPlane = PxCreatePlane(*ManagerPhysics::gPhysics, PxPlane(0, 0, 1, 0), *gMaterial);
+	   ManagerPhysics::addActorBind(grass_floor, groundPlane);
    }
-   else {
-	   client = NetMessengerClient::New("127.0.0.1", "12683");
+   // The other shards copy the statics that are in the scene by now
+   ManagerShards::init();
+   std::string height = ManagerEnvironmentConfiguration::getVariableValue("DropZoneHeight");
+   if (!height.empty())
+	   drop_zone_height = std::stof(height);
+   std::string vehicle_count = ManagerEnvironmentConfiguration::getVariableValue("VehicleBulkCount");
+   if (!vehicle_count.empty())
+	   vehicle_bulk_count = std::stoul(vehicle_count);
+   std::string ragdoll_count = ManagerEnvironmentConfiguration::getVariableValue("RagdollBulkCount");
+   if (!ragdoll_count.empty())
+	   ragdoll_bulk_count = std::stoul(ragdoll_count);
+   std::string bulk_count = ManagerEnvironmentConfiguration::getVariableValue("BulkSpawnCount");
+   if (!bulk_count.empty())
+	   bulk_spawn_count = std::stoul(bulk_count);
+   std::string model = ManagerEnvironmentConfiguration::getVariableValue("SpawnModel");
+   if (!model.empty()) {
+	   spawn_model = ManagerEnvironmentConfiguration::getSMM() + "/models/" + model;
+	   ManagerCollisionMeshes::get(spawn_model, Vector(1, 1, 1), CollisionMeshKind::Convex); // Start cooking before the first drop
    }
+
+   if (ManagerEnvironmentConfiguration::getVariableValue("NetMsgSchemaBenchmark") == "1")
+	   NetMsgSchemaBenchmark::run(1000000);
+   if (ManagerEnvironmentConfiguration::getVariableValue("NetTransportBenchmark") == "1")
+	   NetTransportBenchmark::run(10000, 600);
+   if (ManagerEnvironmentConfiguration::getVariableValue("ReplicationBenchmark") == "1")
+	   ReplicationBenchmark::run(1000, 300);
+   if (ManagerEnvironmentConfiguration::getVariableValue("SceneQueryBenchmark") == "1")
+	   SceneQueryBenchmark::run(10000, 100);
+   if (ManagerEnvironmentConfiguration::getVariableValue("CCDBenchmark") == "1")
+	   CCDBenchmark::run(100);
+   if (ManagerEnvironmentConfiguration::getVariableValue("CharacterBenchmark") == "1")
+	   CharacterBenchmark::run(600);
 }
 
 
@@ -129,15 +221,49 @@ void GLViewPhysicsModule::updateWorld()
    GLView::updateWorld(); //Just call the parent's update world first.
                           //If you want to add additional functionality, do it after
                           //this call.
-   // Step the PhysX world
-   // Since the getTime returns a value in milliseconds and PhysX expects seconds, divide by 1000
-   ManagerPhysics::scene->simulate(ManagerSDLTime::getTimeSinceLastPhysicsIteration() / 1000.0f);
-   ManagerPhysics::scene->fetchResults(true);
+   // Step the PhysX world in fixed substeps, replicating whatever the latest poses are on each network tick
+   // Since the getTime returns a value in milliseconds and PhysX expects seconds, ManagerPhysics converts
+   unsigned int substeps = ManagerPhysics::beginFrame(ManagerSDLTime::getTimeSinceLastPhysicsIteration());
+   ManagerVehicles::drive((float)drive_forward - (float)drive_back, (float)drive_left - (float)drive_right);
+   // The camera only gets as far as its controller does
+   if (ManagerCharacter::isEnabled())
+	   this->cam->setPosition(ManagerCharacter::move(this->cam->getPosition(), (float)(ManagerSDLTime::getTimeSinceLastMainLoopIteration() / 1000.0)));
+   ManagerTriggers::moveCamera(this->cam->getPosition());
+   for (unsigned int i = 0; i < substeps; i++) {
+	   // Scene changes queued from any thread land between steps
+	   ManagerSceneCommands::apply(getWorldContainer());
+	   ManagerVehicles::update(ManagerPhysics::getStepSeconds());
+	   ManagerPhysics::simulateStep();
+	   syncActiveActors(ManagerPhysics::getStepSeconds());
+	   ManagerRagdolls::sync();
+	   ManagerPhysics::publishSnapshot();
+   }
+   applyContactEvents();
+   // Waypoints the camera or an object went into
+   ManagerTriggers::update();
+   // Ragdolls that were hit come back, settled ones give way to their proxies
+   ManagerRagdolls::update(this->cam->getPosition(), ManagerSDLTime::getTimeSinceLastMainLoopIteration());
+   // Everything game code asked of the scene this frame, in one batch
+   ManagerSceneQueries::run();
+   // Tiles that craters dug into since the last frame
+   ManagerTerrain::update();
+   updatePreview(ManagerSDLTime::getTimeSinceLastMainLoopIteration());
+
+   // Sends to the viewers only when a replication tick is due
+   ManagerReplication::update(ManagerSDLTime::getTimeSinceLastMainLoopIteration());
+
+   NetTelemetry::update(ManagerSDLTime::getTimeSinceLastMainLoopIteration());
+   updateTelemetryOverlay();
+}
 
+
+void GLViewPhysicsModule::syncActiveActors(float step_s)
+{
    PxU32 num_transforms = 0;
-   PxActor** activeActors = ManagerPhysics::scene->getActiveActors(num_transforms);
+   PxActor** activeActors = ManagerPhysics::getActiveActors(num_transforms);
    for (PxU32 i = 0; i < num_transforms; i++) {
 	   WORigidActor* bound_data = static_cast<WORigidActor*>(activeActors[i]->userData); // Get the pair
+	   if (bound_data == nullptr) continue; // Helpers like the drag anchor have no aftr side
 	   PxTransform t = bound_data->actor->getGlobalPose(); // Get the transform
 	   PxMat44 new_pose = PxMat44(t); // Get the physx pose matrix
 	   Mat4 old_pose = bound_data->wo->getDisplayMatrix();
@@ -148,12 +274,37 @@ void GLViewPhysicsModule::updateWorld()
 							old_pose[12], old_pose[13], old_pose[14], old_pose[15]};
 
 	   Mat4 aftr_mat(convert);
-	   // Send orientation net message to update an item's orientation
-	   NetMsgObjectOrientation msg;
-	   msg.location = Vector(new_pose(0, 3), new_pose(1, 3), new_pose(2, 3));
-	   msg.orientation = aftr_mat;
-	   msg.wo_index = placed_cubes[bound_data->wo]; // Map data won't change like the worldLst
-	   client->sendNetMsgSynchronousTCP(msg);
+	   // Stage the pose for the next orientation batch
+	   PoseRecord pose;
+	   pose.id = bound_data->id; // Ids don't change like the worldLst
+	   pose.location[0] = new_pose(0, 3);
+	   pose.location[1] = new_pose(1, 3);
+	   pose.location[2] = new_pose(2, 3);
+	   for (int row = 0; row < 3; row++)
+		   for (int col = 0; col < 3; col++)
+			   pose.rotation[row * 3 + col] = new_pose(row, col);
+	   // Anything beyond what gravity alone explains this step was a hit
+	   PoseSnapshotRecord record;
+	   std::memcpy(record.location, pose.location, sizeof(record.location));
+	   std::memcpy(record.rotation, pose.rotation, sizeof(record.rotation));
+	   record.id = pose.id;
+	   record.sleeping = 0;
+	   PxVec3 velocity(0, 0, 0);
+	   PxRigidDynamic* dynamic = bound_data->actor->is<PxRigidDynamic>();
+	   if (dynamic != nullptr) {
+		   velocity = dynamic->getLinearVelocity();
+		   PxVec3 expected = bound_data->last_velocity + ManagerPhysics::scene->getGravity() * step_s;
+		   // Only guessed at when the scene isn't reporting contacts itself
+		   if (contact_reader < 0 && (velocity - expected).magnitude() > CONTACT_VELOCITY_CHANGE)
+			   ManagerReplication::markContact(pose.id);
+		   bound_data->last_velocity = velocity;
+		   record.sleeping = dynamic->isSleeping() ? 1 : 0;
+	   }
+	   record.velocity[0] = velocity.x;
+	   record.velocity[1] = velocity.y;
+	   record.velocity[2] = velocity.z;
+	   ManagerPhysics::snapshots.update(record);
+	   ManagerReplication::stagePose(pose, velocity.magnitude());
 
 	   // Apply the new pose
 	   bound_data->wo->getModel()->setDisplayMatrix(aftr_mat);
@@ -162,6 +313,45 @@ void GLViewPhysicsModule::updateWorld()
 }
 
 
+void GLViewPhysicsModule::applyContactEvents()
+{
+   if (contact_reader < 0)
+	   return;
+   contact_events.clear();
+   ManagerSimulationEvents::read(contact_reader, contact_events);
+   for (const SimulationEvent& event : contact_events) {
+	   if (event.type != SimulationEventType::Contact) continue;
+	   if (event.id0 >= 0) ManagerReplication::markContact(event.id0);
+	   if (event.id1 >= 0) ManagerReplication::markContact(event.id1);
+   }
+}
+
+
+void GLViewPhysicsModule::updateTelemetryOverlay()
+{
+   if( telemetry_periods_shown == NetTelemetry::getPeriods() )
+      return;
+   telemetry_periods_shown = NetTelemetry::getPeriods();
+
+   const std::vector< std::string >& summary = NetTelemetry::getSummary();
+   while( telemetry_labels.size() < summary.size() )
+   {
+      WOGUILabel* label = WOGUILabel::New( nullptr );
+      label->setFontPath( ManagerEnvironmentConfiguration::getSMM() + "/fonts/arial.ttf" );
+      label->setFontSize( 14 );
+      label->setColor( 255, 255, 0, 255 );
+      label->setPosition( Vector( 0.01f, 0.98f - 0.03f * telemetry_labels.size(), 0 ) );
+      worldLst->push_back( label );
+      telemetry_labels.push_back( label );
+   }
+   for( size_t i = 0; i < telemetry_labels.size(); i++ )
+   {
+      telemetry_labels[i]->setText( i < summary.size() ? summary[i] : "" );
+      telemetry_labels[i]->isVisible = show_telemetry;
+   }
+}
+
+
 void GLViewPhysicsModule::onResizeWindow( GLsizei width, GLsizei height )
 {
    GLView::onResizeWindow( width, height ); //call parent's resize method.
@@ -171,74 +361,208 @@ void GLViewPhysicsModule::onResizeWindow( GLsizei width, GLsizei height )
 void GLViewPhysicsModule::onMouseDown( const SDL_MouseButtonEvent& e )
 {
    GLView::onMouseDown( e );
+   // Pick whatever object is under the mouse and start dragging it
+   if( e.button == SDL_BUTTON_LEFT )
+   {
+	   Vector from = this->cam->getPosition();
+	   Vector ray = this->cam->getCameraRayThroughScreenCoordinate( e.x, e.y );
+	   // Clicking the same object again skips the scene, as long as it still exists
+	   WORigidActor* cached = ManagerSceneCommands::getBinding(picked_id);
+	   const PxQueryCache* cache = cached != nullptr && cached->actor == pick_cache.actor ? &pick_cache : nullptr;
+	   picked_id = -1; // Until the raycast comes back
+	   dragging = true;
+	   ManagerSceneQueries::raycast(PxVec3(from.x, from.y, from.z), PxVec3(ray.x, ray.y, ray.z), ManagerOpenGLState::GL_CLIPPING_PLANE,
+		   [this](const SceneQueryHit* hit) {
+			   picked_id = hit != nullptr ? hit->id : -1;
+			   // Let go before the result came back, or clicked on nothing that moves
+			   if (!dragging || picked_id < 0) {
+				   dragging = false;
+				   return;
+			   }
+			   pick_cache.shape = hit->shape;
+			   pick_cache.actor = hit->actor;
+			   drag_distance = hit->distance;
+			   ManagerSceneCommands::grab(picked_id, hit->position);
+		   }, PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC, cache);
+   }
 }
 
 
 void GLViewPhysicsModule::onMouseUp( const SDL_MouseButtonEvent& e )
 {
    GLView::onMouseUp( e );
+   if( e.button == SDL_BUTTON_LEFT && dragging )
+   {
+	   dragging = false;
+	   ManagerSceneCommands::release();
+   }
 }
 
 
 void GLViewPhysicsModule::onMouseMove( const SDL_MouseMotionEvent& e )
 {
+   // While holding an object the mouse moves it instead of the camera
+   if( dragging && picked_id >= 0 )
+   {
+	   Vector from = this->cam->getPosition();
+	   Vector ray = this->cam->getCameraRayThroughScreenCoordinate( e.x, e.y );
+	   ray.normalizeMe();
+	   Vector target = from + ray * drag_distance;
+	   ManagerSceneCommands::dragTo(PxVec3(target.x, target.y, target.z));
+	   return;
+   }
    GLView::onMouseMove( e );
 }
 
 
 void GLViewPhysicsModule::onKeyDown( const SDL_KeyboardEvent& key )
 {
-   static PxMaterial* gMaterial = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
-   static Vector dropPos = Vector(20, 20, 100);
-   static int cubes = 0;
    GLView::onKeyDown( key );
    if( key.keysym.sym == SDLK_0 )
       this->setNumPhysicsStepsPerRender( 1 );
 
+   // Toggle the network telemetry overlay
+   if( key.keysym.sym == SDLK_3 )
+   {
+      show_telemetry = !show_telemetry;
+      for( WOGUILabel* label : telemetry_labels )
+         label->isVisible = show_telemetry;
+   }
+
    // Set the drop zone
    if( key.keysym.sym == SDLK_1 )
    {
-	   dropPos = this->cam->getPosition();
-	   track_sphere->setPosition(dropPos);
-
-	   // Send move sphere net message to update an item's location
-	   NetMsgMoveSphere msg;
-	   msg.location = dropPos;
-	   client->sendNetMsgSynchronousTCP(msg);
+	   // Applied with the other scene changes, which also updates the viewers
+	   Vector at = this->cam->getPosition();
+	   if( drop_zone_height <= 0 )
+		   ManagerSceneCommands::moveDropZone(at);
+	   else {
+		   // Snap to a fixed height over whatever is below the camera, the ground or the top of a pile
+		   float height = drop_zone_height;
+		   ManagerSceneQueries::raycast(PxVec3(at.x, at.y, at.z), PxVec3(0, 0, -1), ManagerOpenGLState::GL_CLIPPING_PLANE,
+			   [at, height](const SceneQueryHit* hit) {
+				   ManagerSceneCommands::moveDropZone(hit != nullptr ? Vector(hit->position.x, hit->position.y, hit->position.z + height) : at);
+			   });
+	   }
    }
    // Make a new object at drop zone
    if (key.keysym.sym == SDLK_2){
-   
-	   // Add the item to the aftr world
-	   WO* wo = WO::New(ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl", Vector(1, 1, 1));
-	   wo->setPosition(dropPos);
-	   worldLst->push_back(wo);
-
-	   // Send new object net message to spawn a new object
-	   NetMsgNewSharedObject msg;
-	   msg.location = dropPos;
-	   msg.size_scale = Vector(1, 1, 1);
-	   msg.model_path = ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl";
-	   client->sendNetMsgSynchronousTCP(msg);
-
-	   // Add the item to the physx world
-	   PxTransform t = PxTransform(PxVec3(dropPos.x, dropPos.y, dropPos.z));
-	   PxShape* shape = ManagerPhysics::gPhysics->createShape(PxBoxGeometry(2.0f, 2.0f, 2.0f), *gMaterial);
-	   PxRigidDynamic* actor = PxCreateDynamic(*ManagerPhysics::gPhysics, t, *shape, 10.0f);
-
-	   WORigidActor* combo = WORigidActor::New(wo, actor);
-	   ManagerPhysics::addActorBind(combo, actor); // Physx knows its aftr counterpart
-
-	   // Register it to the local storage
-	   placed_cubes.insert(std::pair(wo, cubes));
-	   cubes++;
+	   SceneSpawn spawn;
+	   spawn.location = drop_pos;
+	   spawn.model_path = spawn_model;
+	   spawn.convex = !spawn_model.empty();
+	   ManagerSceneCommands::spawn(spawn);
    }
+   // Make a batch of objects at the drop zone as a grid, pile, tower or random cloud
+   if( key.keysym.sym >= SDLK_4 && key.keysym.sym <= SDLK_7 )
+   {
+	   SceneBulkSpawn bulk;
+	   bulk.object.location = drop_pos;
+	   bulk.object.model_path = spawn_model;
+	   bulk.object.convex = !spawn_model.empty();
+	   bulk.layout = (SceneLayout)(key.keysym.sym - SDLK_4);
+	   bulk.count = bulk_spawn_count;
+	   bulk.seed = ++bulk_spawns; // A different pile or cloud each time
+	   ManagerSceneCommands::spawnBulk(bulk);
+   }
+   // Drop a tank, or a square of them, at the drop zone
+   if( key.keysym.sym == SDLK_v )
+	   ManagerSceneCommands::spawn( ManagerVehicles::describe( drop_pos ) );
+   if( key.keysym.sym == SDLK_b )
+   {
+	   size_t side = (size_t)std::ceil( std::sqrt( (double)vehicle_bulk_count ) );
+	   for( size_t i = 0; i < vehicle_bulk_count; i++ )
+		   ManagerSceneCommands::spawn( ManagerVehicles::describe( drop_pos + Vector( 6.0f * ( i % side ), 4.0f * ( i / side ), 0 ) ) );
+   }
+   // Drop a ragdoll, or a square of them, at the drop zone
+   if( key.keysym.sym == SDLK_h )
+	   ManagerRagdolls::spawn( getWorldContainer(), drop_pos );
+   if( key.keysym.sym == SDLK_n )
+   {
+	   size_t side = (size_t)std::ceil( std::sqrt( (double)ragdoll_bulk_count ) );
+	   for( size_t i = 0; i < ragdoll_bulk_count; i++ )
+		   ManagerRagdolls::spawn( getWorldContainer(), drop_pos + Vector( 1.5f * ( i % side ), 1.5f * ( i / side ), 0 ) );
+   }
+   // Every tank drives with the arrow keys
+   setDriveKey( key, true );
+   // Blow apart whatever the camera is looking at
+   if( key.keysym.sym == SDLK_8 )
+	   blast(15, 20);
+   // Show where a cube dropped now would go
+   if( key.keysym.sym == SDLK_9 )
+   {
+	   show_preview = !show_preview;
+	   ms_since_preview = 1.0e9; // Ask right away
+	   for( WO* marker : preview_markers )
+		   marker->isVisible = false;
+   }
+}
+
+
+void GLViewPhysicsModule::updatePreview(double frame_ms)
+{
+   ManagerLookahead::poll();
+   ms_since_preview += frame_ms;
+   if( !show_preview || ms_since_preview < 250 )
+	   return;
+   ms_since_preview = 0;
+
+   // Predicted from the scene as it is right now, while it keeps stepping
+   SceneSpawn cube;
+   PxVec3 at(drop_pos.x, drop_pos.y, drop_pos.z);
+   ManagerLookahead::predictDrop(PxVec3(cube.half_extents.x, cube.half_extents.y, cube.half_extents.z), cube.density, PxTransform(at, cube.rotation),
+	   PxVec3(cube.velocity.x, cube.velocity.y, cube.velocity.z), [this](const LookaheadResult& result) {
+		   if (!show_preview || result.path.empty()) return;
+		   // Spread the markers evenly over the path, the last always on the resting spot
+		   size_t markers = preview_markers.size();
+		   for (size_t i = 0; i < markers; i++) {
+			   PxVec3 p = i + 1 == markers ? result.rest.p : result.path[i * (result.path.size() - 1) / (markers - 1)];
+			   preview_markers[i]->setPosition(Vector(p.x, p.y, p.z));
+			   preview_markers[i]->isVisible = true;
+		   }
+	   });
+}
+
+
+void GLViewPhysicsModule::blast(float radius, float speed)
+{
+   // Find the spot first, then everything near it. Each query's results come back after the next step
+   Vector from = this->cam->getPosition();
+   Vector look = this->cam->getCameraLookDirection();
+   ManagerSceneQueries::raycast(PxVec3(from.x, from.y, from.z), PxVec3(look.x, look.y, look.z), ManagerOpenGLState::GL_CLIPPING_PLANE,
+	   [radius, speed](const SceneQueryHit* hit) {
+		   if (hit == nullptr) return;
+		   PxVec3 center = hit->position;
+		   // Blasting the ground leaves a crater
+		   if (ManagerTerrain::isTerrain(hit->actor))
+			   ManagerTerrain::crater(Vector(center.x, center.y, center.z), radius / 2, radius / 5);
+		   ManagerSceneQueries::overlap(PxSphereGeometry(radius), PxTransform(center),
+			   [center, radius, speed](const std::vector<SceneQueryHit>& hits) {
+				   for (const SceneQueryHit& object : hits) {
+					   if (object.id < 0) continue;
+					   PxVec3 away = object.actor->getGlobalPose().p - center;
+					   float falloff = std::max(0.0f, 1.0f - away.magnitude() / radius);
+					   ManagerSceneCommands::addForce(object.id, (away.getNormalized() + PxVec3(0, 0, 1)).getNormalized() * speed * falloff,
+						   PxForceMode::eVELOCITY_CHANGE);
+				   }
+			   }, PxQueryFlag::eDYNAMIC);
+	   });
 }
 
 
 void GLViewPhysicsModule::onKeyUp( const SDL_KeyboardEvent& key )
 {
    GLView::onKeyUp( key );
+   setDriveKey( key, false );
+}
+
+
+void GLViewPhysicsModule::setDriveKey( const SDL_KeyboardEvent& key, bool down )
+{
+   if( key.keysym.sym == SDLK_UP ) drive_forward = down;
+   if( key.keysym.sym == SDLK_DOWN ) drive_back = down;
+   if( key.keysym.sym == SDLK_LEFT ) drive_left = down;
+   if( key.keysym.sym == SDLK_RIGHT ) drive_right = down;
 }
 
 
@@ -320,28 +644,53 @@ void Aftr::GLViewPhysicsModule::loadMap()
    grassSkin.setSpecularCoefficient( 10 ); // How "sharp" are the specular highlights (bigger is sharper, 1000 is very sharp, 10 is very dull)
    wo->setLabel( "Grass" );
    worldLst->push_back( wo );
-   // Add this plane to the PhysX engine
-   PxMaterial* gMaterial = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
-   PxRigidStatic* groundPlane = PxCreatePlane(*ManagerPhysics::gPhysics, PxPlane(0, 0, 1, 0), *gMaterial);
-   ManagerPhysics::addActorBind(wo, groundPlane);
+   // Heightfield terrain takes the grass's place when aftr.conf names one
+   if( ManagerTerrain::init( worldLst ) )
+      wo->isVisible = false;
+   else
+   {
+      // Collides as its own triangles once onCreate builds the level
+      grass_floor = wo;
+      ManagerLevelGeometry::addCollider( wo, grass, Vector( 5, 5, 1 ) );
+   }
 
 
    track_sphere = WO::New(yellowSphere, Vector(0.25f, 0.25f, 0.25f), MESH_SHADING_TYPE::mstFLAT);
    track_sphere->setPosition(Vector(20, 20, 100));
    worldLst->push_back(track_sphere);
-   
-   //createPhysicsModuleWayPoints();
+
+   // Drop preview markers, hidden until '9' turns the preview on
+   for( int i = 0; i < 16; i++ )
+   {
+      WO* marker = WO::New(yellowSphere, i == 15 ? Vector(0.3f, 0.3f, 0.3f) : Vector(0.1f, 0.1f, 0.1f), MESH_SHADING_TYPE::mstFLAT);
+      marker->isVisible = false;
+      worldLst->push_back(marker);
+      preview_markers.push_back(marker);
+   }
+
+   createPhysicsModuleWayPoints();
 }
 
 
 void GLViewPhysicsModule::createPhysicsModuleWayPoints()
 {
-   // Create a waypoint with a radius of 3, a frequency of 5 seconds, activated by GLView's camera, and is visible.
+   std::string value = ManagerEnvironmentConfiguration::getVariableValue( "WayPointCount" );
+   unsigned int count = value.empty() ? 0 : std::stoul( value );
+   bool dynamic_objects = ManagerEnvironmentConfiguration::getVariableValue( "WayPointObjects" ) == "1";
+
+   // Create waypoints with a radius of 3, a frequency of 5 seconds, activated by GLView's camera, and visible.
+   // The first is at 50, 0, 3 and the rest fill a square grid from there
+   // The engine doesn't check the camera itself, the scene's broadphase reports it to ManagerTriggers instead
    WayPointParametersBase params(this);
    params.frequency = 5000;
-   params.useCamera = true;
+   params.useCamera = false;
    params.visible = true;
-   WOWayPointSpherical* wayPt = WOWP1::New( params, 3 );
-   wayPt->setPosition( Vector( 50, 0, 3 ) );
-   worldLst->push_back( wayPt );
+   unsigned int side = (unsigned int)std::ceil( std::sqrt( (double)count ) );
+   for( unsigned int i = 0; i < count; i++ )
+   {
+      WOWayPointSpherical* wayPt = WOWP1::New( params, 3 );
+      wayPt->setPosition( Vector( 50.0f + 10.0f * ( i % side ), 10.0f * ( i / side ), 3 ) );
+      worldLst->push_back( wayPt );
+      ManagerTriggers::addWayPoint( wayPt, 3, params.frequency, dynamic_objects );
+   }
 }
@@ -1,15 +1,16 @@
 #pragma once
 
 #include "GLView.h"
-#include "NetMessengerClient.h"
 
 #include "PxPhysicsAPI.h"
+#include "SimulationEventRing.h"
 
 #include <map>
 
 namespace Aftr
 {
    class Camera;
+   class WOGUILabel;
 
 /**
    \class GLViewPhysicsModule
@@ -44,13 +45,46 @@ public:
    void shutdownEngine();
 
    WO* track_sphere;
-   std::map<WO*, int> placed_cubes; // Keep track of the cubes separately from the world list to keep in sync
+   WO* grass_floor = nullptr; // Grass floor, collides as level geometry
+   Vector drop_pos = Vector(20, 20, 100); // Where new cubes are dropped from
+   size_t bulk_spawn_count = 1000; // Objects per bulk spawn, BulkSpawnCount in aftr.conf
+   size_t vehicle_bulk_count = 24; // Tanks 'b' drops at once, VehicleBulkCount in aftr.conf
+   size_t ragdoll_bulk_count = 32; // Ragdolls 'n' drops at once, RagdollBulkCount in aftr.conf
+   unsigned int bulk_spawns = 0;
+   std::string spawn_model; // SpawnModel in aftr.conf, dropped with its convex hull instead of the red cube
+   float drop_zone_height = 0; // Height of the drop zone above what's under the camera, 0 uses the camera itself
+   int picked_id = -1; // Object last clicked on, -1 if none
+   physx::PxQueryCache pick_cache; // Shape last picked, tested before the rest of the scene
+   bool dragging = false; // Left button is holding a picked object
+   float drag_distance = 0; // How far in front of the camera the grab point is held
 
 protected:
    GLViewPhysicsModule( const std::vector< std::string >& args );
    virtual void onCreate();  
-
-   NetMessengerClient* client;
+   // Copy the poses of actors that moved in the last substep to their WOs and stage them for replication
+   void syncActiveActors(float step_s);
+   // Network telemetry overlay, toggled with '3'
+   void updateTelemetryOverlay();
+   // Pushes every object within radius of where the camera is looking away from that point
+   void blast(float radius, float speed);
+   // Impacts reported by the scene, they move objects up the replication queue
+   void applyContactEvents();
+   // Arrow keys held down, driving every tank
+   void setDriveKey( const SDL_KeyboardEvent& key, bool down );
+   bool drive_forward = false;
+   bool drive_back = false;
+   bool drive_left = false;
+   bool drive_right = false;
+   int contact_reader = -1; // Simulation event reader, -1 while contact events are off
+   std::vector<SimulationEvent> contact_events;
+   // Drop preview, toggled with '9'. The path a cube dropped now would take and where it would rest
+   void updatePreview(double frame_ms);
+   std::vector<WO*> preview_markers; // Along the path, the last one marks the resting spot
+   bool show_preview = false;
+   double ms_since_preview = 0;
+   std::vector<WOGUILabel*> telemetry_labels;
+   size_t telemetry_periods_shown = 0;
+   bool show_telemetry = false;
 };
 
 /** \} */
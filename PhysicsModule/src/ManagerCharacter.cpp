@@ -0,0 +1,112 @@
+#include <iostream>
+#include <algorithm>
+#include "ManagerCharacter.h"
+#include "ManagerPhysics.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+PxControllerManager* ManagerCharacter::manager = nullptr;
+PxObstacleContext* ManagerCharacter::obstacles = nullptr;
+PxController* ManagerCharacter::controller = nullptr;
+PxMaterial* ManagerCharacter::material = nullptr;
+std::unique_ptr<CharacterPushReport> ManagerCharacter::report;
+
+void CharacterPushReport::onShapeHit(const PxControllerShapeHit& hit) {
+	PxRigidDynamic* body = hit.actor->is<PxRigidDynamic>();
+	if (body == nullptr || (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC) || move_s <= 0) return;
+	// Only what the body is missing, so a body already moving away isn't pushed again every move
+	float missing = hit.length / move_s * factor - body->getLinearVelocity().dot(hit.dir);
+	if (missing <= 0) return;
+	PxRigidBodyExt::addForceAtPos(*body, hit.dir * missing * body->getMass(), toVec3(hit.worldPos), PxForceMode::eIMPULSE);
+}
+
+PxCapsuleControllerDesc ManagerCharacter::describe(float radius, float height, PxMaterial* material) {
+	PxCapsuleControllerDesc desc;
+	desc.radius = radius;
+	desc.height = height;
+	desc.material = material;
+	desc.upDirection = PxVec3(0, 0, 1);
+	desc.slopeLimit = 0; // The camera flies, there is no walking up slopes
+	desc.stepOffset = std::min(0.25f, height / 2);
+	desc.contactOffset = 0.05f;
+	return desc;
+}
+
+bool ManagerCharacter::init(const Vector& camera_position) {
+	if (ManagerEnvironmentConfiguration::getVariableValue("CharacterController") != "1")
+		return false;
+	float radius = 0.5f;
+	float height = 1.0f;
+	float volume_growth = 1.5f;
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("CharacterRadius");
+	if (!value.empty()) radius = std::max(0.05f, std::stof(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("CharacterHeight");
+	if (!value.empty()) height = std::max(0.0f, std::stof(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("CharacterVolumeGrowth");
+	if (!value.empty()) volume_growth = std::max(1.0f, std::stof(value));
+	report = std::make_unique<CharacterPushReport>();
+	value = ManagerEnvironmentConfiguration::getVariableValue("CharacterPushFactor");
+	if (!value.empty()) report->factor = std::max(0.0f, std::stof(value));
+
+	manager = PxCreateControllerManager(*ManagerPhysics::scene);
+	// Precise sweeps cost more in piles and the camera doesn't need them
+	manager->setPreciseSweeps(ManagerEnvironmentConfiguration::getVariableValue("CharacterPreciseSweeps") == "1");
+	material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+
+	// A wall on each side of the square the camera stays in, CharacterBounds from the origin. 0 leaves it unbounded
+	obstacles = manager->createObstacleContext();
+	value = ManagerEnvironmentConfiguration::getVariableValue("CharacterBounds");
+	float bounds = value.empty() ? 0.0f : std::max(0.0f, std::stof(value));
+	for (int i = 0; i < 4 && bounds > 0; i++) {
+		PxBoxObstacle wall;
+		PxVec3 normal(i == 0 ? 1.0f : i == 1 ? -1.0f : 0.0f, i == 2 ? 1.0f : i == 3 ? -1.0f : 0.0f, 0);
+		wall.mPos = PxExtendedVec3(normal.x * (bounds + 1), normal.y * (bounds + 1), 0);
+		wall.mHalfExtents = PxVec3(normal.x != 0 ? 1 : bounds + 2, normal.y != 0 ? 1 : bounds + 2, 10000);
+		obstacles->addObstacle(wall);
+	}
+
+	PxCapsuleControllerDesc desc = describe(radius, height, material);
+	desc.position = PxExtendedVec3(camera_position.x, camera_position.y, camera_position.z);
+	desc.volumeGrowth = volume_growth; // Geometry within this much of the capsule's sweep is cached for later moves
+	desc.reportCallback = report.get();
+	controller = manager->createController(desc);
+	if (controller == nullptr) {
+		std::cout << "Unable to create the camera's character controller" << std::endl;
+		shutdown();
+		return false;
+	}
+	// The pushes come from the hit report, so its actor is kept out of the solver and the camera's own queries
+	PxRigidDynamic* actor = controller->getActor();
+	actor->userData = nullptr; // No aftr side
+	PxShape* shape = nullptr;
+	actor->getShapes(&shape, 1);
+	shape->setSimulationFilterData(PxFilterData(0, ManagerPhysics::SENSOR_FILTER, 0, 0));
+	shape->setFlag(PxShapeFlag::eSCENE_QUERY_SHAPE, false);
+	return true;
+}
+
+void ManagerCharacter::shutdown() {
+	if (manager != nullptr) manager->release(); // Takes the controllers and obstacle contexts with it
+	manager = nullptr;
+	controller = nullptr;
+	obstacles = nullptr;
+	if (material != nullptr) material->release();
+	material = nullptr;
+	report.reset();
+}
+
+bool ManagerCharacter::isEnabled() {
+	return controller != nullptr;
+}
+
+Vector ManagerCharacter::move(const Vector& wanted, float frame_s) {
+	if (controller == nullptr) return wanted;
+	PxVec3 displacement = PxVec3(wanted.x, wanted.y, wanted.z) - toVec3(controller->getPosition());
+	report->move_s = frame_s;
+	controller->move(displacement, 0.001f, frame_s, PxControllerFilters(), obstacles);
+	PxVec3 at = toVec3(controller->getPosition());
+	return Vector(at.x, at.y, at.z);
+}
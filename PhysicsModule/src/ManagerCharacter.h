@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "characterkinematic/PxControllerManager.h"
+#include "characterkinematic/PxCapsuleController.h"
+#include "characterkinematic/PxControllerObstacles.h"
+#include "Vector.h"
+
+#include <memory>
+
+namespace Aftr
+{
+	// Gives the bodies a controller runs into the controller's speed along its move, as if it were a solid mass
+	class CharacterPushReport : public physx::PxUserControllerHitReport {
+		public:
+			float factor = 1; // Fraction of the controller's speed handed over
+			float move_s = 0; // Length of the move being reported
+
+			void onShapeHit(const physx::PxControllerShapeHit& hit) override;
+			void onControllerHit(const physx::PxControllersHit&) override {}
+			void onObstacleHit(const physx::PxControllerObstacleHit&) override {} // Obstacles never move
+	};
+
+	// This manager is meant to be a singleton for the capsule controller that carries the camera. The camera's own
+	// navigation says where it wants to go and the controller gets it as far as the scene lets it. The controller
+	// keeps the scene around it cached between moves, and the walls around the play area are obstacles rather than
+	// actors, so cubes never hit them and they cost nothing in the scene
+	class ManagerCharacter {
+		protected:
+			static physx::PxControllerManager* manager;
+			static physx::PxObstacleContext* obstacles;
+			static physx::PxController* controller;
+			static physx::PxMaterial* material;
+			static std::unique_ptr<CharacterPushReport> report;
+
+		public:
+			// Reads CharacterController, CharacterRadius, CharacterHeight, CharacterVolumeGrowth, CharacterPreciseSweeps,
+			// CharacterPushFactor and CharacterBounds from aftr.conf. Returns false and leaves the camera free unless CharacterController=1
+			static bool init(const Vector& camera_position);
+			static void shutdown();
+			static bool isEnabled();
+
+			// Main thread, with the scene idle, before the physics steps. Moves toward where the camera wants to be,
+			// pushing whatever moves out of the way, and returns where the controller ended up
+			static Vector move(const Vector& wanted, float frame_s);
+
+			// Capsule controller desc with the settings both the camera and the benchmark use
+			static physx::PxCapsuleControllerDesc describe(float radius, float height, physx::PxMaterial* material);
+	};
+}
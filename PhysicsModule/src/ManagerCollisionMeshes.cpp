@@ -0,0 +1,272 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <filesystem>
+#include "ManagerCollisionMeshes.h"
+#include "ManagerPhysics.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "WO.h"
+#include "Model.h"
+#include "ModelDataShared.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+std::vector<std::thread> ManagerCollisionMeshes::workers;
+std::mutex ManagerCollisionMeshes::job_mutex;
+std::condition_variable ManagerCollisionMeshes::job_ready;
+std::vector<std::unique_ptr<CollisionCookJob>> ManagerCollisionMeshes::jobs;
+std::vector<std::unique_ptr<CollisionCookJob>> ManagerCollisionMeshes::finished;
+bool ManagerCollisionMeshes::stopping = false;
+std::string ManagerCollisionMeshes::cache_dir;
+std::unordered_map<std::string, std::string> ManagerCollisionMeshes::keys;
+std::unordered_map<std::string, CollisionMesh> ManagerCollisionMeshes::meshes;
+std::set<std::string> ManagerCollisionMeshes::cooking;
+
+namespace {
+	// Bump whenever the cooking parameters change, so stale cache files are never loaded
+	const uint32_t COOK_FORMAT = 1;
+
+	uint64_t fnv1a(const void* data, size_t bytes, uint64_t hash = 14695981039346656037ull) {
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < bytes; i++) {
+			hash ^= p[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+PxGeometryHolder CollisionMesh::geometry() const {
+	if (convex != nullptr) return PxConvexMeshGeometry(convex);
+	return PxTriangleMeshGeometry(triangles);
+}
+
+void ManagerCollisionMeshes::init() {
+	cache_dir = ManagerEnvironmentConfiguration::getVariableValue("CollisionCacheDir");
+	if (cache_dir.empty()) cache_dir = ManagerEnvironmentConfiguration::getLMM() + "/collision_cache/";
+	else if (cache_dir == "none") cache_dir.clear();
+	if (!cache_dir.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(cache_dir, error);
+		if (error) {
+			std::cout << "Unable to use " << cache_dir << " for cooked meshes, they won't be cached" << std::endl;
+			cache_dir.clear();
+		}
+	}
+	unsigned int threads = 2;
+	std::string count = ManagerEnvironmentConfiguration::getVariableValue("CollisionCookThreads");
+	if (!count.empty()) threads = std::max(1u, (unsigned int)std::stoul(count));
+	stopping = false;
+	for (unsigned int i = 0; i < threads; i++)
+		workers.push_back(std::thread(run));
+}
+
+void ManagerCollisionMeshes::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		stopping = true;
+	}
+	job_ready.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+	jobs.clear();
+	finished.clear();
+	cooking.clear();
+	keys.clear();
+	// Shapes still using a mesh hold their own reference
+	for (auto& entry : meshes) {
+		if (entry.second.convex != nullptr) entry.second.convex->release();
+		if (entry.second.triangles != nullptr) entry.second.triangles->release();
+	}
+	meshes.clear();
+}
+
+std::string ManagerCollisionMeshes::contentKey(const std::string& model_path, const Vector& scale, CollisionMeshKind kind) {
+	// The model file's bytes, so an edited model is cooked again even under the same name
+	uint64_t hash = fnv1a(&COOK_FORMAT, sizeof(COOK_FORMAT));
+	std::ifstream file(model_path, std::ios::binary);
+	if (file) {
+		char buffer[65536];
+		while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+			hash = fnv1a(buffer, (size_t)file.gcount(), hash);
+	}
+	else {
+		hash = fnv1a(model_path.data(), model_path.size(), hash);
+	}
+	float scales[3] = { scale.x, scale.y, scale.z };
+	hash = fnv1a(scales, sizeof(scales), hash);
+	hash = fnv1a(&kind, sizeof(kind), hash);
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return ss.str();
+}
+
+std::string ManagerCollisionMeshes::cacheFile(const std::string& name) {
+	if (cache_dir.empty()) return "";
+	return cache_dir + "/" + name;
+}
+
+std::string ManagerCollisionMeshes::cachePath(const std::string& key, CollisionMeshKind kind) {
+	return cacheFile(key + (kind == CollisionMeshKind::Convex ? ".convex" : ".trimesh"));
+}
+
+const CollisionMesh* ManagerCollisionMeshes::get(const std::string& model_path, const Vector& scale, CollisionMeshKind kind) {
+	std::stringstream lookup;
+	lookup << (int)kind << ' ' << scale.x << ' ' << scale.y << ' ' << scale.z << ' ' << model_path;
+	auto known = keys.find(lookup.str());
+	if (known != keys.end()) {
+		auto mesh = meshes.find(known->second);
+		return mesh != meshes.end() ? &mesh->second : nullptr;
+	}
+
+	// First ask for this model at this scale
+	std::string key = contentKey(model_path, scale, kind);
+	keys[lookup.str()] = key;
+	auto mesh = meshes.find(key);
+	if (mesh != meshes.end()) return &mesh->second;
+	if (cooking.count(key) > 0) return nullptr;
+
+	// Cooked before, by this run or an earlier one
+	std::string path = cachePath(key, kind);
+	std::ifstream file(path, std::ios::binary);
+	if (file) {
+		std::vector<PxU8> cooked((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const CollisionMesh* loaded = create(key, kind, cooked);
+		if (!loaded->failed()) return loaded;
+		meshes.erase(key); // Corrupt or from another PhysX version, cook it again
+	}
+
+	// The model's vertices, already scaled by the loader
+	std::unique_ptr<CollisionCookJob> job(new CollisionCookJob());
+	job->key = key;
+	job->model_path = model_path;
+	job->kind = kind;
+	WO* wo = WO::New(model_path, scale);
+	const std::vector<Vector>& vertices = wo->getModel()->getModelDataShared()->getCompositeVertexList();
+	job->points.reserve(vertices.size());
+	for (const Vector& v : vertices)
+		job->points.push_back(PxVec3(v.x, v.y, v.z));
+	if (kind == CollisionMeshKind::Triangle) {
+		const std::vector<unsigned int>& indices = wo->getModel()->getModelDataShared()->getCompositeIndexList();
+		job->indices.assign(indices.begin(), indices.end());
+	}
+	delete wo;
+
+	cooking.insert(key);
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		jobs.push_back(std::move(job));
+	}
+	job_ready.notify_one();
+	return nullptr;
+}
+
+const CollisionMesh* ManagerCollisionMeshes::wait(const std::string& model_path, const Vector& scale, CollisionMeshKind kind) {
+	const CollisionMesh* mesh = get(model_path, scale, kind);
+	while (mesh == nullptr) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		poll();
+		mesh = get(model_path, scale, kind);
+	}
+	return mesh;
+}
+
+const CollisionMesh* ManagerCollisionMeshes::create(const std::string& key, CollisionMeshKind kind, const std::vector<PxU8>& cooked) {
+	CollisionMesh& mesh = meshes[key];
+	mesh.kind = kind;
+	if (cooked.empty()) return &mesh;
+	PxDefaultMemoryInputData input(const_cast<PxU8*>(cooked.data()), (PxU32)cooked.size());
+	if (kind == CollisionMeshKind::Convex) {
+		mesh.convex = ManagerPhysics::gPhysics->createConvexMesh(input);
+		if (mesh.convex != nullptr) mesh.bounds = mesh.convex->getLocalBounds();
+	}
+	else {
+		mesh.triangles = ManagerPhysics::gPhysics->createTriangleMesh(input);
+		if (mesh.triangles != nullptr) mesh.bounds = mesh.triangles->getLocalBounds();
+	}
+	return &mesh;
+}
+
+void ManagerCollisionMeshes::poll() {
+	std::vector<std::unique_ptr<CollisionCookJob>> done;
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		done.swap(finished);
+	}
+	for (std::unique_ptr<CollisionCookJob>& job : done) {
+		cooking.erase(job->key);
+		const CollisionMesh* mesh = create(job->key, job->kind, job->cooked);
+		if (mesh->failed())
+			std::cout << "Unable to cook " << job->model_path << ", using a box instead" << std::endl;
+		else
+			std::cout << "Cooked " << (job->kind == CollisionMeshKind::Convex ? "convex hull" : "triangle mesh") << " for "
+				<< job->model_path << " in " << job->cook_ms << " ms" << std::endl;
+	}
+}
+
+void ManagerCollisionMeshes::run() {
+	// Each worker cooks with its own PxCooking
+	PxCookingParams params(ManagerPhysics::gPhysics->getTolerancesScale());
+	params.midphaseDesc.setToDefault(PxMeshMidPhase::eBVH34);
+	params.meshPreprocessParams = PxMeshPreprocessingFlag::eWELD_VERTICES; // Model files repeat vertices per face
+	params.meshWeldTolerance = 0.001f;
+	PxCooking* cooking = PxCreateCooking(PX_PHYSICS_VERSION, ManagerPhysics::gPhysics->getFoundation(), params);
+
+	while (true) {
+		std::unique_ptr<CollisionCookJob> job;
+		{
+			std::unique_lock<std::mutex> lock(job_mutex);
+			job_ready.wait(lock, [] { return stopping || !jobs.empty(); });
+			if (stopping) break;
+			job = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		cook(*cooking, *job);
+		std::lock_guard<std::mutex> lock(job_mutex);
+		finished.push_back(std::move(job));
+	}
+	cooking->release();
+}
+
+void ManagerCollisionMeshes::cook(PxCooking& cooking, CollisionCookJob& job) {
+	auto start = std::chrono::high_resolution_clock::now();
+	PxDefaultMemoryOutputStream out;
+	bool cooked = false;
+	if (job.kind == CollisionMeshKind::Convex) {
+		PxConvexMeshDesc desc;
+		desc.points.count = (PxU32)job.points.size();
+		desc.points.stride = sizeof(PxVec3);
+		desc.points.data = job.points.data();
+		// Dense models are quantized first, the hull only needs their outline
+		desc.flags = PxConvexFlag::eCOMPUTE_CONVEX | PxConvexFlag::eQUANTIZE_INPUT;
+		cooked = !job.points.empty() && cooking.cookConvexMesh(desc, out);
+	}
+	else {
+		PxTriangleMeshDesc desc;
+		desc.points.count = (PxU32)job.points.size();
+		desc.points.stride = sizeof(PxVec3);
+		desc.points.data = job.points.data();
+		desc.triangles.count = (PxU32)(job.indices.size() / 3);
+		desc.triangles.stride = 3 * sizeof(PxU32);
+		desc.triangles.data = job.indices.data();
+		cooked = desc.triangles.count > 0 && cooking.cookTriangleMesh(desc, out);
+	}
+	if (cooked) job.cooked.assign(out.getData(), out.getData() + out.getSize());
+	job.cook_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Written under a temporary name, so a crash mid write never leaves a truncated mesh to load
+	std::string path = cachePath(job.key, job.kind);
+	if (!cooked || path.empty()) return;
+	{
+		std::ofstream file(path + ".tmp", std::ios::binary);
+		file.write(reinterpret_cast<const char*>(job.cooked.data()), job.cooked.size());
+		if (!file) return;
+	}
+	std::error_code error;
+	std::filesystem::rename(path + ".tmp", path, error);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "Vector.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Aftr
+{
+	// Convex hulls can be simulated, triangle meshes only collide as static geometry
+	enum class CollisionMeshKind { Convex, Triangle };
+
+	// A cooked mesh. Its vertices are already scaled, so shapes use it at identity scale
+	struct CollisionMesh {
+		CollisionMeshKind kind = CollisionMeshKind::Convex;
+		physx::PxConvexMesh* convex = nullptr;
+		physx::PxTriangleMesh* triangles = nullptr;
+		physx::PxBounds3 bounds = physx::PxBounds3::empty(); // Local bounds
+
+		// Cooking didn't work out, callers fall back to a box
+		bool failed() const { return convex == nullptr && triangles == nullptr; }
+		physx::PxGeometryHolder geometry() const;
+	};
+
+	// A model's vertices waiting for a worker to cook them
+	struct CollisionCookJob {
+		std::string key;
+		std::string model_path;
+		CollisionMeshKind kind;
+		std::vector<physx::PxVec3> points;
+		std::vector<physx::PxU32> indices; // Triangles only
+		std::vector<physx::PxU8> cooked; // Set by the worker, empty if cooking failed
+		double cook_ms = 0;
+	};
+
+	// This manager is meant to be a singleton that turns Aftr models into cooked PhysX meshes. Cooked meshes
+	// are cached on disk by a hash of the model file, its scale and its kind, so each model is only ever cooked
+	// once. Cooking runs on worker threads, the main thread only creates the finished meshes
+	class ManagerCollisionMeshes {
+		protected:
+			static std::vector<std::thread> workers;
+			static std::mutex job_mutex;
+			static std::condition_variable job_ready;
+			static std::vector<std::unique_ptr<CollisionCookJob>> jobs;
+			static std::vector<std::unique_ptr<CollisionCookJob>> finished;
+			static bool stopping;
+			static std::string cache_dir; // Empty keeps cooked meshes in memory only
+			static std::unordered_map<std::string, std::string> keys; // Model, scale and kind to content key
+			static std::unordered_map<std::string, CollisionMesh> meshes; // By content key
+			static std::set<std::string> cooking; // Content keys queued or on a worker
+
+			static void run();
+			static void cook(physx::PxCooking& cooking, CollisionCookJob& job);
+			static std::string cachePath(const std::string& key, CollisionMeshKind kind);
+			// Creates the mesh from cooked bytes and keeps it under its key
+			static const CollisionMesh* create(const std::string& key, CollisionMeshKind kind, const std::vector<physx::PxU8>& cooked);
+
+		public:
+			// Reads CollisionCacheDir and CollisionCookThreads from aftr.conf and starts the workers
+			static void init();
+			static void shutdown();
+
+			// Main thread. The mesh for a model at a scale, or nullptr while it cooks. The first ask for a model
+			// loads it from the disk cache, or reads its vertices and queues the cook
+			static const CollisionMesh* get(const std::string& model_path, const Vector& scale, CollisionMeshKind kind);
+			// Main thread. Same, but waits for the cook instead of returning nullptr
+			static const CollisionMesh* wait(const std::string& model_path, const Vector& scale, CollisionMeshKind kind);
+			// Main thread. Creates the meshes the workers finished since the last poll
+			static void poll();
+
+			// Hash of the model file, its scale and the mesh kind, changes whenever the cooked mesh would
+			static std::string contentKey(const std::string& model_path, const Vector& scale, CollisionMeshKind kind);
+			// Where other cooked data named this goes next to the meshes, empty if nothing is cached on disk
+			static std::string cacheFile(const std::string& name);
+	};
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include "ManagerLevelGeometry.h"
+#include "extensions/PxCollectionExt.h"
+#include "ManagerCollisionMeshes.h"
+#include "ManagerPhysics.h"
+#include "WO.h"
+#include "Mat4.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+std::vector<LevelCollider> ManagerLevelGeometry::colliders;
+std::vector<PxRigidStatic*> ManagerLevelGeometry::actors;
+PxMaterial* ManagerLevelGeometry::material = nullptr;
+PxSerializationRegistry* ManagerLevelGeometry::registry = nullptr;
+PxCollection* ManagerLevelGeometry::collection = nullptr;
+std::vector<char> ManagerLevelGeometry::collection_memory;
+
+void ManagerLevelGeometry::addCollider(WO* wo, const std::string& model_path, const Vector& scale) {
+	colliders.push_back({ wo, model_path, scale });
+}
+
+PxTransform ManagerLevelGeometry::poseOf(WO* wo) {
+	// Upper 3x3 of the display matrix, the same layout PoseRecord::toDisplayMatrix builds
+	Mat4 m = wo->getDisplayMatrix();
+	PxMat33 rotation(PxVec3(m[0], m[4], m[8]), PxVec3(m[1], m[5], m[9]), PxVec3(m[2], m[6], m[10]));
+	Vector p = wo->getPosition();
+	return PxTransform(PxVec3(p.x, p.y, p.z), PxQuat(rotation).getNormalized());
+}
+
+std::string ManagerLevelGeometry::levelKey() {
+	std::stringstream ss;
+	ss << PX_BINARY_SERIAL_VERSION;
+	for (const LevelCollider& collider : colliders) {
+		PxTransform pose = poseOf(collider.wo);
+		ss << ' ' << ManagerCollisionMeshes::contentKey(collider.model_path, collider.scale, CollisionMeshKind::Triangle)
+			<< ' ' << pose.p.x << ' ' << pose.p.y << ' ' << pose.p.z << ' ' << pose.q.x << ' ' << pose.q.y << ' ' << pose.q.z << ' ' << pose.q.w;
+	}
+	std::stringstream name;
+	name << "level_" << std::hex << std::hash<std::string>()(ss.str()) << ".pxbin";
+	return name.str();
+}
+
+size_t ManagerLevelGeometry::init() {
+	if (colliders.empty()) return 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	registry = PxSerialization::createSerializationRegistry(*ManagerPhysics::gPhysics);
+	std::string path = ManagerCollisionMeshes::cacheFile(levelKey());
+	bool cached = !path.empty() && load(path);
+	if (!cached)
+		build(path);
+	std::cout << "Level geometry: " << actors.size() << " static colliders " << (cached ? "loaded" : "cooked") << " in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+	return actors.size();
+}
+
+bool ManagerLevelGeometry::load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) return false;
+	size_t bytes = (size_t)file.tellg();
+	file.seekg(0);
+	// Binary collections have to start on a PX_SERIAL_FILE_ALIGN boundary
+	collection_memory.resize(bytes + PX_SERIAL_FILE_ALIGN);
+	void* aligned = (void*)(((uintptr_t)collection_memory.data() + PX_SERIAL_FILE_ALIGN - 1) & ~(uintptr_t)(PX_SERIAL_FILE_ALIGN - 1));
+	if (!file.read(static_cast<char*>(aligned), bytes)) {
+		collection_memory.clear();
+		return false;
+	}
+	collection = PxSerialization::createCollectionFromBinary(aligned, *registry);
+	if (collection == nullptr) {
+		collection_memory.clear();
+		return false;
+	}
+
+	// Actors were stored under their collider's index plus one, which is how they find their WOs again
+	PxPruningStructure* pruning = nullptr;
+	for (PxU32 i = 0; i < collection->getNbObjects(); i++) {
+		if (pruning == nullptr) pruning = collection->getObject(i).is<PxPruningStructure>();
+	}
+	for (size_t i = 0; i < colliders.size(); i++) {
+		PxBase* object = collection->find(i + 1);
+		PxRigidStatic* actor = object != nullptr ? object->is<PxRigidStatic>() : nullptr;
+		if (actor == nullptr) continue;
+		actor->userData = colliders[i].wo; // Static geometry keeps its WO in userData
+		actors.push_back(actor);
+	}
+	if (pruning != nullptr) {
+		ManagerPhysics::scene->addActors(*pruning);
+	}
+	else {
+		for (PxRigidStatic* actor : actors)
+			ManagerPhysics::scene->addActor(*actor);
+	}
+	return true;
+}
+
+void ManagerLevelGeometry::build(const std::string& path) {
+	// Ask for every mesh before waiting on any, so the workers cook them side by side
+	for (const LevelCollider& collider : colliders)
+		ManagerCollisionMeshes::get(collider.model_path, collider.scale, CollisionMeshKind::Triangle);
+
+	material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	PxCollection* saving = PxCreateCollection();
+	for (size_t i = 0; i < colliders.size(); i++) {
+		const LevelCollider& collider = colliders[i];
+		const CollisionMesh* mesh = ManagerCollisionMeshes::wait(collider.model_path, collider.scale, CollisionMeshKind::Triangle);
+		if (mesh->failed()) {
+			std::cout << "No collision for " << collider.model_path << ", its mesh didn't cook" << std::endl;
+			continue;
+		}
+		PxRigidStatic* actor = ManagerPhysics::gPhysics->createRigidStatic(poseOf(collider.wo));
+		PxRigidActorExt::createExclusiveShape(*actor, mesh->geometry().any(), *material);
+		actor->userData = collider.wo; // Static geometry keeps its WO in userData
+		actors.push_back(actor);
+		saving->add(*actor, i + 1);
+	}
+	if (actors.empty()) {
+		saving->release();
+		return;
+	}
+
+	// The scene takes the whole level as one prebuilt tree instead of growing its own one actor at a time
+	PxPruningStructure* pruning = ManagerPhysics::gPhysics->createPruningStructure((PxRigidActor* const*)actors.data(), (PxU32)actors.size());
+	if (!path.empty() && pruning != nullptr) {
+		saving->add(*pruning);
+		PxSerialization::complete(*saving, *registry); // Pulls in the shapes, meshes and material
+		bool written = false;
+		{
+			PxDefaultFileOutputStream out((path + ".tmp").c_str());
+			written = out.isValid() && PxSerialization::serializeCollectionToBinary(out, *saving, *registry);
+		}
+		std::error_code error;
+		if (written) std::filesystem::rename(path + ".tmp", path, error);
+		else std::filesystem::remove(path + ".tmp", error);
+	}
+	saving->release();
+
+	if (pruning != nullptr) {
+		ManagerPhysics::scene->addActors(*pruning);
+		pruning->release(); // The scene has what it needs from it
+	}
+	else {
+		for (PxRigidStatic* actor : actors)
+			ManagerPhysics::scene->addActor(*actor);
+	}
+}
+
+void ManagerLevelGeometry::shutdown() {
+	for (PxRigidStatic* actor : actors) {
+		if (actor->getScene() != nullptr) actor->getScene()->removeActor(*actor);
+	}
+	if (collection != nullptr) {
+		// Deserialized objects are released together before the memory they live in goes
+		PxCollectionExt::releaseObjects(*collection);
+		collection->release();
+		collection = nullptr;
+	}
+	else {
+		for (PxRigidStatic* actor : actors)
+			actor->release();
+	}
+	actors.clear();
+	collection_memory.clear();
+	if (material != nullptr) material->release();
+	material = nullptr;
+	if (registry != nullptr) registry->release();
+	registry = nullptr;
+}
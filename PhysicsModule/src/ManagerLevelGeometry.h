@@ -0,0 +1,46 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "Vector.h"
+
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+	class WO;
+
+	// A static WO that collides as its own model's triangles
+	struct LevelCollider {
+		WO* wo;
+		std::string model_path;
+		Vector scale;
+	};
+
+	// This manager is meant to be a singleton that gives the level's static WOs collision. Their models are cooked
+	// into BVH34 triangle meshes and every actor goes into the scene at once through a prebuilt pruning structure.
+	// The finished level, meshes and pruning structure included, is serialized next to the cooked meshes, so
+	// loading the same level again is a single file read
+	class ManagerLevelGeometry {
+		protected:
+			static std::vector<LevelCollider> colliders;
+			static std::vector<physx::PxRigidStatic*> actors;
+			static physx::PxMaterial* material;
+			static physx::PxSerializationRegistry* registry;
+			static physx::PxCollection* collection; // Set when the level came from the cache, owns its objects
+			static std::vector<char> collection_memory; // Deserialized objects live in here until shutdown
+
+			// Everything that decides what the level file holds
+			static std::string levelKey();
+			static bool load(const std::string& path);
+			static void build(const std::string& path);
+			static physx::PxTransform poseOf(WO* wo);
+
+		public:
+			// Before init, usually from loadMap. The WO's pose at init is where it collides
+			static void addCollider(WO* wo, const std::string& model_path, const Vector& scale);
+			// After ManagerCollisionMeshes::init. Returns how many colliders made it into the scene
+			static size_t init();
+			static void shutdown();
+	};
+}
@@ -0,0 +1,207 @@
+#include <chrono>
+#include <set>
+#include "ManagerLookahead.h"
+#include "ManagerPhysics.h"
+#include "ManagerShards.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "WORigidActor.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+std::thread ManagerLookahead::worker;
+std::mutex ManagerLookahead::job_mutex;
+std::condition_variable ManagerLookahead::job_ready;
+std::mutex ManagerLookahead::geometry_mutex;
+std::unique_ptr<LookaheadJob> ManagerLookahead::pending;
+std::vector<std::unique_ptr<LookaheadJob>> ManagerLookahead::finished;
+bool ManagerLookahead::stopping = false;
+unsigned int ManagerLookahead::steps = 240;
+float ManagerLookahead::step_s = 1.0f / 60.0f;
+float ManagerLookahead::radius = 15;
+
+namespace {
+	// Most shapes copied out of the main scene for one prediction
+	const PxU32 MAX_NEIGHBOUR_SHAPES = 4096;
+	// Simulates inline on whichever thread calls simulate, so the worker never waits on another pool
+	PxDefaultCpuDispatcher* inline_dispatcher = nullptr;
+}
+
+void ManagerLookahead::init() {
+	std::string count = ManagerEnvironmentConfiguration::getVariableValue("LookaheadSteps");
+	if (!count.empty()) steps = std::stoul(count);
+	std::string reach = ManagerEnvironmentConfiguration::getVariableValue("LookaheadRadius");
+	if (!reach.empty()) radius = std::stof(reach);
+	inline_dispatcher = PxDefaultCpuDispatcherCreate(0);
+	stopping = false;
+	worker = std::thread(run);
+}
+
+void ManagerLookahead::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		stopping = true;
+	}
+	job_ready.notify_all();
+	if (worker.joinable()) worker.join();
+	pending.reset();
+	finished.clear();
+	if (inline_dispatcher != nullptr) inline_dispatcher->release();
+	inline_dispatcher = nullptr;
+}
+
+void ManagerLookahead::predictDrop(const PxVec3& half_extents, float density, const PxTransform& pose, const PxVec3& velocity, LookaheadCallback on_done) {
+	std::unique_ptr<LookaheadJob> job(new LookaheadJob());
+	job->half_extents = half_extents;
+	job->density = density;
+	job->pose = pose;
+	job->velocity = velocity;
+	job->gravity = ManagerPhysics::scene->getGravity();
+	job->on_done = std::move(on_done);
+
+	// Everything in a column around the fall, from above the drop point to below the ground
+	float low = -radius, high = pose.p.z + radius;
+	PxBoxGeometry column(radius, radius, (high - low) / 2);
+	PxTransform column_pose(PxVec3(pose.p.x, pose.p.y, (high + low) / 2));
+	std::vector<PxOverlapHit> hits(MAX_NEIGHBOUR_SHAPES);
+	PxU32 touches = ManagerShards::overlap(column, column_pose, hits.data(), (PxU32)hits.size());
+
+	std::set<PxRigidActor*> copied;
+	for (PxU32 i = 0; i < touches; i++) {
+		PxRigidActor* actor = hits[i].actor;
+		if (!copied.insert(actor).second) continue;
+		LookaheadBody body;
+		body.pose = actor->getGlobalPose();
+		PxRigidDynamic* dynamic = actor->is<PxRigidDynamic>();
+		// Kinematics can't be pushed, so they're as good as static for a short prediction
+		if (dynamic != nullptr && !(dynamic->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)) {
+			body.dynamic = true;
+			body.linear_velocity = dynamic->getLinearVelocity();
+			body.angular_velocity = dynamic->getAngularVelocity();
+			body.mass = dynamic->getMass();
+			body.inertia = dynamic->getMassSpaceInertiaTensor();
+			body.mass_pose = dynamic->getCMassLocalPose();
+			if (dynamic->userData != nullptr)
+				body.id = static_cast<WORigidActor*>(dynamic->userData)->id;
+		}
+		std::vector<PxShape*> shapes(actor->getNbShapes());
+		actor->getShapes(shapes.data(), (PxU32)shapes.size());
+		for (PxShape* shape : shapes) {
+			LookaheadShape copy;
+			copy.geometry = shape->getGeometry();
+			copy.local = shape->getLocalPose();
+			shape->getMaterials(&copy.material, 1);
+			body.shapes.push_back(copy);
+		}
+		job->bodies.push_back(std::move(body));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		pending = std::move(job);
+	}
+	job_ready.notify_one();
+}
+
+void ManagerLookahead::poll() {
+	std::vector<std::unique_ptr<LookaheadJob>> done;
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		done.swap(finished);
+	}
+	for (std::unique_ptr<LookaheadJob>& job : done) {
+		if (job->on_done) job->on_done(job->result);
+	}
+}
+
+void ManagerLookahead::run() {
+	while (true) {
+		std::unique_ptr<LookaheadJob> job;
+		{
+			std::unique_lock<std::mutex> lock(job_mutex);
+			job_ready.wait(lock, [] { return stopping || pending != nullptr; });
+			if (stopping) return;
+			job = std::move(pending);
+		}
+		{
+			std::lock_guard<std::mutex> geometry(geometry_mutex);
+			simulate(*job);
+		}
+		std::lock_guard<std::mutex> lock(job_mutex);
+		finished.push_back(std::move(job));
+	}
+}
+
+void ManagerLookahead::simulate(LookaheadJob& job) {
+	auto start = std::chrono::high_resolution_clock::now();
+	PxPhysics* physics = ManagerPhysics::gPhysics;
+	PxSceneDesc desc(physics->getTolerancesScale());
+	desc.gravity = job.gravity;
+	desc.cpuDispatcher = inline_dispatcher;
+	desc.filterShader = PxDefaultSimulationFilterShader;
+	PxScene* scene = physics->createScene(desc);
+
+	// Rebuild the neighbourhood as it was when the prediction was asked for
+	std::vector<PxRigidActor*> actors;
+	std::vector<std::pair<int, PxRigidDynamic*>> neighbours;
+	for (const LookaheadBody& body : job.bodies) {
+		PxRigidActor* actor = nullptr;
+		if (body.dynamic) {
+			PxRigidDynamic* dynamic = physics->createRigidDynamic(body.pose);
+			dynamic->setMass(body.mass);
+			dynamic->setMassSpaceInertiaTensor(body.inertia);
+			dynamic->setCMassLocalPose(body.mass_pose);
+			dynamic->setLinearVelocity(body.linear_velocity);
+			dynamic->setAngularVelocity(body.angular_velocity);
+			if (body.id >= 0) neighbours.push_back(std::make_pair(body.id, dynamic));
+			actor = dynamic;
+		}
+		else {
+			actor = physics->createRigidStatic(body.pose);
+		}
+		for (const LookaheadShape& copy : body.shapes) {
+			PxShape* shape = physics->createShape(copy.geometry.any(), *copy.material, true);
+			shape->setLocalPose(copy.local);
+			actor->attachShape(*shape);
+			shape->release();
+		}
+		scene->addActor(*actor);
+		actors.push_back(actor);
+	}
+
+	// Same surface as every spawned box
+	PxMaterial* material = physics->createMaterial(0.5f, 0.3f, 0.2f);
+	PxRigidDynamic* drop = PxCreateDynamic(*physics, job.pose, PxBoxGeometry(job.half_extents), *material, job.density);
+	drop->setLinearVelocity(job.velocity);
+	scene->addActor(*drop);
+	actors.push_back(drop);
+
+	// Run until the box settles or the steps run out
+	LookaheadResult& result = job.result;
+	result.path.reserve(steps);
+	unsigned int still_steps = 0;
+	for (unsigned int i = 0; i < steps; i++) {
+		scene->simulate(step_s);
+		scene->fetchResults(true);
+		result.path.push_back(drop->getGlobalPose().p);
+		still_steps = drop->getLinearVelocity().magnitudeSquared() < 0.01f ? still_steps + 1 : 0;
+		if (drop->isSleeping() || still_steps >= 15) {
+			result.settled = true;
+			break;
+		}
+	}
+	result.rest = drop->getGlobalPose();
+	for (const std::pair<int, PxRigidDynamic*>& neighbour : neighbours)
+		result.neighbours.push_back(std::make_pair(neighbour.first, neighbour.second->getGlobalPose()));
+
+	for (PxRigidActor* actor : actors)
+		actor->release();
+	scene->release();
+	material->release();
+	result.compute_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::unique_lock<std::mutex> ManagerLookahead::lockGeometry() {
+	return std::unique_lock<std::mutex>(geometry_mutex);
+}
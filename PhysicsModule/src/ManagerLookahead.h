@@ -0,0 +1,91 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Aftr
+{
+	// One shape of a copied actor
+	struct LookaheadShape {
+		physx::PxGeometryHolder geometry;
+		physx::PxTransform local;
+		physx::PxMaterial* material;
+	};
+
+	// An actor copied out of the main scene, everything the worker needs to rebuild it
+	struct LookaheadBody {
+		int id = -1; // Object id for spawned objects, -1 for everything else
+		bool dynamic = false;
+		physx::PxTransform pose;
+		physx::PxVec3 linear_velocity = physx::PxVec3(0, 0, 0);
+		physx::PxVec3 angular_velocity = physx::PxVec3(0, 0, 0);
+		float mass = 0;
+		physx::PxVec3 inertia = physx::PxVec3(0, 0, 0);
+		physx::PxTransform mass_pose = physx::PxTransform(physx::PxIdentity);
+		std::vector<LookaheadShape> shapes;
+	};
+
+	// What a lookahead predicts for a box dropped into the current scene
+	struct LookaheadResult {
+		std::vector<physx::PxVec3> path; // Where the dropped box is after every step
+		physx::PxTransform rest; // Its final pose
+		bool settled = false; // Came to rest before the steps ran out
+		std::vector<std::pair<int, physx::PxTransform>> neighbours; // Final poses of the copied objects, by object id
+		double compute_ms = 0;
+	};
+
+	typedef std::function<void(const LookaheadResult& result)> LookaheadCallback;
+
+	// A drop waiting for the worker
+	struct LookaheadJob {
+		std::vector<LookaheadBody> bodies;
+		physx::PxVec3 half_extents;
+		float density;
+		physx::PxTransform pose;
+		physx::PxVec3 velocity;
+		physx::PxVec3 gravity;
+		LookaheadCallback on_done;
+		LookaheadResult result;
+	};
+
+	// This manager is meant to be a singleton that predicts where a dropped box will land. The neighbourhood
+	// of the drop is copied out of the main scene and simulated in a private scene on a worker thread, so
+	// ManagerPhysics::scene is never touched off the main thread and keeps stepping at full rate
+	class ManagerLookahead {
+		protected:
+			static std::thread worker;
+			static std::mutex job_mutex;
+			static std::condition_variable job_ready;
+			static std::mutex geometry_mutex; // Held while the worker simulates
+			static std::unique_ptr<LookaheadJob> pending; // Newest request, replaces any the worker hasn't started
+			static std::vector<std::unique_ptr<LookaheadJob>> finished; // Waiting for poll
+			static bool stopping;
+			static unsigned int steps; // Most steps to look ahead
+			static float step_s;
+			static float radius; // Objects this far from the drop column are copied
+
+			static void run();
+			static void simulate(LookaheadJob& job);
+
+		public:
+			// Reads LookaheadSteps and LookaheadRadius from aftr.conf and starts the worker
+			static void init();
+			static void shutdown();
+
+			// Main thread, with the scene idle. Copies the neighbourhood and queues the prediction.
+			// Only the newest request the worker hasn't started runs, older ones are never called back
+			static void predictDrop(const physx::PxVec3& half_extents, float density, const physx::PxTransform& pose,
+				const physx::PxVec3& velocity, LookaheadCallback on_done);
+			// Main thread. Calls back with every prediction finished since the last poll
+			static void poll();
+			// Copied shapes still point at the main scene's meshes and heightfields. Hold this while editing one
+			static std::unique_lock<std::mutex> lockGeometry();
+	};
+}
@@ -1,6 +1,12 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include "ManagerPhysics.h"
+#include "ManagerShards.h"
+#include "extensions/PxRaycastCCD.h"
+#include "NetTelemetry.h"
 #include "AftrGlobals.h"
+#include "ManagerEnvironmentConfiguration.h"
 
 using namespace Aftr;
 using namespace physx;
@@ -13,11 +19,26 @@ PxPhysics* ManagerPhysics::gPhysics = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoun
 PxSceneDesc ManagerPhysics::gSceneDesc(gPhysics->getTolerancesScale());
 PxDefaultCpuDispatcher* ManagerPhysics::gCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
 PxScene* ManagerPhysics::scene;
+float ManagerPhysics::step_ms = 0;
+unsigned int ManagerPhysics::max_substeps = 8;
+double ManagerPhysics::ms_unsimulated = 0;
+float ManagerPhysics::step_s = 0;
+uint64_t ManagerPhysics::steps = 0;
+double ManagerPhysics::sim_time_s = 0;
+PoseSnapshotBuffer ManagerPhysics::snapshots;
+CCDMode ManagerPhysics::ccd_mode = CCDMode::None;
+float ManagerPhysics::ccd_speed = 0;
+std::unordered_map<PxScene*, RaycastCCDScene> ManagerPhysics::raycast_ccd;
+std::unordered_map<PxRigidDynamic*, PxShape*> ManagerPhysics::raycast_bodies;
 
 void ManagerPhysics::init() {
 	// Initialize the engine
 	gSceneDesc.cpuDispatcher = gCpuDispatcher;
-	gSceneDesc.filterShader = PxDefaultSimulationFilterShader;
+	gSceneDesc.filterShader = filterShader;
+	gSceneDesc.flags |= PxSceneFlag::eENABLE_CCD; // Swept CCD is opt in per body, so this alone costs nothing
+	// Kinematic sensors have to reach the static triggers, filterShader drops the solid pairs again
+	gSceneDesc.staticKineFilteringMode = PxPairFilteringMode::eKEEP;
+	PxInitExtensions(*gPhysics, nullptr); // Joints live in the extensions
 	scene = gPhysics->createScene(gSceneDesc);
 	scene->setFlag(PxSceneFlag::eENABLE_ACTIVE_ACTORS, true);
 	// If it didn't start, display an error message
@@ -31,6 +52,11 @@ void ManagerPhysics::init() {
 
 void ManagerPhysics::shutdown() {
 	// Drop the engine, opposite of init
+	for (const auto& shard : raycast_ccd)
+		delete shard.second.manager;
+	raycast_ccd.clear();
+	raycast_bodies.clear();
+	PxCloseExtensions();
 	if (gFoundation != nullptr) gFoundation->release();
 	if (gPhysics != nullptr) gPhysics->release();
 	if (scene != nullptr) scene->release();
@@ -39,4 +65,209 @@ void ManagerPhysics::shutdown() {
 void ManagerPhysics::addActorBind(void* pointer, physx::PxActor* actor) {
 	actor->userData = pointer; // Bind this object in the physx world to something
 	scene->addActor(*actor);
-}
\ No newline at end of file
+}
+
+void ManagerPhysics::initStepping() {
+	std::string step = ManagerEnvironmentConfiguration::getVariableValue("PhysicsStepMs");
+	if (!step.empty()) step_ms = std::max(0.0f, std::stof(step));
+	std::string substeps = ManagerEnvironmentConfiguration::getVariableValue("PhysicsMaxSubsteps");
+	if (!substeps.empty()) max_substeps = std::max(1ul, std::stoul(substeps));
+	ccd_mode = parseCCDMode(ManagerEnvironmentConfiguration::getVariableValue("PhysicsCCD"));
+	std::string speed = ManagerEnvironmentConfiguration::getVariableValue("PhysicsCCDSpeed");
+	if (!speed.empty()) ccd_speed = std::max(0.0f, std::stof(speed));
+}
+
+unsigned int ManagerPhysics::beginFrame(double frame_ms) {
+	rebuildRaycastCCD();
+	// Variable step, the old behaviour
+	if (step_ms <= 0) {
+		step_s = (float)(frame_ms / 1000.0);
+		return 1;
+	}
+	ms_unsimulated += frame_ms;
+	unsigned int substeps = (unsigned int)(ms_unsimulated / step_ms);
+	if (substeps > max_substeps) {
+		// Too far behind to catch up, let the simulation run slow instead of spiraling
+		substeps = max_substeps;
+		ms_unsimulated = 0;
+	}
+	else {
+		ms_unsimulated -= substeps * step_ms;
+	}
+	step_s = step_ms / 1000.0f;
+	return substeps;
+}
+
+void ManagerPhysics::simulateStep() {
+	auto start = std::chrono::high_resolution_clock::now();
+	ManagerShards::simulate(step_s);
+	updateCCD();
+	ManagerShards::migrate();
+	NetTelemetry::recordStep(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+	steps++;
+	sim_time_s += step_s;
+}
+
+void ManagerPhysics::publishSnapshot() {
+	snapshots.publish(steps, sim_time_s);
+}
+
+float ManagerPhysics::getStepSeconds() {
+	return step_s;
+}
+
+uint64_t ManagerPhysics::getStepCount() {
+	return steps;
+}
+
+PxActor** ManagerPhysics::getActiveActors(PxU32& count) {
+	return ManagerShards::getActiveActors(count);
+}
+
+CCDMode ManagerPhysics::parseCCDMode(const std::string& name) {
+	if (name == "speculative") return CCDMode::Speculative;
+	if (name == "sweep") return CCDMode::Sweep;
+	if (name == "raycast") return CCDMode::Raycast;
+	return CCDMode::None;
+}
+
+const char* ManagerPhysics::toString(CCDMode mode) {
+	switch (mode) {
+	case CCDMode::Speculative: return "speculative";
+	case CCDMode::Sweep: return "sweep";
+	case CCDMode::Raycast: return "raycast";
+	default: return "none";
+	}
+}
+
+CCDMode ManagerPhysics::getCCDMode() {
+	return ccd_mode;
+}
+
+float ManagerPhysics::getCCDSpeed() {
+	return ccd_speed;
+}
+
+namespace {
+	// A body the solver moves, not a static or a kinematic
+	bool isSimulated(PxFilterObjectAttributes attributes) {
+		PxFilterObjectType::Enum type = PxGetFilterObjectType(attributes);
+		if (type == PxFilterObjectType::eARTICULATION) return true;
+		return type == PxFilterObjectType::eRIGID_DYNAMIC && !PxFilterObjectIsKinematic(attributes);
+	}
+}
+
+PxFilterFlags ManagerPhysics::filterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+	PxFilterObjectAttributes attributes1, PxFilterData filterData1, PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize) {
+	bool trigger = PxFilterObjectIsTrigger(attributes0) || PxFilterObjectIsTrigger(attributes1);
+	if (!trigger) {
+		// Nothing would respond to a contact between a kinematic and a static, or to one with a sensor
+		if (!isSimulated(attributes0) && !isSimulated(attributes1)) return PxFilterFlag::eKILL;
+		if ((filterData0.word1 | filterData1.word1) & SENSOR_FILTER) return PxFilterFlag::eKILL;
+	}
+	PxFilterFlags flags = PxDefaultSimulationFilterShader(attributes0, filterData0, attributes1, filterData1, pairFlags, constantBlock, constantBlockSize);
+	if (!trigger) {
+		pairFlags |= PxPairFlag::eDETECT_CCD_CONTACT;
+		if (constantBlockSize == sizeof(PxPairFlags))
+			pairFlags |= *static_cast<const PxPairFlags*>(constantBlock);
+	}
+	return flags;
+}
+
+void ManagerPhysics::setReportFlags(PxPairFlags flags) {
+	// The scene keeps its own copy for the shader, and so does every shard
+	scene->setFilterShaderData(&flags, sizeof(PxPairFlags));
+	for (PxScene* shard : ManagerShards::getScenes()) {
+		if (shard != scene) shard->setFilterShaderData(&flags, sizeof(PxPairFlags));
+	}
+}
+
+void ManagerPhysics::classifyCCD(PxRigidDynamic* body, CCDMode mode, float speed) {
+	PxRigidBodyFlags flags = body->getRigidBodyFlags();
+	bool fast = body->getLinearVelocity().magnitude() > speed || speed <= 0;
+	if (mode == CCDMode::Speculative) {
+		if (fast != (bool)(flags & PxRigidBodyFlag::eENABLE_SPECULATIVE_CCD))
+			body->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_SPECULATIVE_CCD, fast);
+	}
+	// Kinematics can't be swept
+	else if (mode == CCDMode::Sweep && !(flags & PxRigidBodyFlag::eKINEMATIC)) {
+		if (fast != (bool)(flags & PxRigidBodyFlag::eENABLE_CCD))
+			body->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, fast);
+	}
+}
+
+void ManagerPhysics::addCCDBody(PxRigidDynamic* body) {
+	if (ccd_mode == CCDMode::Raycast) {
+		// Raycast CCD has no velocity classes, every registered body is checked every step
+		PxShape* shape = nullptr;
+		body->getShapes(&shape, 1);
+		if (shape == nullptr) return;
+		raycast_bodies[body] = shape;
+		raycastCCDOf(body).manager->registerRaycastCCDObject(body, shape);
+	}
+	else if (ccd_mode != CCDMode::None) {
+		classifyCCD(body, ccd_mode, ccd_speed);
+	}
+}
+
+void ManagerPhysics::removeCCDBody(PxRigidActor* body) {
+	if (ccd_mode != CCDMode::Raycast || body->is<PxRigidDynamic>() == nullptr) return;
+	auto found = raycast_bodies.find(body->is<PxRigidDynamic>());
+	if (found == raycast_bodies.end()) return;
+	raycastCCDOf(found->first).stale = true;
+	raycast_bodies.erase(found);
+}
+
+void ManagerPhysics::moveCCDBody(PxRigidDynamic* body, PxScene* from) {
+	auto found = raycast_bodies.find(body);
+	if (ccd_mode != CCDMode::Raycast || found == raycast_bodies.end()) return;
+	// The old scene would keep raying from where the body left
+	raycast_ccd[from].stale = true;
+	raycastCCDOf(body).manager->registerRaycastCCDObject(body, found->second);
+}
+
+namespace {
+	// Spawns are registered before they're flushed into their scene
+	PxScene* ccdSceneOf(PxRigidDynamic* body) {
+		return body->getScene() != nullptr ? body->getScene() : ManagerShards::getSceneAt(body->getGlobalPose().p);
+	}
+}
+
+RaycastCCDScene& ManagerPhysics::raycastCCDOf(PxRigidDynamic* body) {
+	PxScene* in = ccdSceneOf(body);
+	RaycastCCDScene& shard = raycast_ccd[in];
+	if (shard.manager == nullptr) shard.manager = new RaycastCCDManager(in);
+	return shard;
+}
+
+void ManagerPhysics::rebuildRaycastCCD() {
+	for (auto& shard : raycast_ccd) {
+		if (!shard.second.stale) continue;
+		delete shard.second.manager;
+		shard.second.manager = new RaycastCCDManager(shard.first);
+		shard.second.stale = false;
+		for (const auto& registered : raycast_bodies) {
+			if (ccdSceneOf(registered.first) == shard.first)
+				shard.second.manager->registerRaycastCCDObject(registered.first, registered.second);
+		}
+	}
+}
+
+void ManagerPhysics::updateCCD() {
+	if (ccd_mode == CCDMode::Raycast) {
+		// A stale one still holds a body that left, so it sits out the rest of the frame rather than being rebuilt every step
+		for (const auto& shard : raycast_ccd) {
+			if (!shard.second.stale && shard.second.manager != nullptr)
+				shard.second.manager->doRaycastCCD(true);
+		}
+	}
+	// Only bodies that moved can have changed class, and the active list is exactly those
+	else if (ccd_mode != CCDMode::None && ccd_speed > 0) {
+		PxU32 count = 0;
+		PxActor** active = getActiveActors(count);
+		for (PxU32 i = 0; i < count; i++) {
+			PxRigidDynamic* body = active[i]->is<PxRigidDynamic>();
+			if (body != nullptr) classifyCCD(body, ccd_mode, ccd_speed);
+		}
+	}
+}
@@ -2,9 +2,28 @@
 
 #include "PxPhysicsAPI.h"
 #include "WO.h"
+#include "PoseSnapshotBuffer.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace physx
+{
+	class RaycastCCDManager;
+}
 
 namespace Aftr
 {
+	// How fast bodies are kept from tunnelling through thin geometry between steps
+	enum class CCDMode { None, Speculative, Sweep, Raycast };
+
+	// Raycast CCD of one shard scene. It can only ray against its own scene, so each shard gets one
+	struct RaycastCCDScene {
+		physx::RaycastCCDManager* manager = nullptr;
+		bool stale = false; // A body left, the manager has no way to forget one so it's rebuilt next frame
+	};
+
 	// This manager is meant to be a singleton container for the PhysX Scene class
 	class ManagerPhysics {
 		protected:
@@ -13,16 +32,73 @@ namespace Aftr
 			static physx::PxFoundation* gFoundation;
 			static physx::PxSceneDesc gSceneDesc;
 			static physx::PxDefaultCpuDispatcher* gCpuDispatcher;
+			static float step_ms; // Fixed substep length, 0 means one step per frame as long as the frame
+			static unsigned int max_substeps; // Time beyond this many substeps in one frame is dropped
+			static double ms_unsimulated; // Leftover time that didn't fill a whole substep
+			static float step_s; // Length of the substeps handed out by the last beginFrame
+			static uint64_t steps; // Substeps simulated so far
+			static double sim_time_s;
+			static CCDMode ccd_mode;
+			static float ccd_speed; // Bodies faster than this get CCD, 0 gives it to every body
+			static std::unordered_map<physx::PxScene*, RaycastCCDScene> raycast_ccd;
+			static std::unordered_map<physx::PxRigidDynamic*, physx::PxShape*> raycast_bodies;
+
+			// Moves the active bodies between velocity classes and runs raycast CCD, after every step
+			static void updateCCD();
+			// Once a frame at most, however many bodies left during it
+			static void rebuildRaycastCCD();
+			// Raycast CCD of the scene the body is in, or is about to go into, created on first use
+			static RaycastCCDScene& raycastCCDOf(physx::PxRigidDynamic* body);
 			
 		public:
 			// Initialize the engine
 			static void init();
+			// Reads PhysicsStepMs, PhysicsMaxSubsteps, PhysicsCCD and PhysicsCCDSpeed, must be called once aftr.conf is loaded
+			static void initStepping();
+			// Returns how many substeps to run for this frame. Also where raycast CCD catches up on bodies that left
+			static unsigned int beginFrame(double frame_ms);
+			// Advance every shard one substep and wait for the results
+			static void simulateStep();
+			static float getStepSeconds();
+			// Substeps completed so far
+			static uint64_t getStepCount();
+			// Bodies that moved during the last substep, in whichever shard they are. Valid until the next one
+			static physx::PxActor** getActiveActors(physx::PxU32& count);
+			// Publish the poses recorded into snapshots since the last step, call after every simulateStep
+			static void publishSnapshot();
 			// Drops the engine
 			static void shutdown();
 			// Add an object to the scene and bind it to a WO
 			static void addActorBind(void* pointer, physx::PxActor* actor);
 
+			// A new dynamic body gets whatever CCD is configured. Call removeCCDBody before releasing it. With raycast
+			// CCD, nothing gets it from a removal until the next frame starts
+			static void addCCDBody(physx::PxRigidDynamic* body);
+			static void removeCCDBody(physx::PxRigidActor* body);
+			// ManagerShards moved the body here from another scene
+			static void moveCCDBody(physx::PxRigidDynamic* body, physx::PxScene* from);
+			static CCDMode getCCDMode();
+			static float getCCDSpeed();
+			// none, speculative, sweep or raycast
+			static CCDMode parseCCDMode(const std::string& name);
+			static const char* toString(CCDMode mode);
+			// Turns a body's speculative or swept CCD flag on when it moves faster than speed, off otherwise
+			static void classifyCCD(physx::PxRigidDynamic* body, CCDMode mode, float speed);
+			// Extra report flags every solid pair gets from filterShader. Only pairs that form afterwards pick them up
+			static void setReportFlags(physx::PxPairFlags flags);
+			// The default shader, but pairs also report swept CCD contacts and whatever setReportFlags asked for.
+			// Only bodies flagged for CCD pay for the CCD contacts. Solid pairs without a simulated body and
+			// sensors outside triggers are dropped
+			static physx::PxFilterFlags filterShader(physx::PxFilterObjectAttributes attributes0, physx::PxFilterData filterData0,
+				physx::PxFilterObjectAttributes attributes1, physx::PxFilterData filterData1,
+				physx::PxPairFlags& pairFlags, const void* constantBlock, physx::PxU32 constantBlockSize);
+
+			// In word1 of a shape's simulation filter data, the shape only ever touches triggers
+			static const physx::PxU32 SENSOR_FILTER = 1;
+
 			static physx::PxPhysics* gPhysics;
 			static physx::PxScene* scene;
+			// Latest completed step, readable from any thread without touching the scene once subscribed
+			static PoseSnapshotBuffer snapshots;
 	};
 }
\ No newline at end of file
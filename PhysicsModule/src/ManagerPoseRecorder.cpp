@@ -0,0 +1,64 @@
+#include <iostream>
+#include <chrono>
+#include "ManagerPoseRecorder.h"
+#include "ManagerPhysics.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+
+// These line are required to use as a singleton
+std::thread ManagerPoseRecorder::worker;
+std::atomic<bool> ManagerPoseRecorder::stopping(false);
+std::ofstream ManagerPoseRecorder::file;
+std::string ManagerPoseRecorder::path;
+uint64_t ManagerPoseRecorder::steps_written = 0;
+uint64_t ManagerPoseRecorder::steps_missed = 0;
+
+void ManagerPoseRecorder::init() {
+	path = ManagerEnvironmentConfiguration::getVariableValue("PoseRecordFile");
+	if (path.empty()) return;
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cout << "Unable to open " << path << ", not recording poses" << std::endl;
+		return;
+	}
+	// Subscribed before the first step, so publish starts copying right away
+	ManagerPhysics::snapshots.subscribe();
+	stopping = false;
+	steps_written = 0;
+	steps_missed = 0;
+	worker = std::thread(run);
+}
+
+void ManagerPoseRecorder::shutdown() {
+	if (!worker.joinable()) return;
+	stopping = true;
+	worker.join();
+	ManagerPhysics::snapshots.unsubscribe();
+	file.close();
+	std::cout << "Recorded " << steps_written << " steps to " << path << ", " << steps_missed << " missed while writing, "
+		<< ManagerPhysics::snapshots.getSkipped() << " not published because every buffer was held" << std::endl;
+}
+
+void ManagerPoseRecorder::run() {
+	uint64_t last_step = 0;
+	while (!stopping) {
+		{
+			PoseSnapshotRead snapshot = ManagerPhysics::snapshots.acquire();
+			if (snapshot && snapshot->step != last_step) {
+				if (last_step != 0 && snapshot->step > last_step + 1)
+					steps_missed += snapshot->step - last_step - 1;
+				last_step = snapshot->step;
+				uint32_t count = (uint32_t)snapshot->records.size();
+				file.write((const char*)&snapshot->step, sizeof(snapshot->step));
+				file.write((const char*)&snapshot->time_s, sizeof(snapshot->time_s));
+				file.write((const char*)&count, sizeof(count));
+				file.write((const char*)snapshot->records.data(), count * sizeof(PoseSnapshotRecord));
+				steps_written++;
+				continue;
+			}
+		}
+		// Nothing new yet, a physics step is several milliseconds
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace Aftr
+{
+	// This manager is meant to be a singleton that writes every completed physics step to disk. It reads
+	// ManagerPhysics::snapshots on its own thread, so the file I/O never holds up the simulation. Each step is
+	// its uint64 step count, double simulated seconds, uint32 record count and then the raw PoseSnapshotRecords
+	class ManagerPoseRecorder {
+		protected:
+			static std::thread worker;
+			static std::atomic<bool> stopping;
+			static std::ofstream file;
+			static std::string path;
+			static uint64_t steps_written;
+			static uint64_t steps_missed; // Published while the worker was still writing an earlier one
+
+			static void run();
+
+		public:
+			// Starts recording to PoseRecordFile from aftr.conf, if it names one
+			static void init();
+			static void shutdown();
+	};
+}
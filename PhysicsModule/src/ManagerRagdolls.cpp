@@ -0,0 +1,283 @@
+#include <iostream>
+#include <algorithm>
+#include "ManagerRagdolls.h"
+#include "ManagerPhysics.h"
+#include "ManagerSimulationEvents.h"
+#include "ManagerSceneCommands.h"
+#include "ManagerReplication.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "WorldContainer.h"
+#include "Model.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+std::vector<ManagerRagdolls::Ragdoll> ManagerRagdolls::ragdolls;
+std::vector<size_t> ManagerRagdolls::articulated;
+std::unordered_map<const PxActor*, size_t> ManagerRagdolls::by_proxy;
+std::unordered_map<const PxActor*, size_t> ManagerRagdolls::by_link;
+PxMaterial* ManagerRagdolls::material = nullptr;
+float ManagerRagdolls::lod_distance = 60;
+float ManagerRagdolls::settle_speed = 0.5f;
+float ManagerRagdolls::wake_margin = 0.5f;
+double ManagerRagdolls::lod_ms = 250;
+double ManagerRagdolls::ms_since_lod = 0;
+int ManagerRagdolls::reader = -1;
+std::vector<SimulationEvent> ManagerRagdolls::events;
+
+namespace {
+	// One box per body part, standing upright around the pelvis. Joints sit where neighbouring boxes meet
+	struct LinkSpec {
+		int parent;
+		PxVec3 center;
+		PxVec3 half_extents;
+		PxVec3 joint;
+		PxArticulationJointType::Enum type;
+		float low, high; // Twist limits, about the hinge for elbows and knees and along the bone otherwise
+		float swing; // Both swing limits of a spherical joint
+	};
+
+	const PxArticulationJointType::Enum BALL = PxArticulationJointType::eSPHERICAL;
+	const PxArticulationJointType::Enum HINGE = PxArticulationJointType::eREVOLUTE;
+	const LinkSpec LINKS[] = {
+		{ -1, PxVec3(0, 0, 0), PxVec3(0.16f, 0.1f, 0.1f), PxVec3(0), BALL, 0, 0, 0 }, // Pelvis
+		{ 0, PxVec3(0, 0, 0.32f), PxVec3(0.19f, 0.11f, 0.2f), PxVec3(0, 0, 0.11f), BALL, -0.4f, 0.4f, 0.5f }, // Chest
+		{ 1, PxVec3(0, 0, 0.66f), PxVec3(0.1f, 0.1f, 0.12f), PxVec3(0, 0, 0.53f), BALL, -0.8f, 0.8f, 0.6f }, // Head
+		{ 1, PxVec3(-0.27f, 0, 0.33f), PxVec3(0.06f, 0.06f, 0.15f), PxVec3(-0.27f, 0, 0.48f), BALL, -1.0f, 1.0f, 1.4f }, // Arms
+		{ 3, PxVec3(-0.27f, 0, 0.04f), PxVec3(0.05f, 0.05f, 0.14f), PxVec3(-0.27f, 0, 0.18f), HINGE, 0, 2.4f, 0 },
+		{ 1, PxVec3(0.27f, 0, 0.33f), PxVec3(0.06f, 0.06f, 0.15f), PxVec3(0.27f, 0, 0.48f), BALL, -1.0f, 1.0f, 1.4f },
+		{ 5, PxVec3(0.27f, 0, 0.04f), PxVec3(0.05f, 0.05f, 0.14f), PxVec3(0.27f, 0, 0.18f), HINGE, 0, 2.4f, 0 },
+		{ 0, PxVec3(-0.1f, 0, -0.3f), PxVec3(0.07f, 0.07f, 0.2f), PxVec3(-0.1f, 0, -0.1f), BALL, -0.4f, 0.4f, 1.2f }, // Legs
+		{ 7, PxVec3(-0.1f, 0, -0.7f), PxVec3(0.06f, 0.06f, 0.2f), PxVec3(-0.1f, 0, -0.5f), HINGE, -2.4f, 0, 0 },
+		{ 0, PxVec3(0.1f, 0, -0.3f), PxVec3(0.07f, 0.07f, 0.2f), PxVec3(0.1f, 0, -0.1f), BALL, -0.4f, 0.4f, 1.2f },
+		{ 9, PxVec3(0.1f, 0, -0.7f), PxVec3(0.06f, 0.06f, 0.2f), PxVec3(0.1f, 0, -0.5f), HINGE, -2.4f, 0, 0 },
+	};
+	const size_t LINK_COUNT = sizeof(LINKS) / sizeof(LINKS[0]);
+	const size_t CHEST = 1; // Drawn with human_chest, everything else with the red cube
+	const float DENSITY = 1000;
+	// Hinges turn about x, sideways. Ball joints twist about x too, so it's turned to run along the bone
+	const PxQuat ALONG_BONE(-PxHalfPi, PxVec3(0, 1, 0));
+
+	PoseRecord toPose(int id, const PxTransform& t) {
+		PxMat33 rotation(t.q);
+		PoseRecord pose;
+		pose.id = id;
+		pose.location[0] = t.p.x;
+		pose.location[1] = t.p.y;
+		pose.location[2] = t.p.z;
+		for (int row = 0; row < 3; row++)
+			for (int col = 0; col < 3; col++)
+				pose.rotation[row * 3 + col] = rotation(row, col);
+		return pose;
+	}
+}
+
+void ManagerRagdolls::init() {
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("RagdollLodDistance");
+	if (!value.empty()) lod_distance = std::max(0.0f, std::stof(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("RagdollSettleSpeed");
+	if (!value.empty()) settle_speed = std::max(0.0f, std::stof(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("RagdollWakeMargin");
+	if (!value.empty()) wake_margin = std::max(0.0f, std::stof(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("RagdollLodMs");
+	if (!value.empty()) lod_ms = std::max(0.0f, std::stof(value));
+
+	material = ManagerPhysics::gPhysics->createMaterial(0.6f, 0.5f, 0.1f);
+	// A proxy only knows it was hit through its trigger, so without them every ragdoll stays articulated
+	reader = ManagerSimulationEvents::reportsTriggers() ? ManagerSimulationEvents::subscribe() : -1;
+	if (reader < 0)
+		std::cout << "Ragdolls need trigger events in SimEventTypes and a free event reader, they won't switch to proxies" << std::endl;
+}
+
+void ManagerRagdolls::shutdown() {
+	ManagerSimulationEvents::unsubscribe(reader);
+	reader = -1;
+	for (Ragdoll& ragdoll : ragdolls) {
+		if (ragdoll.proxy != nullptr) {
+			ManagerPhysics::scene->removeActor(*ragdoll.proxy);
+			ragdoll.proxy->release();
+		}
+		ragdoll.articulation->releaseCache(*ragdoll.cache);
+		if (ragdoll.articulation->getScene() != nullptr)
+			ManagerPhysics::scene->removeArticulation(*ragdoll.articulation);
+		ragdoll.articulation->release(); // Takes the links with it
+	}
+	ragdolls.clear();
+	articulated.clear();
+	by_proxy.clear();
+	by_link.clear();
+	if (material != nullptr) material->release();
+	material = nullptr;
+}
+
+int ManagerRagdolls::spawn(WorldContainer* world, const Vector& location) {
+	std::string chest_model = ManagerEnvironmentConfiguration::getSMM() + "/models/human_chest.wrl";
+	std::string cube_model = ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl";
+	PxVec3 at(location.x, location.y, location.z);
+	Ragdoll ragdoll;
+	ragdoll.articulation = ManagerPhysics::gPhysics->createArticulationReducedCoordinate();
+	ragdoll.articulation->setSolverIterationCounts(16, 4);
+
+	for (size_t i = 0; i < LINK_COUNT; i++) {
+		const LinkSpec& spec = LINKS[i];
+		PxArticulationLink* parent = spec.parent >= 0 ? ragdoll.links[spec.parent] : nullptr;
+		PxTransform t(at + spec.center);
+		PxArticulationLink* link = ragdoll.articulation->createLink(parent, t);
+		PxRigidActorExt::createExclusiveShape(*link, PxBoxGeometry(spec.half_extents), *material);
+		PxRigidBodyExt::updateMassAndInertia(*link, DENSITY);
+		link->userData = nullptr; // Links are synced here, not by syncActiveActors
+		if (parent != nullptr) {
+			PxArticulationJointReducedCoordinate* joint = static_cast<PxArticulationJointReducedCoordinate*>(link->getInboundJoint());
+			PxQuat frame = spec.type == HINGE ? PxQuat(PxIdentity) : ALONG_BONE;
+			joint->setParentPose(PxTransform(spec.joint - LINKS[spec.parent].center, frame));
+			joint->setChildPose(PxTransform(spec.joint - spec.center, frame));
+			joint->setJointType(spec.type);
+			joint->setMotion(PxArticulationAxis::eTWIST, PxArticulationMotion::eLIMITED);
+			joint->setLimit(PxArticulationAxis::eTWIST, spec.low, spec.high);
+			if (spec.type == BALL) {
+				joint->setMotion(PxArticulationAxis::eSWING1, PxArticulationMotion::eLIMITED);
+				joint->setMotion(PxArticulationAxis::eSWING2, PxArticulationMotion::eLIMITED);
+				joint->setLimit(PxArticulationAxis::eSWING1, -spec.swing, spec.swing);
+				joint->setLimit(PxArticulationAxis::eSWING2, -spec.swing, spec.swing);
+			}
+		}
+		ragdoll.links.push_back(link);
+		by_link[link] = ragdolls.size();
+
+		// Every link is its own replicated object, registered together so the ids are consecutive
+		std::string model = i == CHEST ? chest_model : cube_model;
+		Vector scale = i == CHEST ? Vector(1, 1, 1) : Vector(spec.half_extents.x / 2, spec.half_extents.y / 2, spec.half_extents.z / 2);
+		WO* wo = WO::New(model, scale);
+		wo->setPosition(Vector(t.p.x, t.p.y, t.p.z));
+		world->push_back(wo);
+		ragdoll.wos.push_back(wo);
+		int id = ManagerReplication::addObject(model, scale, toPose(-1, t));
+		if (i == 0) ragdoll.first_id = id;
+	}
+
+	ManagerPhysics::scene->addArticulation(*ragdoll.articulation);
+	ragdoll.cache = ragdoll.articulation->createCache(); // Only once it is in the scene
+	articulated.push_back(ragdolls.size());
+	ragdolls.push_back(ragdoll);
+	return ragdoll.first_id;
+}
+
+void ManagerRagdolls::sync() {
+	std::vector<PoseRecord> poses;
+	for (size_t index : articulated) {
+		Ragdoll& ragdoll = ragdolls[index];
+		if (ragdoll.articulation->isSleeping()) continue;
+		poses.resize(ragdoll.links.size());
+		for (size_t i = 0; i < ragdoll.links.size(); i++) {
+			poses[i] = toPose(ragdoll.first_id + (int)i, ragdoll.links[i]->getGlobalPose());
+			ragdoll.wos[i]->getModel()->setDisplayMatrix(poses[i].toDisplayMatrix());
+			ragdoll.wos[i]->setPosition(poses[i].location[0], poses[i].location[1], poses[i].location[2]);
+		}
+		ManagerReplication::stageRagdoll(poses);
+	}
+}
+
+void ManagerRagdolls::update(const Vector& camera_position, double frame_ms) {
+	if (reader < 0) return;
+	events.clear();
+	ManagerSimulationEvents::read(reader, events);
+	for (const SimulationEvent& event : events) {
+		if (event.type != SimulationEventType::TriggerEnter) continue;
+		auto found = by_proxy.find(event.actor0);
+		if (found != by_proxy.end() && isImpact(event))
+			toArticulation(found->second);
+	}
+
+	ms_since_lod += frame_ms;
+	if (ms_since_lod < lod_ms) return;
+	ms_since_lod = 0;
+	// Backwards, toProxy swaps the last one into the slot it leaves
+	for (size_t i = articulated.size(); i-- > 0;) {
+		Ragdoll& ragdoll = ragdolls[articulated[i]];
+		bool settled = ragdoll.articulation->isSleeping();
+		if (!settled) {
+			PxArticulationLink* root = ragdoll.links[0];
+			PxVec3 p = root->getGlobalPose().p;
+			Vector at(p.x, p.y, p.z);
+			float distance = std::min((at - camera_position).length(), ManagerReplication::getNearestViewerDistance(at));
+			settled = distance > lod_distance && root->getLinearVelocity().magnitude() < settle_speed;
+		}
+		if (settled)
+			toProxy(articulated[i]);
+	}
+}
+
+bool ManagerRagdolls::isImpact(const SimulationEvent& event) {
+	// The event's actor may be gone by now, so the body is looked up again rather than read through it
+	if (event.id1 >= 0) {
+		WORigidActor* binding = ManagerSceneCommands::getBinding(event.id1);
+		PxRigidDynamic* body = binding != nullptr ? binding->actor->is<PxRigidDynamic>() : nullptr;
+		return body != nullptr && !body->isSleeping() && body->getLinearVelocity().magnitude() >= settle_speed;
+	}
+	// Links are never released, another ragdoll falling onto this one counts too
+	auto other = by_link.find(event.actor1);
+	if (other == by_link.end()) return false; // Statics, the camera and other proxies
+	const Ragdoll& ragdoll = ragdolls[other->second];
+	return ragdoll.proxy == nullptr && !ragdoll.articulation->isSleeping()
+		&& ragdoll.links[0]->getLinearVelocity().magnitude() >= settle_speed;
+}
+
+void ManagerRagdolls::toProxy(size_t index) {
+	Ragdoll& ragdoll = ragdolls[index];
+	ragdoll.articulation->copyInternalStateToCache(*ragdoll.cache, PxArticulationCache::eALL);
+
+	// One box around every link, in the root's frame so it hugs a ragdoll lying at an angle
+	PxTransform root = ragdoll.links[0]->getGlobalPose();
+	PxTransform to_root = root.getInverse();
+	PxBounds3 bounds = PxBounds3::empty();
+	for (size_t i = 0; i < ragdoll.links.size(); i++) {
+		PxBounds3 box = PxBounds3::centerExtents(PxVec3(0), LINKS[i].half_extents);
+		bounds.include(PxBounds3::transformFast(to_root * ragdoll.links[i]->getGlobalPose(), box));
+	}
+	ManagerPhysics::scene->removeArticulation(*ragdoll.articulation);
+
+	ragdoll.proxy = ManagerPhysics::gPhysics->createRigidDynamic(root);
+	ragdoll.proxy->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
+	PxShape* solid = PxRigidActorExt::createExclusiveShape(*ragdoll.proxy, PxBoxGeometry(bounds.getExtents()), *material);
+	solid->setLocalPose(PxTransform(bounds.getCenter()));
+	// A little bigger, so whatever is coming sets it off before it reaches the solid box
+	PxShape* trigger = PxRigidActorExt::createExclusiveShape(*ragdoll.proxy, PxBoxGeometry(bounds.getExtents() + PxVec3(wake_margin)),
+		*material, PxShapeFlag::eTRIGGER_SHAPE);
+	trigger->setLocalPose(PxTransform(bounds.getCenter()));
+	ManagerPhysics::scene->addActor(*ragdoll.proxy); // No userData, the links are the aftr side
+	by_proxy[ragdoll.proxy] = index;
+	remove(articulated, index);
+}
+
+void ManagerRagdolls::toArticulation(size_t index) {
+	Ragdoll& ragdoll = ragdolls[index];
+	by_proxy.erase(ragdoll.proxy);
+	ManagerPhysics::scene->removeActor(*ragdoll.proxy);
+	ragdoll.proxy->release();
+	ragdoll.proxy = nullptr;
+
+	// Exactly as it settled and at rest, the impact gets it moving again
+	ManagerPhysics::scene->addArticulation(*ragdoll.articulation);
+	PxArticulationCache& cache = *ragdoll.cache;
+	std::fill(cache.jointVelocity, cache.jointVelocity + ragdoll.articulation->getDofs(), 0.0f);
+	cache.rootLinkData->worldLinVel = PxVec3(0);
+	cache.rootLinkData->worldAngVel = PxVec3(0);
+	ragdoll.articulation->applyCache(cache, PxArticulationCache::ePOSITION | PxArticulationCache::eVELOCITY | PxArticulationCache::eROOT);
+	articulated.push_back(index);
+}
+
+void ManagerRagdolls::remove(std::vector<size_t>& list, size_t index) {
+	auto found = std::find(list.begin(), list.end(), index);
+	if (found == list.end()) return;
+	*found = list.back();
+	list.pop_back();
+}
+
+size_t ManagerRagdolls::getCount() {
+	return ragdolls.size();
+}
+
+size_t ManagerRagdolls::getArticulatedCount() {
+	return articulated.size();
+}
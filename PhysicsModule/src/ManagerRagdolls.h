@@ -0,0 +1,65 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "SimulationEventRing.h"
+#include "Vector.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace Aftr
+{
+	class WO;
+	class WorldContainer;
+
+	// This manager is meant to be a singleton for the ragdoll humans. Each one is a reduced coordinate articulation
+	// whose links are replicated objects, sent together as one NetMsgRagdollPose. A ragdoll that is asleep, or has
+	// settled far from the camera and every viewer, leaves the scene and a single kinematic box holds its place.
+	// Something moving into the box brings the articulation back, so resting ragdolls cost next to nothing
+	class ManagerRagdolls {
+		protected:
+			struct Ragdoll {
+				physx::PxArticulationReducedCoordinate* articulation = nullptr;
+				std::vector<physx::PxArticulationLink*> links; // Root first, same order as the link ids
+				std::vector<WO*> wos;
+				int first_id = -1; // Links have the ids [first_id, first_id + links.size())
+				physx::PxArticulationCache* cache = nullptr; // Joint state while the proxy stands in
+				physx::PxRigidDynamic* proxy = nullptr; // Only while the articulation is out of the scene
+			};
+
+			static std::vector<Ragdoll> ragdolls;
+			static std::vector<size_t> articulated; // Ragdolls simulated in full, the rest are proxies
+			static std::unordered_map<const physx::PxActor*, size_t> by_proxy;
+			static std::unordered_map<const physx::PxActor*, size_t> by_link;
+			static physx::PxMaterial* material;
+			static float lod_distance; // Settled ragdolls further than this from every camera become proxies
+			static float settle_speed; // Root speed under which a ragdoll counts as settled
+			static float wake_margin; // How far around the proxy a moving body wakes it
+			static double lod_ms; // Time between LOD checks
+			static double ms_since_lod;
+			static int reader;
+			static std::vector<SimulationEvent> events;
+
+			// Main thread, with the scene idle
+			static void toProxy(size_t index);
+			static void toArticulation(size_t index);
+			// Whether whatever went into a proxy is moving enough to count as an impact
+			static bool isImpact(const SimulationEvent& event);
+			static void remove(std::vector<size_t>& list, size_t index);
+
+		public:
+			// After ManagerSimulationEvents::init. Reads RagdollLodDistance, RagdollSettleSpeed, RagdollWakeMargin and
+			// RagdollLodMs from aftr.conf. Without trigger events the ragdolls never switch to proxies
+			static void init();
+			static void shutdown();
+
+			// Main thread, with the scene idle. Drops a ragdoll standing with its pelvis at location, returns the root link id
+			static int spawn(WorldContainer* world, const Vector& location);
+			// Main thread, after every simulateStep. Moves the links of the awake ragdolls and stages them for replication
+			static void sync();
+			// Once per frame after the physics steps. Wakes proxies that were hit and swaps settled ragdolls for proxies
+			static void update(const Vector& camera_position, double frame_ms);
+			static size_t getCount();
+			static size_t getArticulatedCount();
+	};
+}
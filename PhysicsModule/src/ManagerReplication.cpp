@@ -0,0 +1,609 @@
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include "ManagerReplication.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "NetMsgMoveSphere.h"
+#include "NetMsgDragTarget.h"
+#include "NetMsgRemoveSharedObject.h"
+#include "NetMsgTerrainCrater.h"
+#include "NetMsgRagdollPose.h"
+#include "NetTelemetry.h"
+
+using namespace Aftr;
+
+std::vector<ReplicationViewer*> ManagerReplication::viewers;
+std::vector<ReplicatedObject> ManagerReplication::objects;
+std::vector<std::string> ManagerReplication::models;
+Vector ManagerReplication::drop_pos = Vector(20, 20, 100);
+unsigned int ManagerReplication::sequence = 0;
+float ManagerReplication::default_interest_radius = 0;
+size_t ManagerReplication::default_bytes_per_tick = 0;
+size_t ManagerReplication::snapshot_chunk_objects = 512;
+size_t ManagerReplication::snapshot_chunks_per_frame = 4;
+double ManagerReplication::tick_ms = 0;
+double ManagerReplication::ms_since_tick = 0;
+unsigned int ManagerReplication::ring_timeout_ms = 100;
+unsigned int ManagerReplication::report_ms = 0;
+double ManagerReplication::ms_since_report = 0;
+int ManagerReplication::drag_id = -1;
+Vector ManagerReplication::drag_target;
+bool ManagerReplication::drag_changed = false;
+std::vector<std::shared_ptr<NetMsgTerrainCrater>> ManagerReplication::craters;
+std::map<int, std::vector<PoseRecord>> ManagerReplication::ragdolls;
+
+void ManagerReplication::init() {
+	std::string radius = ManagerEnvironmentConfiguration::getVariableValue("NetViewerInterestRadius");
+	if (!radius.empty()) default_interest_radius = std::stof(radius);
+	std::string budget = ManagerEnvironmentConfiguration::getVariableValue("NetViewerBytesPerTick");
+	if (!budget.empty()) default_bytes_per_tick = std::stoul(budget);
+	std::string chunk_objects = ManagerEnvironmentConfiguration::getVariableValue("NetSnapshotChunkObjects");
+	if (!chunk_objects.empty()) snapshot_chunk_objects = std::max<size_t>(1, std::stoul(chunk_objects));
+	std::string chunks_per_frame = ManagerEnvironmentConfiguration::getVariableValue("NetSnapshotChunksPerFrame");
+	if (!chunks_per_frame.empty()) snapshot_chunks_per_frame = std::max<size_t>(1, std::stoul(chunks_per_frame));
+	std::string tick_hz = ManagerEnvironmentConfiguration::getVariableValue("NetReplicationTickHz");
+	if (!tick_hz.empty() && std::stof(tick_hz) > 0) tick_ms = 1000.0 / std::stof(tick_hz);
+	std::string ring_timeout = ManagerEnvironmentConfiguration::getVariableValue("NetShmTimeoutMs");
+	if (!ring_timeout.empty()) ring_timeout_ms = std::stoul(ring_timeout);
+	std::string report = ManagerEnvironmentConfiguration::getVariableValue("NetReplicationReportMs");
+	if (!report.empty()) report_ms = std::stoul(report);
+
+	// NetViewers is a comma separated list of host:port pairs
+	std::stringstream list(ManagerEnvironmentConfiguration::getVariableValue("NetViewers"));
+	std::string entry;
+	while (std::getline(list, entry, ',')) {
+		size_t colon = entry.find(':');
+		if (colon == std::string::npos) continue;
+		addViewer(entry.substr(0, colon), entry.substr(colon + 1), Vector(0, 0, 0));
+	}
+
+	// No list given, so keep talking to the single local peer like before
+	if (viewers.empty()) {
+		if (ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort") == "12683")
+			addViewer("127.0.0.1", "12682", Vector(0, 0, 0));
+		else
+			addViewer("127.0.0.1", "12683", Vector(0, 0, 0));
+	}
+}
+
+void ManagerReplication::shutdown() {
+	for (ReplicationViewer* viewer : viewers) {
+		delete viewer->client;
+		delete viewer->ring;
+		delete viewer;
+	}
+	viewers.clear();
+	objects.clear();
+	models.clear();
+	craters.clear();
+	ragdolls.clear();
+}
+
+ReplicationState ManagerReplication::takeState() {
+	ReplicationState state;
+	state.viewers.swap(viewers);
+	state.objects.swap(objects);
+	state.models.swap(models);
+	state.drop_pos = drop_pos;
+	state.sequence = sequence;
+	state.drag_id = drag_id;
+	state.drag_target = drag_target;
+	state.drag_changed = drag_changed;
+	state.craters.swap(craters);
+	state.ragdolls.swap(ragdolls);
+	state.ms_since_tick = ms_since_tick;
+	state.ms_since_report = ms_since_report;
+	sequence = 0;
+	drag_id = -1;
+	drag_changed = false;
+	ms_since_tick = 0;
+	ms_since_report = 0;
+	return state;
+}
+
+void ManagerReplication::restoreState(ReplicationState& state) {
+	shutdown();
+	viewers.swap(state.viewers);
+	objects.swap(state.objects);
+	models.swap(state.models);
+	drop_pos = state.drop_pos;
+	sequence = state.sequence;
+	drag_id = state.drag_id;
+	drag_target = state.drag_target;
+	drag_changed = state.drag_changed;
+	craters.swap(state.craters);
+	ragdolls.swap(state.ragdolls);
+	ms_since_tick = state.ms_since_tick;
+	ms_since_report = state.ms_since_report;
+}
+
+ReplicationViewer* ManagerReplication::addViewer(const std::string& host, const std::string& port, const Vector& focus, const std::string& transport) {
+	ReplicationViewer* viewer = nullptr;
+	for (ReplicationViewer* known : viewers) {
+		if (known->host == host && known->port == port)
+			viewer = known;
+	}
+	if (viewer == nullptr) {
+		viewer = new ReplicationViewer();
+		viewer->host = host;
+		viewer->port = port;
+		viewer->interest_radius = default_interest_radius;
+		viewer->bytes_per_tick = default_bytes_per_tick;
+		viewer->client = NetMessengerClient::New(host, port);
+		viewers.push_back(viewer);
+		std::cout << "Replicating to viewer " << host << ":" << port << std::endl;
+	}
+	// A restarted viewer made a new segment, so never keep the old mapping
+	delete viewer->ring;
+	viewer->ring = nullptr;
+	viewer->ring_full = false;
+	if (transport.compare(0, 4, "shm:") == 0) {
+		viewer->ring = NetShmRing::open(transport.substr(4));
+		if (viewer->ring != nullptr)
+			std::cout << "Viewer " << host << ":" << port << " reads from shared memory " << transport.substr(4) << std::endl;
+		else
+			std::cout << "Unable to open shared memory " << transport.substr(4) << ", viewer " << host << ":" << port << " stays on TCP" << std::endl;
+	}
+	// A known viewer asking again has restarted, so it gets a fresh snapshot too
+	viewer->focus = focus;
+	startSnapshot(viewer);
+	return viewer;
+}
+
+size_t ManagerReplication::getViewerCount() {
+	return viewers.size();
+}
+
+void ManagerReplication::setViewerFocus(const std::string& host, const std::string& port, const Vector& focus) {
+	for (ReplicationViewer* viewer : viewers) {
+		if (viewer->host == host && viewer->port == port)
+			viewer->focus = focus;
+	}
+}
+
+float ManagerReplication::getNearestViewerDistance(const Vector& location) {
+	float nearest = FLT_MAX;
+	for (const ReplicationViewer* viewer : viewers)
+		nearest = std::min(nearest, (location - viewer->focus).length());
+	return nearest;
+}
+
+void ManagerReplication::startSnapshot(ReplicationViewer* viewer) {
+	viewer->snapshot = std::make_shared<std::vector<SnapshotRecord>>();
+	viewer->snapshot->reserve(objects.size());
+	for (size_t i = 0; i < objects.size(); i++) {
+		if (!objects[i].removed)
+			viewer->snapshot->push_back(toSnapshotRecord(objects[i]));
+	}
+	viewer->snapshot_objects = objects.size();
+	viewer->snapshot_chunk = 0;
+	viewer->snapshot_sequence = sequence;
+	viewer->known_objects = 0;
+	viewer->baseline.clear();
+	viewer->has_baseline.clear();
+	viewer->priority.clear();
+	viewer->dirty.clear();
+	viewer->dirty_list.clear();
+	viewer->send_queue.clear(); // The snapshot supersedes anything still queued
+}
+
+bool ManagerReplication::streamSnapshot(ReplicationViewer* viewer) {
+	size_t total = viewer->snapshot->size();
+	unsigned int chunk_count = (unsigned int)std::max<size_t>(1, (total + snapshot_chunk_objects - 1) / snapshot_chunk_objects);
+	for (size_t sent = 0; sent < snapshot_chunks_per_frame && viewer->snapshot_chunk < chunk_count; sent++) {
+		size_t first = viewer->snapshot_chunk * snapshot_chunk_objects;
+		std::shared_ptr<NetMsgWorldSnapshot> msg = std::make_shared<NetMsgWorldSnapshot>();
+		msg->sequence = viewer->snapshot_sequence;
+		msg->chunk_index = viewer->snapshot_chunk;
+		msg->chunk_count = chunk_count;
+		msg->models = models;
+		msg->drop_pos = drop_pos; // Current, so it can't overwrite a newer move already queued
+		// Also current, a removal queued since the capture must not be undone by a later chunk
+		std::vector<SnapshotRecord> chunk;
+		for (size_t i = first; i < std::min(first + snapshot_chunk_objects, total); i++) {
+			if (!objects[(*viewer->snapshot)[i].pose.id].removed)
+				chunk.push_back((*viewer->snapshot)[i]);
+		}
+		msg->encode(chunk.data(), chunk.size());
+		send(viewer, msg, msg->payload.size());
+		viewer->snapshot_chunk++;
+	}
+	return viewer->snapshot_chunk == chunk_count;
+}
+
+int ManagerReplication::addObject(const std::string& model_path, const Vector& scale, const PoseRecord& pose) {
+	auto model = std::find(models.begin(), models.end(), model_path);
+	if (model == models.end())
+		model = models.insert(models.end(), model_path);
+
+	ReplicatedObject object;
+	object.model_id = (int)(model - models.begin());
+	object.scale = scale;
+	object.pose = pose;
+	object.pose.id = (int)objects.size();
+	objects.push_back(object);
+	return object.pose.id;
+}
+
+void ManagerReplication::removeObject(int id) {
+	if (id < 0 || id >= (int)objects.size() || objects[id].removed) return;
+	objects[id].removed = true;
+	std::shared_ptr<NetMsgRemoveSharedObject> msg = std::make_shared<NetMsgRemoveSharedObject>();
+	msg->object_id = id;
+	// Viewers that haven't been sent the spawn yet will skip it, so only the rest need telling
+	for (ReplicationViewer* viewer : viewers) {
+		if (viewer->snapshot != nullptr || (size_t)id < viewer->known_objects)
+			send(viewer, msg);
+	}
+}
+
+SnapshotRecord ManagerReplication::toSnapshotRecord(const ReplicatedObject& object) {
+	SnapshotRecord record;
+	record.model_id = object.model_id;
+	record.scale[0] = object.scale.x;
+	record.scale[1] = object.scale.y;
+	record.scale[2] = object.scale.z;
+	record.pose = object.pose;
+	return record;
+}
+
+std::shared_ptr<NetMsgNewSharedObjectBatch> ManagerReplication::buildSpawnBatch(size_t first) {
+	std::vector<SnapshotRecord> records;
+	records.reserve(objects.size() - first);
+	for (size_t id = first; id < objects.size(); id++) {
+		if (!objects[id].removed)
+			records.push_back(toSnapshotRecord(objects[id]));
+	}
+	if (records.empty()) return nullptr;
+	std::shared_ptr<NetMsgNewSharedObjectBatch> msg = std::make_shared<NetMsgNewSharedObjectBatch>();
+	msg->models = models;
+	msg->encode(records.data(), records.size());
+	return msg;
+}
+
+void ManagerReplication::moveDropZone(const Vector& location) {
+	drop_pos = location;
+	std::shared_ptr<NetMsgMoveSphere> msg = std::make_shared<NetMsgMoveSphere>();
+	msg->location = location;
+	broadcast(msg);
+}
+
+void ManagerReplication::digCrater(const Vector& center, float radius, float depth) {
+	std::shared_ptr<NetMsgTerrainCrater> msg = std::make_shared<NetMsgTerrainCrater>();
+	msg->index = (unsigned int)craters.size();
+	msg->center = center;
+	msg->radius = radius;
+	msg->depth = depth;
+	craters.push_back(msg);
+	broadcast(msg);
+}
+
+void ManagerReplication::setDragTarget(int id, const Vector& target) {
+	bool moved = target.x != drag_target.x || target.y != drag_target.y || target.z != drag_target.z;
+	if (id == drag_id && (id < 0 || !moved)) return;
+	drag_id = id;
+	drag_target = target;
+	drag_changed = true;
+}
+
+void ManagerReplication::broadcast(std::shared_ptr<NetMsg> msg) {
+	for (ReplicationViewer* viewer : viewers)
+		send(viewer, msg);
+}
+
+void ManagerReplication::send(ReplicationViewer* viewer, std::shared_ptr<NetMsg> msg, size_t payload_bytes) {
+	QueuedMsg queued;
+	queued.msg = msg;
+	queued.payload_bytes = payload_bytes;
+	viewer->send_queue.push_back(queued);
+}
+
+void ManagerReplication::stagePose(const PoseRecord& pose, float speed) {
+	ReplicatedObject& object = objects[pose.id];
+	if (object.removed) return;
+	object.pose = pose;
+	object.speed = speed;
+	for (ReplicationViewer* viewer : viewers)
+		markDirty(viewer, pose.id);
+}
+
+void ManagerReplication::stageRagdoll(const std::vector<PoseRecord>& links) {
+	if (links.empty() || objects[links.front().id].removed) return;
+	// Snapshots still read the links like any other object
+	for (const PoseRecord& link : links)
+		objects[link.id].pose = link;
+	ragdolls[links.front().id] = links;
+}
+
+void ManagerReplication::markContact(int id) {
+	objects[id].ms_since_contact = 0;
+}
+
+void ManagerReplication::markDirty(ReplicationViewer* viewer, int id) {
+	if (viewer->dirty.size() <= (size_t)id)
+		viewer->dirty.resize(objects.size(), 0);
+	if (viewer->dirty[id]) return;
+	viewer->dirty[id] = 1;
+	viewer->dirty_list.push_back(id);
+}
+
+bool ManagerReplication::inInterest(const ReplicationViewer* viewer, const PoseRecord& pose) {
+	if (viewer->interest_radius <= 0)
+		return true;
+	Vector location(pose.location[0], pose.location[1], pose.location[2]);
+	return (location - viewer->focus).length() <= viewer->interest_radius;
+}
+
+float ManagerReplication::priorityRate(const ReplicationViewer* viewer, const ReplicatedObject& object) {
+	Vector location(object.pose.location[0], object.pose.location[1], object.pose.location[2]);
+	float distance = (location - viewer->focus).length();
+	float rate = 1.0f; // Waiting alone is enough to get sent eventually
+	rate += 0.1f * object.speed;
+	rate += 50.0f / (1.0f + distance);
+	if (object.ms_since_contact < 500)
+		rate += 5.0f;
+	return rate;
+}
+
+std::vector<int> ManagerReplication::schedule(ReplicationViewer* viewer, double tick_s) {
+	viewer->baseline.resize(objects.size());
+	viewer->has_baseline.resize(objects.size(), 0);
+	viewer->priority.resize(objects.size(), 0);
+	viewer->dirty.resize(objects.size(), 0);
+
+	std::vector<int> candidates;
+	size_t kept = 0;
+	for (int id : viewer->dirty_list) {
+		const ReplicatedObject& object = objects[id];
+		// Already there or gone, nothing to send
+		if (object.removed || (viewer->has_baseline[id] && std::memcmp(&viewer->baseline[id], &object.pose, sizeof(PoseRecord)) == 0)) {
+			viewer->dirty[id] = 0;
+			viewer->priority[id] = 0;
+			continue;
+		}
+		viewer->dirty_list[kept++] = id;
+		if (!inInterest(viewer, object.pose)) continue;
+		viewer->priority[id] += (float)tick_s * priorityRate(viewer, object);
+		candidates.push_back(id);
+	}
+	viewer->dirty_list.resize(kept);
+
+	// Highest priority first, as many as the budget holds
+	size_t fits = viewer->bytes_per_tick > 0 ? std::max<size_t>(1, viewer->bytes_per_tick / sizeof(PoseRecord)) : candidates.size();
+	if (fits < candidates.size()) {
+		std::nth_element(candidates.begin(), candidates.begin() + fits, candidates.end(),
+			[viewer](int a, int b) { return viewer->priority[a] > viewer->priority[b]; });
+		candidates.resize(fits);
+	}
+	std::sort(candidates.begin(), candidates.end()); // Same ids in the same order can share a batch
+	return candidates;
+}
+
+void ManagerReplication::update(double frame_ms) {
+	// A full ring is retried every frame rather than waiting for the next tick
+	std::map<const NetMsg*, RingPayload> ring_payloads;
+	for (ReplicationViewer* viewer : viewers) {
+		if (viewer->ring_full)
+			sendQueue(viewer, ring_payloads);
+	}
+
+	ms_since_tick += frame_ms;
+	if (ms_since_tick < tick_ms)
+		return;
+	double elapsed_ms = ms_since_tick;
+	// Stay on the tick grid, but a long stall only costs one flush rather than a burst of them
+	ms_since_tick = tick_ms > 0 ? std::fmod(ms_since_tick, tick_ms) : 0;
+	flush(elapsed_ms - ms_since_tick);
+}
+
+void ManagerReplication::flush(double elapsed_ms) {
+	sequence++;
+	for (ReplicatedObject& object : objects)
+		object.ms_since_contact += elapsed_ms;
+
+	// However often the mouse moved since the last tick, viewers only get where it ended up
+	if (drag_changed) {
+		std::shared_ptr<NetMsgDragTarget> msg = std::make_shared<NetMsgDragTarget>();
+		msg->object_id = drag_id;
+		msg->target = drag_target;
+		broadcast(msg);
+		drag_changed = false;
+	}
+
+	// Viewers that want exactly the same poses share one encoded batch, same for spawns
+	std::map<std::vector<int>, std::shared_ptr<NetMsgObjectOrientationBatch>> batches;
+	std::map<size_t, std::shared_ptr<NetMsgNewSharedObjectBatch>> spawn_batches;
+	std::map<int, std::shared_ptr<NetMsgRagdollPose>> ragdoll_msgs;
+	for (ReplicationViewer* viewer : viewers) {
+		if (viewer->snapshot != nullptr) {
+			if (!streamSnapshot(viewer)) continue;
+			// Whole snapshot is queued, the viewer now holds exactly what it contained
+			viewer->baseline.resize(objects.size());
+			viewer->has_baseline.resize(objects.size(), 0);
+			for (const SnapshotRecord& record : *viewer->snapshot) {
+				if (objects[record.pose.id].removed) continue;
+				viewer->baseline[record.pose.id] = record.pose;
+				viewer->has_baseline[record.pose.id] = 1;
+			}
+			viewer->known_objects = viewer->snapshot_objects;
+			viewer->snapshot.reset();
+			// The terrain isn't part of the snapshot, so replay every crater. Ones the viewer already has are skipped by index
+			for (const std::shared_ptr<NetMsgTerrainCrater>& crater : craters)
+				send(viewer, crater);
+			// Anything that changed since the capture gets scheduled like any other update
+			for (size_t id = 0; id < objects.size(); id++) {
+				if (!objects[id].removed)
+					markDirty(viewer, (int)id);
+			}
+		}
+
+		// Spawn everything the viewer hasn't seen yet in one message
+		if (viewer->known_objects < objects.size()) {
+			auto spawns = spawn_batches.find(viewer->known_objects);
+			if (spawns == spawn_batches.end())
+				spawns = spawn_batches.emplace(viewer->known_objects, buildSpawnBatch(viewer->known_objects)).first;
+			if (spawns->second != nullptr)
+				send(viewer, spawns->second, spawns->second->payload.size());
+			for (; viewer->known_objects < objects.size(); viewer->known_objects++) {
+				if (!objects[viewer->known_objects].removed)
+					markDirty(viewer, (int)viewer->known_objects);
+			}
+		}
+
+		// Each ragdoll is one message, ahead of the batch so the viewer hasn't moved on to this sequence yet
+		viewer->baseline.resize(objects.size());
+		viewer->has_baseline.resize(objects.size(), 0);
+		for (const auto& staged : ragdolls) {
+			const std::vector<PoseRecord>& links = staged.second;
+			if ((size_t)links.back().id >= viewer->known_objects || !inInterest(viewer, links.front())) continue;
+			std::shared_ptr<NetMsgRagdollPose>& msg = ragdoll_msgs[staged.first];
+			if (msg == nullptr) {
+				msg = std::make_shared<NetMsgRagdollPose>();
+				msg->sequence = sequence;
+				msg->encode(links);
+			}
+			send(viewer, msg, msg->payload.size());
+			// Whatever was waiting in the scheduler for these links is already there now
+			for (const PoseRecord& link : links) {
+				viewer->baseline[link.id] = link;
+				viewer->has_baseline[link.id] = 1;
+			}
+		}
+
+		std::vector<int> selection = schedule(viewer, elapsed_ms / 1000.0);
+		if (selection.empty()) continue;
+
+		std::shared_ptr<NetMsgObjectOrientationBatch>& batch = batches[selection];
+		if (batch == nullptr) {
+			std::vector<PoseRecord> records;
+			records.reserve(selection.size());
+			for (int id : selection)
+				records.push_back(objects[id].pose);
+			batch = std::make_shared<NetMsgObjectOrientationBatch>();
+			batch->sequence = sequence;
+			batch->encode(records);
+		}
+		for (int id : selection) {
+			viewer->baseline[id] = objects[id].pose;
+			viewer->has_baseline[id] = 1;
+			viewer->priority[id] = 0;
+		}
+		send(viewer, batch, batch->payload.size());
+	}
+
+	std::map<const NetMsg*, RingPayload> ring_payloads;
+	for (ReplicationViewer* viewer : viewers) {
+		NetTelemetry::recordQueueDepth(viewer->send_queue.size());
+		sendQueue(viewer, ring_payloads);
+	}
+
+	ragdolls.clear();
+
+	ms_since_report += elapsed_ms;
+	if (report_ms > 0 && ms_since_report >= report_ms) {
+		report(ms_since_report);
+		ms_since_report = 0;
+	}
+}
+
+void ManagerReplication::sendQueue(ReplicationViewer* viewer, std::map<const NetMsg*, RingPayload>& ring_payloads) {
+	auto start = std::chrono::high_resolution_clock::now();
+	while (!viewer->send_queue.empty()) {
+		QueuedMsg queued = viewer->send_queue.front();
+		auto send_start = std::chrono::high_resolution_clock::now();
+		RingSend sent = RingSend::Unfit;
+		if (viewer->ring != nullptr) {
+			auto encoded = ring_payloads.find(queued.msg.get());
+			if (encoded == ring_payloads.end()) {
+				encoded = ring_payloads.emplace(queued.msg.get(), RingPayload()).first;
+				encodeForRing(*queued.msg, encoded->second);
+			}
+			sent = sendToRing(viewer, encoded->second);
+		}
+		// Full keeps the message for the next try. Dropped restarted the viewer's snapshot, which emptied the queue
+		if (sent == RingSend::Full || sent == RingSend::Dropped) break;
+		if (sent == RingSend::Unfit)
+			viewer->client->sendNetMsgSynchronousTCP(*queued.msg);
+		viewer->send_queue.pop_front();
+		NetTelemetry::recordSendLatency(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - send_start).count());
+		viewer->msgs_sent++;
+		viewer->bytes_sent += queued.payload_bytes;
+	}
+	viewer->send_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+namespace {
+	template<class Msg>
+	bool encodeAs(const NetMsg& msg, RingPayload& out) {
+		const Msg* typed = dynamic_cast<const Msg*>(&msg);
+		if (typed == nullptr) return false;
+		out.type = NetSchemaCodec<Msg>::hash();
+		out.name = NetSchema<Msg>::name;
+		out.bytes = NetSchemaCodec<Msg>::encode(*typed);
+		return true;
+	}
+}
+
+bool ManagerReplication::encodeForRing(const NetMsg& msg, RingPayload& out) {
+	// Everything the authority sends to viewers
+	return encodeAs<NetMsgObjectOrientationBatch>(msg, out)
+		|| encodeAs<NetMsgWorldSnapshot>(msg, out)
+		|| encodeAs<NetMsgNewSharedObjectBatch>(msg, out)
+		|| encodeAs<NetMsgMoveSphere>(msg, out)
+		|| encodeAs<NetMsgDragTarget>(msg, out)
+		|| encodeAs<NetMsgTerrainCrater>(msg, out)
+		|| encodeAs<NetMsgRagdollPose>(msg, out)
+		|| encodeAs<NetMsgRemoveSharedObject>(msg, out);
+}
+
+ManagerReplication::RingSend ManagerReplication::sendToRing(ReplicationViewer* viewer, const RingPayload& payload) {
+	// Only this message goes over TCP, the ring is still fine for the rest
+	if (payload.type == 0) {
+		std::cout << "A message to viewer " << viewer->host << ":" << viewer->port << " has no shared memory encoding, sending it over TCP" << std::endl;
+		return RingSend::Unfit;
+	}
+	if (!viewer->ring->fits(payload.bytes.size())) {
+		std::cout << payload.name << " of " << payload.bytes.size() << " bytes is bigger than shared memory " << viewer->ring->getName()
+			<< ", sending it over TCP" << std::endl;
+		return RingSend::Unfit;
+	}
+	if (viewer->ring->tryWrite(payload.type, payload.bytes.data(), payload.bytes.size())) {
+		viewer->ring_full = false;
+		NetTelemetry::countSent(payload.name, payload.bytes.size());
+		return RingSend::Sent;
+	}
+
+	// The viewer drains the ring every frame, so give it until the timeout before giving up on it
+	auto now = std::chrono::steady_clock::now();
+	if (!viewer->ring_full) {
+		viewer->ring_full = true;
+		viewer->ring_full_since = now;
+	}
+	if (now - viewer->ring_full_since <= std::chrono::milliseconds(ring_timeout_ms))
+		return RingSend::Full;
+	std::cout << "Viewer " << viewer->host << ":" << viewer->port << " is not draining shared memory " << viewer->ring->getName()
+		<< ", falling back to TCP" << std::endl;
+	delete viewer->ring;
+	viewer->ring = nullptr;
+	viewer->ring_full = false;
+	startSnapshot(viewer);
+	return RingSend::Dropped;
+}
+
+void ManagerReplication::report(double elapsed_ms) {
+	double seconds = elapsed_ms / 1000.0;
+	std::cout << "Replication: " << viewers.size() << " viewer(s)" << std::endl;
+	for (ReplicationViewer* viewer : viewers) {
+		std::cout << "  " << viewer->host << ":" << viewer->port
+			<< " msgs/s = " << viewer->msgs_sent / seconds
+			<< " pose bytes/s = " << viewer->bytes_sent / seconds
+			<< " send cpu ms/s = " << viewer->send_ms / seconds << std::endl;
+		viewer->msgs_sent = 0;
+		viewer->bytes_sent = 0;
+		viewer->send_ms = 0;
+	}
+}
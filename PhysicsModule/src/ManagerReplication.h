@@ -0,0 +1,184 @@
+#pragma once
+
+#include "NetMessengerClient.h"
+#include "NetMsgObjectOrientationBatch.h"
+#include "NetMsgNewSharedObjectBatch.h"
+#include "NetMsgWorldSnapshot.h"
+#include "NetShmRing.h"
+#include "Vector.h"
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+	class NetMsgTerrainCrater;
+	class NetMsgRagdollPose;
+
+	// A message waiting for a flush
+	struct QueuedMsg {
+		std::shared_ptr<NetMsg> msg;
+		size_t payload_bytes = 0; // Packed records it carries, what the per-viewer report counts
+	};
+
+	// One PseudoPhysicsModule instance being replicated to
+	struct ReplicationViewer {
+		std::string host;
+		std::string port;
+		NetMessengerClient* client = nullptr;
+		NetShmRing* ring = nullptr; // Shared memory to a viewer on this host, replaces the client while set
+		bool ring_full = false; // The front of the queue is waiting for room in the ring, retried every frame
+		std::chrono::steady_clock::time_point ring_full_since;
+		std::deque<QueuedMsg> send_queue; // Messages waiting for the next flush
+		std::vector<PoseRecord> baseline; // Last pose sent to this viewer, indexed by object id
+		std::vector<uint8_t> has_baseline;
+		Vector focus; // Viewer camera position
+		float interest_radius = 0; // Objects further than this from the focus are not sent, 0 means everything
+
+		// Priority scheduling. Objects whose pose changed wait in dirty_list, gaining priority every tick,
+		// until they win a spot in the tick's byte budget
+		std::vector<float> priority; // Indexed by object id
+		std::vector<uint8_t> dirty;
+		std::vector<int> dirty_list;
+		size_t bytes_per_tick = 0; // Pose bytes allowed per tick, 0 means unlimited
+
+		// Join state. While a snapshot is streaming the viewer gets nothing else
+		std::shared_ptr<std::vector<SnapshotRecord>> snapshot;
+		unsigned int snapshot_chunk = 0; // Next chunk to send
+		unsigned int snapshot_sequence = 0;
+		size_t snapshot_objects = 0; // Objects registered when the snapshot was captured
+		size_t known_objects = 0; // Objects [0, known_objects) have been spawned on this viewer
+
+		// Counters since the last report
+		size_t msgs_sent = 0;
+		size_t bytes_sent = 0;
+		double send_ms = 0;
+	};
+
+	// A message as it is written into a shared memory ring
+	struct RingPayload {
+		uint32_t type = 0; // NetSchemaCodec hash of the message, 0 if it has no ring encoding
+		const char* name = nullptr;
+		std::string bytes;
+	};
+
+	// One object the authority replicates
+	struct ReplicatedObject {
+		int model_id;
+		Vector scale;
+		PoseRecord pose; // Latest pose, kept so snapshots never have to touch the scene
+		float speed = 0;
+		double ms_since_contact = 1.0e9;
+		bool removed = false; // Despawned, the id stays reserved
+	};
+
+	// Everything registered for replication, viewers included, moved out so a benchmark can run on an empty registry
+	struct ReplicationState {
+		std::vector<ReplicationViewer*> viewers;
+		std::vector<ReplicatedObject> objects;
+		std::vector<std::string> models;
+		Vector drop_pos;
+		unsigned int sequence = 0;
+		int drag_id = -1;
+		Vector drag_target;
+		bool drag_changed = false;
+		std::vector<std::shared_ptr<NetMsgTerrainCrater>> craters;
+		std::map<int, std::vector<PoseRecord>> ragdolls;
+		double ms_since_tick = 0;
+		double ms_since_report = 0;
+	};
+
+	// This manager is meant to be a singleton that fans the authority's state out to every viewer
+	class ManagerReplication {
+		protected:
+			enum class RingSend { Sent, Unfit, Full, Dropped };
+
+			static std::vector<ReplicationViewer*> viewers;
+			static std::vector<ReplicatedObject> objects; // Indexed by object id
+			static std::vector<std::string> models; // Indexed by model id
+			static Vector drop_pos;
+			static unsigned int sequence; // Flushes so far
+			static float default_interest_radius;
+			static size_t default_bytes_per_tick;
+			static size_t snapshot_chunk_objects; // Records per snapshot chunk
+			static size_t snapshot_chunks_per_frame; // Bounds how much of a flush a joining viewer can take
+			static double tick_ms; // Time between flushes, 0 flushes every frame
+			static double ms_since_tick;
+			static unsigned int ring_timeout_ms; // How long a ring may stay full before its viewer falls back to TCP
+			static unsigned int report_ms; // How often to print per-viewer stats, 0 disables
+			static double ms_since_report;
+			static int drag_id; // Object being dragged, -1 if none
+			static Vector drag_target;
+			static bool drag_changed; // Sent on the next flush
+			static std::vector<std::shared_ptr<NetMsgTerrainCrater>> craters; // Every crater dug so far, in order
+			static std::map<int, std::vector<PoseRecord>> ragdolls; // Staged since the last flush, by root link id
+
+			// Capture the registry for a viewer that is (re)joining
+			static void startSnapshot(ReplicationViewer* viewer);
+			static bool inInterest(const ReplicationViewer* viewer, const PoseRecord& pose);
+			// How fast an object's priority grows for a viewer, per second
+			static float priorityRate(const ReplicationViewer* viewer, const ReplicatedObject& object);
+			static void markDirty(ReplicationViewer* viewer, int id);
+			// Accumulate priority and pick the ids that fit in the viewer's budget this tick
+			static std::vector<int> schedule(ReplicationViewer* viewer, double tick_s);
+			// Every live object from first onwards in one spawn message
+			static std::shared_ptr<NetMsgNewSharedObjectBatch> buildSpawnBatch(size_t first);
+			static SnapshotRecord toSnapshotRecord(const ReplicatedObject& object);
+			// Queue the next few snapshot chunks, returns true once the whole snapshot is queued
+			static bool streamSnapshot(ReplicationViewer* viewer);
+			static void report(double elapsed_ms);
+			// Schema bytes of a message for shared memory viewers, false if it can't go that way
+			static bool encodeForRing(const NetMsg& msg, RingPayload& out);
+			// Unfit if the message can't go through the ring and has to take TCP, Full while the viewer hasn't made
+			// room yet, Dropped once it has been full for too long and the viewer is moved back to TCP
+			static RingSend sendToRing(ReplicationViewer* viewer, const RingPayload& payload);
+			// Sends the viewer's queue in order, stopping at a full ring. Shared messages are encoded for the rings once
+			static void sendQueue(ReplicationViewer* viewer, std::map<const NetMsg*, RingPayload>& ring_payloads);
+
+		public:
+			// Reads the static viewer list from aftr.conf
+			static void init();
+			static void shutdown();
+			// Leaves the registry empty, the live viewers stay connected inside the returned state
+			static ReplicationState takeState();
+			// Drops whatever is registered now and puts the taken state back
+			static void restoreState(ReplicationState& state);
+			// Start replicating to a viewer with a fresh snapshot, returns the existing one if already known.
+			// A transport of "shm:<segment>" sends through that shared memory ring instead of TCP when it can be opened
+			static ReplicationViewer* addViewer(const std::string& host, const std::string& port, const Vector& focus, const std::string& transport = "");
+			static size_t getViewerCount();
+			// Distance from a point to the closest viewer camera, FLT_MAX without viewers
+			static float getNearestViewerDistance(const Vector& location);
+			// A viewer reported where its camera is
+			static void setViewerFocus(const std::string& host, const std::string& port, const Vector& focus);
+			// Register a new object, returns its id. The spawn is sent to viewers on the next flush
+			static int addObject(const std::string& model_path, const Vector& scale, const PoseRecord& pose);
+			// Despawn an object on every viewer
+			static void removeObject(int id);
+			// Move the drop zone on every viewer
+			static void moveDropZone(const Vector& location);
+			// Dig a crater on every viewer, viewers that join later have it replayed after their snapshot
+			static void digCrater(const Vector& center, float radius, float depth);
+			// Where the dragged object is being pulled, an id of -1 means it was let go. Only the latest is sent each tick
+			static void setDragTarget(int id, const Vector& target);
+			// Queue a message for every viewer
+			static void broadcast(std::shared_ptr<NetMsg> msg);
+			// Queue a message for one viewer
+			static void send(ReplicationViewer* viewer, std::shared_ptr<NetMsg> msg, size_t payload_bytes = 0);
+			// Record an object's latest pose and speed, later substeps overwrite earlier ones until the next flush
+			static void stagePose(const PoseRecord& pose, float speed);
+			// Record every link pose of one ragdoll, root first, ids consecutive. Instead of being scheduled per object
+			// they go out together in one message to every viewer interested in the root
+			static void stageRagdoll(const std::vector<PoseRecord>& links);
+			// The object just hit something, viewers should hear about it sooner
+			static void markContact(int id);
+			// Call once per frame, flushes whenever a replication tick is due
+			static void update(double frame_ms);
+			// Build this tick's batches and send every queue, elapsed_ms is the time since the previous flush
+			static void flush(double elapsed_ms);
+	};
+}
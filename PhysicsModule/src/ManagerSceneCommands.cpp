@@ -0,0 +1,551 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include "ManagerSceneCommands.h"
+#include "ManagerSceneQueries.h"
+#include "ManagerCollisionMeshes.h"
+#include "ManagerPhysics.h"
+#include "ManagerShards.h"
+#include "ManagerSimulationEvents.h"
+#include "ManagerVehicles.h"
+#include "ManagerReplication.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+#include "WorldContainer.h"
+#include "Model.h"
+
+using namespace Aftr;
+using namespace physx;
+
+std::mutex ManagerSceneCommands::queue_mutex;
+std::vector<SceneCommand> ManagerSceneCommands::queue;
+std::vector<SceneCommand> ManagerSceneCommands::applying;
+std::vector<WORigidActor*> ManagerSceneCommands::bindings;
+PxMaterial* ManagerSceneCommands::material = nullptr;
+std::vector<PxRigidActor*> ManagerSceneCommands::pending_actors;
+size_t ManagerSceneCommands::pruning_structure_actors = 64;
+bool ManagerSceneCommands::spawn_placement = true;
+unsigned int ManagerSceneCommands::spawn_max_deferrals = 30;
+std::vector<PxVec3> ManagerSceneCommands::search_offsets;
+std::vector<SceneCommand> ManagerSceneCommands::deferred;
+bool ManagerSceneCommands::space_freed = false;
+bool ManagerSceneCommands::bulk_report = false;
+std::vector<std::pair<PxBoxGeometry, PxTransform>> ManagerSceneCommands::pending_boxes;
+std::unordered_map<int64_t, std::vector<uint32_t>> ManagerSceneCommands::pending_cells;
+PxRigidDynamic* ManagerSceneCommands::drag_anchor = nullptr;
+PxD6Joint* ManagerSceneCommands::drag_joint = nullptr;
+int ManagerSceneCommands::drag_id = -1;
+PxVec3 ManagerSceneCommands::drag_target(0, 0, 0);
+float ManagerSceneCommands::drag_stiffness = 400;
+float ManagerSceneCommands::drag_damping = 40;
+
+void ManagerSceneCommands::init() {
+	material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	std::string pruning = ManagerEnvironmentConfiguration::getVariableValue("PruningStructureActors");
+	if (!pruning.empty()) pruning_structure_actors = std::stoul(pruning);
+	spawn_placement = ManagerEnvironmentConfiguration::getVariableValue("SpawnPlacement") != "0";
+	std::string deferrals = ManagerEnvironmentConfiguration::getVariableValue("SpawnMaxDeferrals");
+	if (!deferrals.empty()) spawn_max_deferrals = std::stoul(deferrals);
+	bulk_report = ManagerEnvironmentConfiguration::getVariableValue("BulkSpawnReport") == "1";
+	int slots = 2;
+	std::string search = ManagerEnvironmentConfiguration::getVariableValue("SpawnSearchSlots");
+	if (!search.empty()) slots = std::stoi(search);
+	// Every lattice slot within reach, nearest first and higher first among equals, so spawns stack up rather than dig in
+	for (int x = -slots; x <= slots; x++)
+		for (int y = -slots; y <= slots; y++)
+			for (int z = -slots; z <= slots; z++)
+				if (x != 0 || y != 0 || z != 0) search_offsets.push_back(PxVec3((float)x, (float)y, (float)z));
+	std::sort(search_offsets.begin(), search_offsets.end(), [](const PxVec3& a, const PxVec3& b) {
+		return a.magnitudeSquared() != b.magnitudeSquared() ? a.magnitudeSquared() < b.magnitudeSquared() : a.z > b.z;
+	});
+	std::string stiffness = ManagerEnvironmentConfiguration::getVariableValue("DragStiffness");
+	if (!stiffness.empty()) drag_stiffness = std::stof(stiffness);
+	std::string damping = ManagerEnvironmentConfiguration::getVariableValue("DragDamping");
+	if (!damping.empty()) drag_damping = std::stof(damping);
+}
+
+void ManagerSceneCommands::shutdown() {
+	applyRelease();
+	deferred.clear();
+	// Actors go with the scene and WOs with the world list, only the pairs are ours
+	for (WORigidActor* binding : bindings)
+		delete binding;
+	bindings.clear();
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	queue.clear();
+}
+
+void ManagerSceneCommands::enqueue(SceneCommand&& command) {
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	queue.push_back(std::move(command));
+}
+
+void ManagerSceneCommands::spawn(SceneSpawn spawn) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::Spawn;
+	command.spawn = std::move(spawn);
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::spawnBulk(SceneBulkSpawn bulk) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::SpawnBulk;
+	command.bulk = std::make_shared<SceneBulkSpawn>(std::move(bulk));
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::despawn(int id) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::Despawn;
+	command.id = id;
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::setPose(int id, const PxTransform& pose) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::SetPose;
+	command.id = id;
+	command.pose = pose;
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::addForce(int id, const PxVec3& force, PxForceMode::Enum mode) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::AddForce;
+	command.id = id;
+	command.force = force;
+	command.force_mode = mode;
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::moveDropZone(const Vector& location) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::MoveDropZone;
+	command.location = location;
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::grab(int id, const PxVec3& point) {
+	SceneCommand command;
+	command.type = SceneCommand::Type::Grab;
+	command.id = id;
+	command.pose = PxTransform(point);
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	drag_target = point; // Held still until the first dragTo
+	queue.push_back(std::move(command));
+}
+
+void ManagerSceneCommands::dragTo(const PxVec3& target) {
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	drag_target = target;
+}
+
+void ManagerSceneCommands::release() {
+	SceneCommand command;
+	command.type = SceneCommand::Type::Release;
+	enqueue(std::move(command));
+}
+
+void ManagerSceneCommands::apply(WorldContainer* world) {
+	PxVec3 target;
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		applying.swap(queue);
+		target = drag_target;
+	}
+	// Spawns whose wait for room is up go first, in the order they were asked for
+	ManagerCollisionMeshes::poll();
+	if (!deferred.empty()) {
+		uint64_t step = ManagerPhysics::getStepCount();
+		bool freed = space_freed;
+		auto due = std::stable_partition(deferred.begin(), deferred.end(),
+			[step, freed](const SceneCommand& command) { return freed || command.retry_step <= step; });
+		applying.insert(applying.begin(), std::make_move_iterator(deferred.begin()), std::make_move_iterator(due));
+		deferred.erase(deferred.begin(), due);
+	}
+	space_freed = false;
+
+
+	for (SceneCommand& command : applying) {
+		// Consecutive spawns share one insert, anything else needs them in the scene first
+		if (command.type != SceneCommand::Type::Spawn && command.type != SceneCommand::Type::SpawnBulk)
+			flushPendingActors();
+
+		switch (command.type) {
+		case SceneCommand::Type::Spawn:
+			// Models still cooking wait without using up their deferrals
+			if (!ready(command.spawn)) {
+				deferred.push_back(command);
+				break;
+			}
+			command.id = applySpawn(world, command.spawn, command.deferrals >= spawn_max_deferrals); // Kept for the callback
+			if (command.id < 0) deferSpawn(command);
+			break;
+		case SceneCommand::Type::SpawnBulk:
+			if (!ready(command.bulk->object)) {
+				deferred.push_back(command);
+				break;
+			}
+			command.id = applySpawnBulk(world, *command.bulk);
+			break;
+		case SceneCommand::Type::Despawn:
+			applyDespawn(world, command.id);
+			break;
+		case SceneCommand::Type::SetPose: {
+			WORigidActor* binding = getBinding(command.id);
+			if (binding == nullptr) break;
+			binding->actor->setGlobalPose(command.pose); // Wakes it, so the next step reports the new pose
+			break;
+		}
+		case SceneCommand::Type::AddForce: {
+			WORigidActor* binding = getBinding(command.id);
+			PxRigidBody* body = binding != nullptr ? binding->actor->is<PxRigidBody>() : nullptr;
+			if (body != nullptr) body->addForce(command.force, command.force_mode);
+			break;
+		}
+		case SceneCommand::Type::MoveDropZone: {
+			GLViewPhysicsModule* glv = ManagerGLView::getGLView<GLViewPhysicsModule>();
+			glv->drop_pos = command.location;
+			glv->track_sphere->setPosition(command.location);
+			ManagerReplication::moveDropZone(command.location);
+			break;
+		}
+		case SceneCommand::Type::Grab:
+			applyGrab(command.id, command.pose.p);
+			break;
+		case SceneCommand::Type::Release:
+			applyRelease();
+			break;
+		}
+	}
+	flushPendingActors();
+
+	// The anchor glides to the target over the step, the joint's spring pulls the object after it
+	if (drag_anchor != nullptr) {
+		drag_anchor->setKinematicTarget(PxTransform(target));
+		ManagerReplication::setDragTarget(drag_id, Vector(target.x, target.y, target.z));
+	}
+
+	// Callbacks run last, so they see every object from this batch in the scene
+	for (SceneCommand& command : applying) {
+		if (command.type == SceneCommand::Type::Spawn && command.spawn.on_spawned && command.id >= 0)
+			command.spawn.on_spawned(command.id);
+		if (command.type == SceneCommand::Type::SpawnBulk && command.bulk->on_spawned && command.id >= 0)
+			command.bulk->on_spawned(command.id, command.bulk->count);
+	}
+	applying.clear();
+}
+
+int ManagerSceneCommands::applySpawn(WorldContainer* world, SceneSpawn& spawn, bool force) {
+	if (spawn.model_path.empty())
+		spawn.model_path = ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl";
+
+	// Never start inside something, the solver would have to shove them apart
+	PxGeometryHolder geometry = geometryFor(spawn);
+	PxBoxGeometry box(spawn.half_extents.x, spawn.half_extents.y, spawn.half_extents.z);
+	PxTransform t(PxVec3(spawn.location.x, spawn.location.y, spawn.location.z), spawn.rotation);
+	if (!place(box, t) && !force)
+		return -1;
+	reserveSpace(box, t);
+
+	// Add the item to the physx world, the scene insert waits for flushPendingActors
+	PxShape* shape = ManagerPhysics::gPhysics->createShape(geometry.any(), *material);
+	PxRigidDynamic* actor = PxCreateDynamic(*ManagerPhysics::gPhysics, t, *shape, spawn.density);
+	shape->release(); // The actor holds the only reference now
+	return bind(world, spawn, t, actor);
+}
+
+bool ManagerSceneCommands::ready(SceneSpawn& spawn) {
+	if (spawn.model_path.empty())
+		spawn.model_path = ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl";
+	return !spawn.convex || ManagerCollisionMeshes::get(spawn.model_path, spawn.scale, CollisionMeshKind::Convex) != nullptr;
+}
+
+PxGeometryHolder ManagerSceneCommands::geometryFor(SceneSpawn& spawn) {
+	const CollisionMesh* mesh = spawn.convex ? ManagerCollisionMeshes::get(spawn.model_path, spawn.scale, CollisionMeshKind::Convex) : nullptr;
+	if (mesh == nullptr || mesh->failed())
+		return PxBoxGeometry(spawn.half_extents.x, spawn.half_extents.y, spawn.half_extents.z);
+	// Placement and layouts still work in boxes, big enough to hold the hull
+	PxVec3 extents = PxVec3(PxAbs(mesh->bounds.minimum.x), PxAbs(mesh->bounds.minimum.y), PxAbs(mesh->bounds.minimum.z))
+		.maximum(PxVec3(PxAbs(mesh->bounds.maximum.x), PxAbs(mesh->bounds.maximum.y), PxAbs(mesh->bounds.maximum.z)));
+	spawn.half_extents = Vector(extents.x, extents.y, extents.z);
+	return mesh->geometry();
+}
+
+int ManagerSceneCommands::applySpawnBulk(WorldContainer* world, SceneBulkSpawn& bulk) {
+	SceneSpawn& spawn = bulk.object;
+	if (spawn.model_path.empty())
+		spawn.model_path = ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl";
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Copies with no free slot nearby wait on their own like any other spawn
+	PxGeometryHolder geometry = geometryFor(spawn);
+	PxBoxGeometry box(spawn.half_extents.x, spawn.half_extents.y, spawn.half_extents.z);
+	std::vector<PxTransform> transforms;
+	std::vector<PxTransform> candidates = layout(bulk);
+	size_t layout_count = candidates.size();
+	for (PxTransform t : candidates) {
+		if (place(box, t)) {
+			reserveSpace(box, t);
+			transforms.push_back(t);
+			continue;
+		}
+		SceneCommand later;
+		later.type = SceneCommand::Type::Spawn;
+		later.spawn = spawn;
+		later.spawn.location = Vector(t.p.x, t.p.y, t.p.z);
+		later.spawn.rotation = t.q;
+		later.spawn.on_spawned = nullptr;
+		deferSpawn(later);
+	}
+	bulk.count = transforms.size(); // What the callback reports
+	if (transforms.empty()) return -1;
+
+	// Every copy shares one shape, and the mass properties are worked out once
+	PxShape* shape = ManagerPhysics::gPhysics->createShape(geometry.any(), *material);
+	PxRigidDynamic* first = ManagerPhysics::gPhysics->createRigidDynamic(transforms[0]);
+	first->attachShape(*shape);
+	PxRigidBodyExt::updateMassAndInertia(*first, spawn.density);
+	PxReal mass = first->getMass();
+	PxVec3 inertia = first->getMassSpaceInertiaTensor();
+	PxTransform mass_pose = first->getCMassLocalPose();
+
+	int first_id = bind(world, spawn, transforms[0], first);
+	for (size_t i = 1; i < transforms.size(); i++) {
+		PxRigidDynamic* actor = ManagerPhysics::gPhysics->createRigidDynamic(transforms[i]);
+		actor->attachShape(*shape);
+		actor->setMass(mass);
+		actor->setMassSpaceInertiaTensor(inertia);
+		actor->setCMassLocalPose(mass_pose);
+		bind(world, spawn, transforms[i], actor);
+	}
+	shape->release(); // The actors hold the only references now
+	double create_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	flushPendingActors();
+	double insert_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	if (bulk_report) {
+		std::cout << "Spawned " << transforms.size() << " objects in " << create_ms + insert_ms << " ms ("
+			<< insert_ms << " ms inserting)";
+		if (transforms.size() < layout_count) std::cout << ", " << layout_count - transforms.size() << " waiting for room";
+		std::cout << std::endl;
+	}
+	return first_id;
+}
+
+int ManagerSceneCommands::bind(WorldContainer* world, const SceneSpawn& spawn, const PxTransform& t, PxRigidDynamic* actor) {
+	// Add the item to the aftr world
+	WO* wo = WO::New(spawn.model_path, spawn.scale);
+	wo->setPosition(Vector(t.p.x, t.p.y, t.p.z));
+	world->push_back(wo);
+
+	// Register it for replication, viewers get the spawn on the next flush
+	PxMat33 rotation(t.q);
+	PoseRecord pose = {};
+	pose.location[0] = t.p.x;
+	pose.location[1] = t.p.y;
+	pose.location[2] = t.p.z;
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 3; col++)
+			pose.rotation[row * 3 + col] = rotation(row, col);
+	int id = ManagerReplication::addObject(spawn.model_path, spawn.scale, pose);
+
+	actor->setLinearVelocity(PxVec3(spawn.velocity.x, spawn.velocity.y, spawn.velocity.z));
+	ManagerPhysics::addCCDBody(actor);
+	ManagerSimulationEvents::watch(actor);
+	WORigidActor* combo = WORigidActor::New(wo, actor);
+	combo->id = id;
+	actor->userData = combo; // Physx knows its aftr counterpart
+	pending_actors.push_back(actor);
+
+	if ((size_t)id >= bindings.size())
+		bindings.resize(id + 1, nullptr);
+	bindings[id] = combo;
+	return id;
+}
+
+std::vector<PxTransform> ManagerSceneCommands::layout(const SceneBulkSpawn& bulk) {
+	const SceneSpawn& spawn = bulk.object;
+	PxVec3 center(spawn.location.x, spawn.location.y, spawn.location.z);
+	PxVec3 step(2 * spawn.half_extents.x + bulk.spacing, 2 * spawn.half_extents.y + bulk.spacing, 2 * spawn.half_extents.z + bulk.spacing);
+	std::mt19937 rng(bulk.seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<PxTransform> transforms;
+	transforms.reserve(bulk.count);
+
+	if (bulk.layout == SceneLayout::Random) {
+		std::normal_distribution<float> gaussian;
+		for (size_t i = 0; i < bulk.count; i++) {
+			PxVec3 offset(unit(rng) * bulk.extent.x, unit(rng) * bulk.extent.y, unit(rng) * bulk.extent.z);
+			PxQuat q(gaussian(rng), gaussian(rng), gaussian(rng), gaussian(rng)); // Uniform over rotations once normalized
+			transforms.push_back(PxTransform(center + offset, q.isSane() && q.magnitudeSquared() > 0 ? q.getNormalized() : spawn.rotation));
+		}
+		return transforms;
+	}
+
+	// Grid is one flat layer, a tower is a narrow stack and a pile is a wider, jittered, staggered stack
+	size_t side = 1;
+	if (bulk.layout == SceneLayout::Grid)
+		side = (size_t)std::ceil(std::sqrt((double)bulk.count));
+	else if (bulk.layout == SceneLayout::Tower)
+		side = std::max<size_t>(1, (size_t)std::ceil(std::cbrt((double)bulk.count) / 2));
+	else
+		side = std::max<size_t>(1, (size_t)std::ceil(std::cbrt((double)bulk.count)));
+	side = std::max<size_t>(side, 1);
+	float half = (side - 1) / 2.0f;
+	for (size_t i = 0; i < bulk.count; i++) {
+		size_t col = i % side;
+		size_t row = (i / side) % side;
+		size_t layer = i / (side * side);
+		PxVec3 offset((col - half) * step.x, (row - half) * step.y, layer * step.z);
+		PxQuat q = spawn.rotation;
+		if (bulk.layout == SceneLayout::Pile) {
+			// Every other layer sits half a box over so the stack slumps into a heap
+			offset.x += (layer % 2) * step.x / 2 + unit(rng) * bulk.spacing / 2;
+			offset.y += (layer % 2) * step.y / 2 + unit(rng) * bulk.spacing / 2;
+			q = PxQuat(unit(rng) * PxPi, PxVec3(0, 0, 1)) * q;
+		}
+		transforms.push_back(PxTransform(center + offset, q));
+	}
+	return transforms;
+}
+
+namespace {
+	// Pending objects are bucketed by their bounds in cells this big
+	const float PENDING_CELL = 8.0f;
+
+	int64_t cellKey(int x, int y, int z) {
+		return ((int64_t)(x & 0x1fffff) << 42) | ((int64_t)(y & 0x1fffff) << 21) | (int64_t)(z & 0x1fffff);
+	}
+
+	// Longest wait between two tries of a deferred spawn
+	const unsigned int MAX_RETRY_STEPS = 16;
+
+	template<class Visit>
+	void forEachCell(const PxBounds3& bounds, Visit visit) {
+		PxVec3 low = bounds.minimum / PENDING_CELL, high = bounds.maximum / PENDING_CELL;
+		for (int x = (int)std::floor(low.x); x <= (int)std::floor(high.x); x++)
+			for (int y = (int)std::floor(low.y); y <= (int)std::floor(high.y); y++)
+				for (int z = (int)std::floor(low.z); z <= (int)std::floor(high.z); z++)
+					visit(cellKey(x, y, z));
+	}
+}
+
+bool ManagerSceneCommands::isFree(const PxBoxGeometry& box, const PxTransform& pose) {
+	if (ManagerShards::anyOverlap(box, pose))
+		return false;
+	bool free = true;
+	forEachCell(PxGeometryQuery::getWorldBounds(box, pose), [&](int64_t key) {
+		auto cell = pending_cells.find(key);
+		if (!free || cell == pending_cells.end()) return;
+		for (uint32_t i : cell->second) {
+			if (PxGeometryQuery::overlap(box, pose, pending_boxes[i].first, pending_boxes[i].second)) {
+				free = false;
+				return;
+			}
+		}
+	});
+	return free;
+}
+
+bool ManagerSceneCommands::place(const PxBoxGeometry& box, PxTransform& pose) {
+	if (!spawn_placement || isFree(box, pose)) return true;
+	// Slots are as wide as the box at any rotation, plus a little air
+	float slot = 2.0f * box.halfExtents.magnitude() + 0.1f;
+	for (const PxVec3& offset : search_offsets) {
+		PxTransform candidate(pose.p + offset * slot, pose.q);
+		if (isFree(box, candidate)) {
+			pose = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ManagerSceneCommands::reserveSpace(const PxBoxGeometry& box, const PxTransform& pose) {
+	if (!spawn_placement) return;
+	uint32_t index = (uint32_t)pending_boxes.size();
+	pending_boxes.push_back(std::make_pair(box, pose));
+	forEachCell(PxGeometryQuery::getWorldBounds(box, pose), [&](int64_t key) { pending_cells[key].push_back(index); });
+}
+
+void ManagerSceneCommands::applyDespawn(WorldContainer* world, int id) {
+	WORigidActor* binding = getBinding(id);
+	if (binding == nullptr) return;
+	if (id == drag_id) applyRelease();
+	ManagerSceneQueries::forgetActor(binding->actor); // Queued queries may cache its shape
+	ManagerPhysics::removeCCDBody(binding->actor);
+	ManagerVehicles::detach(binding->actor);
+	ManagerShards::removeBody(binding->actor);
+	binding->actor->release();
+	world->eraseViaWOptr(binding->wo);
+	delete binding->wo;
+	delete binding;
+	bindings[id] = nullptr;
+	ManagerReplication::removeObject(id);
+	space_freed = true;
+}
+
+void ManagerSceneCommands::deferSpawn(SceneCommand& command) {
+	// A blocked spawn probes every search slot each try, so a crowd of them mustn't try every step
+	command.deferrals++;
+	command.retry_step = ManagerPhysics::getStepCount() + std::min(1u << std::min(command.deferrals, 4u), MAX_RETRY_STEPS);
+	deferred.push_back(command);
+}
+
+void ManagerSceneCommands::applyGrab(int id, const PxVec3& point) {
+	applyRelease();
+	WORigidActor* binding = getBinding(id);
+	PxRigidDynamic* body = binding != nullptr ? binding->actor->is<PxRigidDynamic>() : nullptr;
+	if (body == nullptr) return;
+
+	drag_anchor = ManagerPhysics::gPhysics->createRigidDynamic(PxTransform(point));
+	drag_anchor->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
+	body->getScene()->addActor(*drag_anchor); // No userData, it has no aftr side. Joints only hold within one shard
+
+	// Free in every direction, with a spring on position only so the object swings from the grab point
+	drag_joint = PxD6JointCreate(*ManagerPhysics::gPhysics, drag_anchor, PxTransform(PxIdentity), body, body->getGlobalPose().transformInv(PxTransform(point)));
+	PxD6JointDrive drive(drag_stiffness, drag_damping, PX_MAX_F32, true);
+	drag_joint->setMotion(PxD6Axis::eX, PxD6Motion::eFREE);
+	drag_joint->setMotion(PxD6Axis::eY, PxD6Motion::eFREE);
+	drag_joint->setMotion(PxD6Axis::eZ, PxD6Motion::eFREE);
+	drag_joint->setMotion(PxD6Axis::eTWIST, PxD6Motion::eFREE);
+	drag_joint->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
+	drag_joint->setMotion(PxD6Axis::eSWING2, PxD6Motion::eFREE);
+	drag_joint->setDrive(PxD6Drive::eX, drive);
+	drag_joint->setDrive(PxD6Drive::eY, drive);
+	drag_joint->setDrive(PxD6Drive::eZ, drive);
+	drag_joint->setDrivePosition(PxTransform(PxIdentity));
+	body->wakeUp();
+	drag_id = id;
+}
+
+void ManagerSceneCommands::applyRelease() {
+	if (drag_anchor == nullptr) return;
+	drag_joint->release();
+	drag_anchor->getScene()->removeActor(*drag_anchor);
+	drag_anchor->release();
+	drag_joint = nullptr;
+	drag_anchor = nullptr;
+	ManagerReplication::setDragTarget(-1, Vector(0, 0, 0));
+	drag_id = -1;
+}
+
+void ManagerSceneCommands::flushPendingActors() {
+	if (pending_actors.empty()) return;
+	// Each shard gets its part of the batch, with a pruning structure if the part is big enough
+	ManagerShards::addActors(pending_actors, pruning_structure_actors);
+	pending_actors.clear();
+	// In the scene now, where overlap queries see them
+	pending_boxes.clear();
+	pending_cells.clear();
+}
+
+WORigidActor* ManagerSceneCommands::getBinding(int id) {
+	if (id < 0 || id >= (int)bindings.size()) return nullptr;
+	return bindings[id];
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "Vector.h"
+#include "WORigidActor.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Aftr
+{
+	class WorldContainer;
+
+	// A dynamic box with a model, dropped into the scene
+	struct SceneSpawn {
+		std::string model_path; // Empty uses the red cube
+		Vector scale = Vector(1, 1, 1);
+		Vector half_extents = Vector(2, 2, 2); // Collision box
+		bool convex = false; // Collide with the model's cooked convex hull instead, half_extents then come from its bounds
+		float density = 10.0f;
+		Vector location;
+		physx::PxQuat rotation = physx::PxQuat(physx::PxIdentity);
+		Vector velocity = Vector(0, 0, 0);
+		std::function<void(int id)> on_spawned; // Runs on the main thread once the object exists
+	};
+
+	// How a bulk spawn arranges its objects around SceneSpawn::location
+	enum class SceneLayout { Grid, Pile, Tower, Random };
+
+	// Many copies of one object created in a single batch
+	struct SceneBulkSpawn {
+		SceneSpawn object; // Shared by every copy, its location is the layout's center
+		SceneLayout layout = SceneLayout::Grid;
+		size_t count = 1000;
+		float spacing = 0.5f; // Gap between neighbours in the grid, pile and tower layouts
+		Vector extent = Vector(50, 50, 50); // Half size of the volume for the random layout
+		unsigned int seed = 1;
+		// Ids are consecutive. Copies that had no room yet spawn later on their own and aren't counted
+		std::function<void(int first_id, size_t count)> on_spawned;
+	};
+
+	// One queued scene change
+	struct SceneCommand {
+		enum class Type { Spawn, SpawnBulk, Despawn, SetPose, AddForce, MoveDropZone, Grab, Release };
+		Type type;
+		int id = -1; // Target object for Despawn, SetPose, AddForce and Grab
+		SceneSpawn spawn;
+		std::shared_ptr<SceneBulkSpawn> bulk;
+		physx::PxTransform pose = physx::PxTransform(physx::PxIdentity); // For SetPose, and Grab's grab point
+		physx::PxVec3 force = physx::PxVec3(0, 0, 0);
+		physx::PxForceMode::Enum force_mode = physx::PxForceMode::eIMPULSE;
+		Vector location; // For MoveDropZone
+		unsigned int deferrals = 0; // Times a spawn found no room
+		uint64_t retry_step = 0; // A deferred spawn isn't placed again before this physics step
+	};
+
+	// This manager is meant to be a singleton that collects scene changes from any thread.
+	// They are applied together between physics steps on the main thread, so nothing ever touches the
+	// scene while simulate is in flight
+	class ManagerSceneCommands {
+		protected:
+			static std::mutex queue_mutex;
+			static std::vector<SceneCommand> queue;
+			static std::vector<SceneCommand> applying; // Swapped with queue so enqueuers never wait on apply
+			static std::vector<WORigidActor*> bindings; // Indexed by object id, nullptr once despawned
+			static physx::PxMaterial* material;
+			static std::vector<physx::PxRigidActor*> pending_actors; // Created this apply, inserted together
+			static size_t pruning_structure_actors; // Batches at least this big get a prebuilt pruning structure
+
+			// Spawn placement. New objects go to the nearest slot that overlaps nothing, or wait for one to open up
+			static bool spawn_placement;
+			static unsigned int spawn_max_deferrals; // After this many tries a spawn goes in regardless
+			static std::vector<physx::PxVec3> search_offsets; // Lattice slots around a spawn point, nearest first
+			static std::vector<SceneCommand> deferred; // Spawns retried once their retry_step comes
+			static bool space_freed; // Something despawned, so every deferred spawn may try again straight away
+			static bool bulk_report; // Print how long each bulk spawn took
+			// Objects created this apply aren't in the scene yet, so they're checked through a coarse grid
+			static std::vector<std::pair<physx::PxBoxGeometry, physx::PxTransform>> pending_boxes;
+			static std::unordered_map<int64_t, std::vector<uint32_t>> pending_cells;
+
+			// Dragging. The object is sprung to a kinematic anchor that follows the drag target every step
+			static physx::PxRigidDynamic* drag_anchor;
+			static physx::PxD6Joint* drag_joint;
+			static int drag_id;
+			static physx::PxVec3 drag_target; // Guarded by queue_mutex, only the latest target matters
+			static float drag_stiffness;
+			static float drag_damping;
+
+			static void enqueue(SceneCommand&& command);
+			// Fills in the default model and starts cooking its hull if needed. False until the hull is ready
+			static bool ready(SceneSpawn& spawn);
+			// The spawn's collision geometry, the box if it isn't convex or its hull failed to cook
+			static physx::PxGeometryHolder geometryFor(SceneSpawn& spawn);
+			// Returns -1 without spawning if there's no room and force is false
+			static int applySpawn(WorldContainer* world, SceneSpawn& spawn, bool force);
+			static int applySpawnBulk(WorldContainer* world, SceneBulkSpawn& bulk);
+			// Registers the object with the world and replication, the actor waits in pending_actors
+			static int bind(WorldContainer* world, const SceneSpawn& spawn, const physx::PxTransform& t, physx::PxRigidDynamic* actor);
+			static void applyDespawn(WorldContainer* world, int id);
+			// Puts a spawn that found no room back in deferred, waiting twice as long each time
+			static void deferSpawn(SceneCommand& command);
+			static bool isFree(const physx::PxBoxGeometry& box, const physx::PxTransform& pose);
+			// Moves the pose to the nearest free slot, false if every slot is taken
+			static bool place(const physx::PxBoxGeometry& box, physx::PxTransform& pose);
+			static void reserveSpace(const physx::PxBoxGeometry& box, const physx::PxTransform& pose);
+			static void applyGrab(int id, const physx::PxVec3& point);
+			static void applyRelease();
+			static void flushPendingActors();
+
+		public:
+			// Reads PruningStructureActors, SpawnPlacement, SpawnSearchSlots, SpawnMaxDeferrals, BulkSpawnReport,
+			// DragStiffness and DragDamping from aftr.conf
+			static void init();
+			static void shutdown();
+
+			// Any thread
+			static void spawn(SceneSpawn spawn);
+			static void spawnBulk(SceneBulkSpawn bulk);
+			static void despawn(int id);
+			static void setPose(int id, const physx::PxTransform& pose);
+			static void addForce(int id, const physx::PxVec3& force, physx::PxForceMode::Enum mode = physx::PxForceMode::eIMPULSE);
+			static void moveDropZone(const Vector& location);
+			// Start dragging an object by the world point it was grabbed at, letting go of anything else
+			static void grab(int id, const physx::PxVec3& point);
+			// Where the grabbed point should go. Not queued, the anchor moves to the newest target each step
+			static void dragTo(const physx::PxVec3& target);
+			static void release();
+
+			// Main thread, between steps. Applies everything queued so far in order
+			static void apply(WorldContainer* world);
+			// Main thread. The binding for an object id, nullptr if there isn't one
+			static WORigidActor* getBinding(int id);
+			// Where each object of a bulk spawn goes
+			static std::vector<physx::PxTransform> layout(const SceneBulkSpawn& bulk);
+	};
+}
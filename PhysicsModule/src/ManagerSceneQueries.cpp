@@ -0,0 +1,212 @@
+#include <algorithm>
+#include "ManagerSceneQueries.h"
+#include "ManagerPhysics.h"
+#include "ManagerShards.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "WORigidActor.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+std::mutex ManagerSceneQueries::queue_mutex;
+std::vector<SceneQuery> ManagerSceneQueries::queue;
+std::vector<SceneQuery> ManagerSceneQueries::running;
+std::vector<PxBatchQuery*> ManagerSceneQueries::batches;
+PxU32 ManagerSceneQueries::raycast_capacity = 0;
+PxU32 ManagerSceneQueries::sweep_capacity = 0;
+PxU32 ManagerSceneQueries::overlap_capacity = 0;
+PxU16 ManagerSceneQueries::overlap_touches = 64;
+std::vector<PxRaycastQueryResult> ManagerSceneQueries::raycast_results;
+std::vector<PxSweepQueryResult> ManagerSceneQueries::sweep_results;
+std::vector<PxOverlapQueryResult> ManagerSceneQueries::overlap_results;
+std::vector<PxOverlapHit> ManagerSceneQueries::overlap_hits;
+std::vector<SceneQueryHit> ManagerSceneQueries::closest;
+std::vector<char> ManagerSceneQueries::found;
+std::vector<std::vector<SceneQueryHit>> ManagerSceneQueries::touches;
+
+void ManagerSceneQueries::init() {
+	std::string touches = ManagerEnvironmentConfiguration::getVariableValue("SceneQueryOverlapTouches");
+	if (!touches.empty()) overlap_touches = (PxU16)std::min(std::max(std::stoul(touches), 1ul), 0xfffful);
+	reserve(64, 16, 16);
+}
+
+void ManagerSceneQueries::shutdown() {
+	for (PxBatchQuery* batch : batches)
+		batch->release();
+	batches.clear();
+}
+
+void ManagerSceneQueries::raycast(const PxVec3& origin, const PxVec3& direction, float distance, SceneHitCallback on_hit, PxQueryFlags flags, const PxQueryCache* cache) {
+	SceneQuery query;
+	query.type = SceneQuery::Type::Raycast;
+	query.origin = origin;
+	query.direction = direction.getNormalized();
+	query.distance = distance;
+	query.flags = flags;
+	if (cache != nullptr) {
+		query.cache = *cache;
+		query.has_cache = true;
+	}
+	query.on_hit = std::move(on_hit);
+	enqueue(std::move(query));
+}
+
+void ManagerSceneQueries::sweep(const PxGeometry& geometry, const PxTransform& pose, const PxVec3& direction, float distance, SceneHitCallback on_hit, PxQueryFlags flags) {
+	SceneQuery query;
+	query.type = SceneQuery::Type::Sweep;
+	query.geometry.storeAny(geometry);
+	query.pose = pose;
+	query.direction = direction.getNormalized();
+	query.distance = distance;
+	query.flags = flags;
+	query.on_hit = std::move(on_hit);
+	enqueue(std::move(query));
+}
+
+void ManagerSceneQueries::overlap(const PxGeometry& geometry, const PxTransform& pose, SceneOverlapCallback on_overlap, PxQueryFlags flags) {
+	SceneQuery query;
+	query.type = SceneQuery::Type::Overlap;
+	query.geometry.storeAny(geometry);
+	query.pose = pose;
+	query.flags = flags | PxQueryFlag::eNO_BLOCK; // Every overlap is a touch, so all of them are reported
+	query.on_overlap = std::move(on_overlap);
+	enqueue(std::move(query));
+}
+
+void ManagerSceneQueries::enqueue(SceneQuery&& query) {
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	queue.push_back(std::move(query));
+}
+
+void ManagerSceneQueries::reserve(PxU32 raycasts, PxU32 sweeps, PxU32 overlaps) {
+	// ManagerShards may start after the first batch was made
+	const std::vector<PxScene*>& scenes = ManagerShards::getScenes();
+	size_t shards = std::max(scenes.size(), (size_t)1);
+	if (batches.size() == shards && raycasts <= raycast_capacity && sweeps <= sweep_capacity && overlaps <= overlap_capacity)
+		return;
+	// Double whatever ran out so a growing load doesn't rebuild the batch every frame
+	auto grow = [](PxU32 capacity, PxU32 needed) { return needed <= capacity ? capacity : std::max(needed, 2 * capacity); };
+	raycast_capacity = grow(raycast_capacity, raycasts);
+	sweep_capacity = grow(sweep_capacity, sweeps);
+	overlap_capacity = grow(overlap_capacity, overlaps);
+	raycast_results.resize(raycast_capacity);
+	sweep_results.resize(sweep_capacity);
+	overlap_results.resize(overlap_capacity);
+	overlap_hits.resize((size_t)overlap_capacity * overlap_touches);
+
+	for (PxBatchQuery* batch : batches)
+		batch->release();
+	batches.clear();
+	// The shards run one after the other, so they can share the result buffers
+	PxBatchQueryDesc desc(raycast_capacity, sweep_capacity, overlap_capacity);
+	desc.queryMemory.userRaycastResultBuffer = raycast_results.data();
+	desc.queryMemory.userSweepResultBuffer = sweep_results.data();
+	desc.queryMemory.userOverlapResultBuffer = overlap_results.data();
+	desc.queryMemory.userOverlapTouchBuffer = overlap_hits.data();
+	desc.queryMemory.overlapTouchBufferSize = (PxU32)overlap_hits.size();
+	if (scenes.empty())
+		batches.push_back(ManagerPhysics::scene->createBatchQuery(desc));
+	for (PxScene* scene : scenes)
+		batches.push_back(scene->createBatchQuery(desc));
+}
+
+void ManagerSceneQueries::forgetActor(PxRigidActor* actor) {
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	for (SceneQuery& query : queue) {
+		if (query.has_cache && query.cache.actor == actor)
+			query.has_cache = false;
+	}
+}
+
+SceneQueryHit ManagerSceneQueries::toHit(const PxQueryHit& hit) {
+	SceneQueryHit result;
+	result.actor = hit.actor;
+	result.shape = hit.shape;
+	// Spawned objects keep their binding in userData, static geometry keeps its WO there instead
+	if (hit.actor != nullptr && hit.actor->is<PxRigidDynamic>() && hit.actor->userData != nullptr)
+		result.id = static_cast<WORigidActor*>(hit.actor->userData)->id;
+	return result;
+}
+
+void ManagerSceneQueries::keepClosest(size_t index, bool has_block, const PxLocationHit& block) {
+	if (!has_block || (found[index] && closest[index].distance <= block.distance)) return;
+	SceneQueryHit& hit = closest[index];
+	hit = toHit(block);
+	hit.position = block.position;
+	hit.normal = block.normal;
+	hit.distance = block.distance;
+	found[index] = 1;
+}
+
+void ManagerSceneQueries::run() {
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		running.swap(queue);
+	}
+	if (running.empty()) return;
+
+	PxU32 raycasts = 0, sweeps = 0, overlaps = 0;
+	for (const SceneQuery& query : running) {
+		if (query.type == SceneQuery::Type::Raycast) raycasts++;
+		else if (query.type == SceneQuery::Type::Sweep) sweeps++;
+		else overlaps++;
+	}
+	reserve(raycasts, sweeps, overlaps);
+	closest.resize(running.size());
+	found.assign(running.size(), 0);
+	touches.resize(std::max(touches.size(), running.size()));
+	for (size_t i = 0; i < running.size(); i++)
+		touches[i].clear();
+
+	const std::vector<PxScene*>& scenes = ManagerShards::getScenes();
+	for (size_t shard = 0; shard < batches.size(); shard++) {
+		PxBatchQuery* batch = batches[shard];
+		PxScene* scene = shard < scenes.size() ? scenes[shard] : ManagerPhysics::scene;
+		// The query's index rides along as userData so results find their callback
+		for (size_t i = 0; i < running.size(); i++) {
+			SceneQuery& query = running[i];
+			PxQueryFilterData filter(query.flags);
+			// A cached shape only helps in the shard it is in
+			const PxQueryCache* cache = query.has_cache && query.cache.actor != nullptr && query.cache.actor->getScene() == scene ? &query.cache : nullptr;
+			switch (query.type) {
+			case SceneQuery::Type::Raycast:
+				batch->raycast(query.origin, query.direction, query.distance, 0, PxHitFlag::eDEFAULT, filter, (void*)i, cache);
+				break;
+			case SceneQuery::Type::Sweep:
+				batch->sweep(query.geometry.any(), query.pose, query.direction, query.distance, 0, PxHitFlag::eDEFAULT, filter, (void*)i);
+				break;
+			case SceneQuery::Type::Overlap:
+				batch->overlap(query.geometry.any(), query.pose, overlap_touches, filter, (void*)i);
+				break;
+			}
+		}
+		batch->execute();
+
+		for (PxU32 i = 0; i < raycasts; i++) {
+			const PxRaycastQueryResult& result = raycast_results[i];
+			keepClosest((size_t)result.userData, result.hasBlock, result.block);
+		}
+		for (PxU32 i = 0; i < sweeps; i++) {
+			const PxSweepQueryResult& result = sweep_results[i];
+			keepClosest((size_t)result.userData, result.hasBlock, result.block);
+		}
+		for (PxU32 i = 0; i < overlaps; i++) {
+			const PxOverlapQueryResult& result = overlap_results[i];
+			std::vector<SceneQueryHit>& hits = touches[(size_t)result.userData];
+			for (PxU32 j = 0; j < result.getNbAnyHits(); j++)
+				hits.push_back(toHit(result.getAnyHit(j)));
+		}
+	}
+
+	for (size_t i = 0; i < running.size(); i++) {
+		SceneQuery& query = running[i];
+		if (query.type == SceneQuery::Type::Overlap) {
+			if (query.on_overlap) query.on_overlap(touches[i]);
+		}
+		else if (query.on_hit) {
+			query.on_hit(found[i] ? &closest[i] : nullptr);
+		}
+	}
+	running.clear();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Aftr
+{
+	// One thing a query touched. Only valid inside the callback it was handed to
+	struct SceneQueryHit {
+		physx::PxRigidActor* actor = nullptr;
+		physx::PxShape* shape = nullptr;
+		int id = -1; // Object id if the actor is a spawned object
+		physx::PxVec3 position = physx::PxVec3(0, 0, 0); // Not set for overlaps
+		physx::PxVec3 normal = physx::PxVec3(0, 0, 0); // Not set for overlaps
+		float distance = 0; // Not set for overlaps
+	};
+
+	// Called with the closest hit, or nullptr if nothing was hit
+	typedef std::function<void(const SceneQueryHit* hit)> SceneHitCallback;
+	// Called with everything the geometry overlaps, possibly nothing
+	typedef std::function<void(const std::vector<SceneQueryHit>& hits)> SceneOverlapCallback;
+
+	// One queued raycast, sweep or overlap
+	struct SceneQuery {
+		enum class Type { Raycast, Sweep, Overlap };
+		Type type;
+		physx::PxVec3 origin; // Raycast
+		physx::PxVec3 direction; // Raycast and sweep, normalized
+		float distance = 0; // Raycast and sweep
+		physx::PxGeometryHolder geometry; // Sweep and overlap
+		physx::PxTransform pose; // Sweep and overlap
+		physx::PxQueryFlags flags;
+		physx::PxQueryCache cache;
+		bool has_cache = false;
+		SceneHitCallback on_hit;
+		SceneOverlapCallback on_overlap;
+	};
+
+	// This manager is meant to be a singleton that collects scene queries from game code during a frame.
+	// They run together as one PxBatchQuery per shard after the frame's last step, and each caller gets the
+	// closest hit or every touch across the shards through a callback on the main thread
+	class ManagerSceneQueries {
+		protected:
+			static std::mutex queue_mutex;
+			static std::vector<SceneQuery> queue;
+			static std::vector<SceneQuery> running; // Swapped with queue so callers never wait on a run
+			static std::vector<physx::PxBatchQuery*> batches; // One per shard, same order as ManagerShards::getScenes
+			static physx::PxU32 raycast_capacity;
+			static physx::PxU32 sweep_capacity;
+			static physx::PxU32 overlap_capacity;
+			static physx::PxU16 overlap_touches; // Most objects one overlap reports
+			static std::vector<physx::PxRaycastQueryResult> raycast_results;
+			static std::vector<physx::PxSweepQueryResult> sweep_results;
+			static std::vector<physx::PxOverlapQueryResult> overlap_results;
+			static std::vector<physx::PxOverlapHit> overlap_hits;
+			static std::vector<SceneQueryHit> closest; // By query, valid where found is set
+			static std::vector<char> found;
+			static std::vector<std::vector<SceneQueryHit>> touches; // By query
+
+			static void enqueue(SceneQuery&& query);
+			// Grows the batches and their result buffers to hold at least this many of each
+			static void reserve(physx::PxU32 raycasts, physx::PxU32 sweeps, physx::PxU32 overlaps);
+			static SceneQueryHit toHit(const physx::PxQueryHit& hit);
+			// Keeps the result of a raycast or sweep if it is the closest so far
+			static void keepClosest(size_t index, bool has_block, const physx::PxLocationHit& block);
+
+		public:
+			// Reads SceneQueryOverlapTouches from aftr.conf
+			static void init();
+			static void shutdown();
+
+			// Any thread
+			static void raycast(const physx::PxVec3& origin, const physx::PxVec3& direction, float distance, SceneHitCallback on_hit,
+				physx::PxQueryFlags flags = physx::PxQueryFlag::eSTATIC | physx::PxQueryFlag::eDYNAMIC, const physx::PxQueryCache* cache = nullptr);
+			static void sweep(const physx::PxGeometry& geometry, const physx::PxTransform& pose, const physx::PxVec3& direction, float distance,
+				SceneHitCallback on_hit, physx::PxQueryFlags flags = physx::PxQueryFlag::eSTATIC | physx::PxQueryFlag::eDYNAMIC);
+			static void overlap(const physx::PxGeometry& geometry, const physx::PxTransform& pose, SceneOverlapCallback on_overlap,
+				physx::PxQueryFlags flags = physx::PxQueryFlag::eSTATIC | physx::PxQueryFlag::eDYNAMIC);
+
+			// Main thread. Drops cached shapes of an actor about to be released from queries still queued
+			static void forgetActor(physx::PxRigidActor* actor);
+			// Main thread, with the scene idle. Runs everything queued so far and calls back with the results
+			static void run();
+	};
+}
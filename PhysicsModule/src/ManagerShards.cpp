@@ -0,0 +1,360 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "ManagerShards.h"
+#include "ManagerPhysics.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+int ManagerShards::grid = 1;
+float ManagerShards::tile_size = 100;
+float ManagerShards::ghost_margin = 4;
+int ManagerShards::home = 0;
+PxDefaultCpuDispatcher* ManagerShards::dispatcher = nullptr;
+std::vector<PxScene*> ManagerShards::scenes;
+std::unordered_map<PxRigidActor*, ManagerShards::Body> ManagerShards::bodies;
+std::unordered_map<PxRigidActor*, std::vector<PxRigidStatic*>> ManagerShards::mirrors;
+std::vector<PxActor*> ManagerShards::active;
+std::vector<std::vector<PxRigidActor*>> ManagerShards::grouped;
+std::vector<int> ManagerShards::touched;
+uint64_t ManagerShards::migrations = 0;
+
+void ManagerShards::init() {
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("PhysicsShardGrid");
+	if (!value.empty()) grid = std::min(std::max(std::stoi(value), 1), 16);
+	value = ManagerEnvironmentConfiguration::getVariableValue("PhysicsShardTileSize");
+	if (!value.empty()) tile_size = std::max(1.0f, std::stof(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("PhysicsShardGhostMargin");
+	if (!value.empty()) ghost_margin = std::max(0.0f, std::stof(value));
+	unsigned int threads = (unsigned int)std::max(grid * grid - 1, 1);
+	value = ManagerEnvironmentConfiguration::getVariableValue("PhysicsShardThreads");
+	if (!value.empty()) threads = std::max(1u, (unsigned int)std::stoul(value));
+
+	PxScene* primary = ManagerPhysics::scene;
+	if (grid == 1) {
+		scenes.push_back(primary);
+		home = 0;
+		return;
+	}
+	home = tileOf(PxVec3(0, 0, 0));
+	dispatcher = PxDefaultCpuDispatcherCreate(threads);
+	// Same rules as the home scene, so a body can't tell which scene it's in
+	PxSceneDesc desc(ManagerPhysics::gPhysics->getTolerancesScale());
+	desc.gravity = primary->getGravity();
+	desc.cpuDispatcher = dispatcher;
+	desc.filterShader = ManagerPhysics::filterShader;
+	desc.filterShaderData = primary->getFilterShaderData();
+	desc.filterShaderDataSize = primary->getFilterShaderDataSize();
+	desc.simulationEventCallback = primary->getSimulationEventCallback();
+	desc.flags = primary->getFlags();
+	desc.staticKineFilteringMode = PxPairFilteringMode::eKEEP;
+	for (int tile = 0; tile < grid * grid; tile++) {
+		PxScene* scene = tile == home ? primary : ManagerPhysics::gPhysics->createScene(desc);
+		if (scene == nullptr) {
+			std::cout << "Unable to create the physics shard scenes, stepping one scene" << std::endl;
+			shutdown();
+			grid = 1;
+			scenes.push_back(primary);
+			home = 0;
+			return;
+		}
+		scenes.push_back(scene);
+	}
+	grouped.resize(scenes.size());
+
+	PxU32 count = primary->getNbActors(PxActorTypeFlag::eRIGID_STATIC);
+	std::vector<PxActor*> statics(count);
+	primary->getActors(PxActorTypeFlag::eRIGID_STATIC, statics.data(), count);
+	size_t copies = 0;
+	for (PxActor* actor : statics)
+		mirror(actor->is<PxRigidStatic>());
+	for (auto& source : mirrors)
+		copies += source.second.size();
+	std::cout << "Physics shards: " << grid << "x" << grid << " tiles of " << tile_size << " m on " << threads << " thread(s), "
+		<< copies << " static copies" << std::endl;
+}
+
+void ManagerShards::shutdown() {
+	if (isSharded())
+		std::cout << "Physics shards: " << migrations << " migrations" << std::endl;
+	for (auto& body : bodies) {
+		for (const std::pair<int, PxRigidDynamic*>& ghost : body.second.ghosts)
+			releaseGhost(ghost.second);
+	}
+	bodies.clear();
+	for (auto& source : mirrors) {
+		for (PxRigidStatic* copy : source.second) {
+			if (copy->getScene() != nullptr) copy->getScene()->removeActor(*copy);
+			copy->release();
+		}
+	}
+	mirrors.clear();
+	// The home scene is ManagerPhysics' to release, and the spawned bodies go with the physics
+	for (PxScene* scene : scenes) {
+		if (scene == ManagerPhysics::scene) continue;
+		scene->setSimulationEventCallback(nullptr); // ManagerSimulationEvents outlives the shards
+		scene->release();
+	}
+	scenes.clear();
+	grouped.clear();
+	active.clear();
+	if (dispatcher != nullptr) dispatcher->release();
+	dispatcher = nullptr;
+}
+
+bool ManagerShards::isSharded() {
+	return scenes.size() > 1;
+}
+
+int ManagerShards::tileOf(const PxVec3& position) {
+	float low = -grid * tile_size / 2;
+	// Clamped as floats, so bounds out at infinity land on the edge too
+	float col = std::max(0.0f, std::min(grid - 1.0f, std::floor((position.x - low) / tile_size)));
+	float row = std::max(0.0f, std::min(grid - 1.0f, std::floor((position.y - low) / tile_size)));
+	return (int)row * grid + (int)col;
+}
+
+void ManagerShards::tilesOf(const PxBounds3& bounds, std::vector<int>& tiles) {
+	tiles.clear();
+	int low = tileOf(bounds.minimum), high = tileOf(bounds.maximum);
+	for (int row = low / grid; row <= high / grid; row++)
+		for (int col = low % grid; col <= high % grid; col++)
+			tiles.push_back(row * grid + col);
+}
+
+void ManagerShards::copyShapes(PxRigidActor& from, PxRigidActor& to) {
+	std::vector<PxShape*> shapes(from.getNbShapes());
+	from.getShapes(shapes.data(), (PxU32)shapes.size());
+	std::vector<PxMaterial*> materials;
+	for (PxShape* shape : shapes) {
+		if (!(shape->getFlags() & PxShapeFlag::eSIMULATION_SHAPE)) continue;
+		materials.resize(shape->getNbMaterials());
+		shape->getMaterials(materials.data(), (PxU32)materials.size());
+		PxShape* copy = ManagerPhysics::gPhysics->createShape(shape->getGeometry().any(), materials.data(), (PxU16)materials.size(), true,
+			PxShapeFlag::eSIMULATION_SHAPE);
+		copy->setLocalPose(shape->getLocalPose());
+		copy->setSimulationFilterData(shape->getSimulationFilterData());
+		copy->setContactOffset(shape->getContactOffset());
+		copy->setRestOffset(shape->getRestOffset());
+		to.attachShape(*copy);
+		copy->release(); // The actor holds it now
+	}
+}
+
+void ManagerShards::mirror(PxRigidStatic* source) {
+	if (source == nullptr) return;
+	// A body counts as in the tile of its center, so it can reach half a tile past the border
+	PxBounds3 bounds = source->getWorldBounds();
+	bounds.fattenFast(tile_size / 2);
+	tilesOf(bounds, touched);
+	for (int tile : touched) {
+		if (tile == home) continue;
+		PxRigidStatic* copy = ManagerPhysics::gPhysics->createRigidStatic(source->getGlobalPose());
+		copyShapes(*source, *copy);
+		if (copy->getNbShapes() == 0) {
+			copy->release();
+			continue;
+		}
+		copy->userData = source->userData; // Contacts with the copy look like contacts with the original
+		scenes[tile]->addActor(*copy);
+		mirrors[source].push_back(copy);
+	}
+}
+
+void ManagerShards::refreshStatic(PxRigidActor* source) {
+	auto found = mirrors.find(source);
+	if (found == mirrors.end()) return;
+	std::vector<PxShape*> shapes(source->getNbShapes());
+	source->getShapes(shapes.data(), (PxU32)shapes.size());
+	std::vector<PxShape*> copied(shapes.size());
+	for (PxRigidStatic* copy : found->second) {
+		// The copies have the source's simulation shapes in the same order
+		PxU32 count = copy->getShapes(copied.data(), (PxU32)copied.size());
+		PxU32 next = 0;
+		for (PxShape* shape : shapes) {
+			if (!(shape->getFlags() & PxShapeFlag::eSIMULATION_SHAPE) || next >= count) continue;
+			copied[next++]->setGeometry(shape->getGeometry().any());
+		}
+	}
+}
+
+const std::vector<PxScene*>& ManagerShards::getScenes() {
+	return scenes;
+}
+
+PxScene* ManagerShards::getSceneAt(const PxVec3& position) {
+	return isSharded() ? scenes[tileOf(position)] : ManagerPhysics::scene;
+}
+
+void ManagerShards::simulate(float step_s) {
+	if (!isSharded()) {
+		ManagerPhysics::scene->simulate(step_s);
+		ManagerPhysics::scene->fetchResults(true);
+		return;
+	}
+	for (PxScene* scene : scenes)
+		scene->simulate(step_s);
+	// The events of each scene are reported here on the main thread, one scene after the other
+	active.clear();
+	for (PxScene* scene : scenes) {
+		scene->fetchResults(true);
+		PxU32 count = 0;
+		PxActor** actors = scene->getActiveActors(count);
+		active.insert(active.end(), actors, actors + count);
+	}
+}
+
+PxActor** ManagerShards::getActiveActors(PxU32& count) {
+	if (!isSharded()) return ManagerPhysics::scene->getActiveActors(count);
+	count = (PxU32)active.size();
+	return active.data();
+}
+
+void ManagerShards::migrate() {
+	if (!isSharded()) return;
+	for (PxActor* actor : active) {
+		PxRigidDynamic* dynamic = actor->is<PxRigidDynamic>();
+		auto found = dynamic != nullptr ? bodies.find(dynamic) : bodies.end();
+		if (found == bodies.end()) continue;
+		Body& body = found->second;
+		PxTransform pose = dynamic->getGlobalPose();
+		int tile = tileOf(pose.p);
+		// Joints can't reach across scenes, so a held body stays put until it's let go
+		if (tile != body.tile && !body.pinned && dynamic->getNbConstraints() == 0)
+			move(dynamic, body, tile);
+
+		PxBounds3 bounds = dynamic->getWorldBounds();
+		bounds.fattenFast(ghost_margin);
+		tilesOf(bounds, touched);
+		for (size_t i = 0; i < body.ghosts.size();) {
+			int ghost_tile = body.ghosts[i].first;
+			if (ghost_tile != body.tile && std::find(touched.begin(), touched.end(), ghost_tile) != touched.end()) {
+				i++;
+				continue;
+			}
+			releaseGhost(body.ghosts[i].second);
+			body.ghosts[i] = body.ghosts.back();
+			body.ghosts.pop_back();
+		}
+		for (int ghost_tile : touched) {
+			if (ghost_tile == body.tile) continue;
+			auto ghost = std::find_if(body.ghosts.begin(), body.ghosts.end(),
+				[ghost_tile](const std::pair<int, PxRigidDynamic*>& standing) { return standing.first == ghost_tile; });
+			if (ghost != body.ghosts.end()) {
+				ghost->second->setKinematicTarget(pose);
+				continue;
+			}
+			PxRigidDynamic* created = ManagerPhysics::gPhysics->createRigidDynamic(pose);
+			created->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
+			copyShapes(*dynamic, *created);
+			scenes[ghost_tile]->addActor(*created); // No userData, it has no aftr side
+			body.ghosts.push_back(std::make_pair(ghost_tile, created));
+		}
+	}
+}
+
+void ManagerShards::move(PxRigidDynamic* actor, Body& body, int tile) {
+	// Leaving a scene forgets the velocities
+	PxVec3 linear = actor->getLinearVelocity(), angular = actor->getAngularVelocity();
+	PxScene* from = actor->getScene();
+	from->removeActor(*actor, false);
+	scenes[tile]->addActor(*actor);
+	if (!(actor->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)) {
+		actor->setLinearVelocity(linear);
+		actor->setAngularVelocity(angular);
+	}
+	ManagerPhysics::moveCCDBody(actor, from);
+	body.tile = tile;
+	migrations++;
+}
+
+void ManagerShards::releaseGhost(PxRigidDynamic* ghost) {
+	if (ghost->getScene() != nullptr) ghost->getScene()->removeActor(*ghost);
+	ghost->release();
+}
+
+void ManagerShards::addGroup(PxScene* scene, std::vector<PxRigidActor*>& actors, size_t pruning_minimum) {
+	if (actors.empty()) return;
+	// A prebuilt pruning structure drops the whole batch into the scene query tree at once
+	PxPruningStructure* pruning = nullptr;
+	if (actors.size() >= pruning_minimum && pruning_minimum > 0)
+		pruning = ManagerPhysics::gPhysics->createPruningStructure(actors.data(), (PxU32)actors.size());
+	if (pruning != nullptr) {
+		scene->addActors(*pruning);
+		pruning->release();
+	}
+	else {
+		std::vector<PxActor*> added(actors.begin(), actors.end());
+		scene->addActors(added.data(), (PxU32)added.size());
+	}
+	actors.clear();
+}
+
+void ManagerShards::addActors(const std::vector<PxRigidActor*>& actors, size_t pruning_minimum) {
+	if (!isSharded()) {
+		std::vector<PxRigidActor*> all(actors);
+		addGroup(ManagerPhysics::scene, all, pruning_minimum);
+		return;
+	}
+	for (PxRigidActor* actor : actors) {
+		// Statics stay home and are copied out like the level's
+		int tile = actor->is<PxRigidDynamic>() != nullptr ? tileOf(actor->getGlobalPose().p) : home;
+		if (tile != home || actor->is<PxRigidDynamic>() != nullptr) bodies[actor].tile = tile;
+		grouped[tile].push_back(actor);
+	}
+	for (size_t tile = 0; tile < grouped.size(); tile++)
+		addGroup(scenes[tile], grouped[tile], pruning_minimum);
+	for (PxRigidActor* actor : actors) {
+		if (actor->is<PxRigidStatic>() != nullptr) mirror(actor->is<PxRigidStatic>());
+	}
+}
+
+void ManagerShards::pinHome(PxRigidActor* actor) {
+	auto found = bodies.find(actor);
+	if (found == bodies.end()) return;
+	found->second.pinned = true;
+	PxRigidDynamic* dynamic = actor->is<PxRigidDynamic>();
+	if (dynamic != nullptr && found->second.tile != home)
+		move(dynamic, found->second, home);
+}
+
+void ManagerShards::removeBody(PxRigidActor* actor) {
+	auto found = bodies.find(actor);
+	if (found != bodies.end()) {
+		for (const std::pair<int, PxRigidDynamic*>& ghost : found->second.ghosts)
+			releaseGhost(ghost.second);
+		bodies.erase(found);
+	}
+	auto copies = mirrors.find(actor);
+	if (copies != mirrors.end()) {
+		for (PxRigidStatic* copy : copies->second) {
+			copy->getScene()->removeActor(*copy);
+			copy->release();
+		}
+		mirrors.erase(copies);
+	}
+	if (actor->getScene() != nullptr) actor->getScene()->removeActor(*actor);
+}
+
+PxU32 ManagerShards::overlap(const PxGeometry& geometry, const PxTransform& pose, PxOverlapHit* hits, PxU32 capacity, PxQueryFlags flags) {
+	PxU32 found = 0;
+	for (PxScene* scene : scenes) {
+		if (found >= capacity) break;
+		PxOverlapBuffer buffer(hits + found, capacity - found);
+		scene->overlap(geometry, pose, buffer, PxQueryFilterData(flags | PxQueryFlag::eNO_BLOCK));
+		found += buffer.getNbTouches();
+	}
+	return found;
+}
+
+bool ManagerShards::anyOverlap(const PxGeometry& geometry, const PxTransform& pose) {
+	PxQueryFilterData filter(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eANY_HIT);
+	for (PxScene* scene : scenes) {
+		PxOverlapBuffer hit;
+		if (scene->overlap(geometry, pose, hit, filter)) return true;
+	}
+	return false;
+}
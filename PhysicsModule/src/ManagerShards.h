@@ -0,0 +1,84 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace Aftr
+{
+	// This manager is meant to be a singleton that splits the world into a grid of square tiles, each simulated by
+	// its own PxScene so the serial parts of a step run side by side. The tile around the origin keeps
+	// ManagerPhysics::scene, and with it everything that isn't a spawned object. The other scenes get copies of the
+	// statics, and spawned bodies move to whichever tile their center is in. A body near a border also leaves a
+	// kinematic ghost in the tiles next to it, so bodies over there are pushed by it, though they can't push back.
+	// Only the home tile has triggers, the camera's controller and ragdolls. Tanks are pinned there, their suspension
+	// rays only see ManagerPhysics::scene
+	class ManagerShards {
+		protected:
+			struct Body {
+				int tile = 0;
+				bool pinned = false; // Stays in the home tile wherever it goes
+				std::vector<std::pair<int, physx::PxRigidDynamic*>> ghosts; // Tile and the ghost standing in there
+			};
+
+			static int grid; // Tiles per side, 1 leaves everything in ManagerPhysics::scene
+			static float tile_size;
+			static float ghost_margin; // How close to a tile a body has to be to get a ghost in it
+			static int home; // Tile of the origin, simulated by ManagerPhysics::scene
+			static physx::PxDefaultCpuDispatcher* dispatcher; // Shared by every scene but the home one
+			static std::vector<physx::PxScene*> scenes; // By tile, row major
+			static std::unordered_map<physx::PxRigidActor*, Body> bodies;
+			static std::unordered_map<physx::PxRigidActor*, std::vector<physx::PxRigidStatic*>> mirrors; // Copies of each static
+			static std::vector<physx::PxActor*> active; // Active actors of every scene after the last step
+			static std::vector<std::vector<physx::PxRigidActor*>> grouped; // Actors being added, by tile
+			static std::vector<int> touched;
+			static uint64_t migrations;
+
+			static bool isSharded();
+			// Positions outside the grid belong to the nearest edge tile
+			static int tileOf(const physx::PxVec3& position);
+			static void tilesOf(const physx::PxBounds3& bounds, std::vector<int>& tiles);
+			// Copies the simulation shapes of from onto to, out of the query tree. Triggers and query only shapes stay behind
+			static void copyShapes(physx::PxRigidActor& from, physx::PxRigidActor& to);
+			static void mirror(physx::PxRigidStatic* source);
+			static void addGroup(physx::PxScene* scene, std::vector<physx::PxRigidActor*>& actors, size_t pruning_minimum);
+			static void move(physx::PxRigidDynamic* actor, Body& body, int tile);
+			static void releaseGhost(physx::PxRigidDynamic* ghost);
+
+		public:
+			// Reads PhysicsShardGrid, PhysicsShardTileSize, PhysicsShardGhostMargin and PhysicsShardThreads from aftr.conf.
+			// After ManagerSimulationEvents::init and once the level's statics are in ManagerPhysics::scene, the other
+			// scenes copy whatever is there then
+			static void init();
+			static void shutdown();
+
+			// Every scene, by tile. Empty before init. Queries only find the statics and spawned bodies in each once
+			static const std::vector<physx::PxScene*>& getScenes();
+			// Scene a body at this position goes into when added, ManagerPhysics::scene before init
+			static physx::PxScene* getSceneAt(const physx::PxVec3& position);
+
+			// Main thread, with the scenes idle. Steps every scene at once and waits for all of them
+			static void simulate(float step_s);
+			// Main thread, after simulate. Moves bodies that crossed into another tile and keeps their ghosts up
+			static void migrate();
+			// Bodies that moved in any scene during the last step
+			static physx::PxActor** getActiveActors(physx::PxU32& count);
+
+			// Main thread, with the scenes idle. Adds each actor to the scene of its tile, a pruning structure per tile
+			// once at least pruning_minimum of them go there. 0 never builds one
+			static void addActors(const std::vector<physx::PxRigidActor*>& actors, size_t pruning_minimum);
+			// Main thread, with the scenes idle. Moves a body added by addActors into the home tile for good
+			static void pinHome(physx::PxRigidActor* actor);
+			// Main thread, with the scenes idle. Takes a body added by addActors out of its scene, before it is released
+			static void removeBody(physx::PxRigidActor* actor);
+			// Main thread, with the scenes idle. A static's geometry changed, so its copies get it too
+			static void refreshStatic(physx::PxRigidActor* source);
+
+			// Main thread, with the scenes idle. Overlap across every scene, up to capacity touches
+			static physx::PxU32 overlap(const physx::PxGeometry& geometry, const physx::PxTransform& pose, physx::PxOverlapHit* hits, physx::PxU32 capacity,
+				physx::PxQueryFlags flags = physx::PxQueryFlag::eSTATIC | physx::PxQueryFlag::eDYNAMIC);
+			// Main thread, with the scenes idle. Whether anything at all overlaps the geometry
+			static bool anyOverlap(const physx::PxGeometry& geometry, const physx::PxTransform& pose);
+	};
+}
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <sstream>
+#include "ManagerSimulationEvents.h"
+#include "ManagerPhysics.h"
+#include "ManagerShards.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "WORigidActor.h"
+
+using namespace Aftr;
+using namespace physx;
+
+namespace Aftr {
+	class SimulationEventCallback : public PxSimulationEventCallback {
+		public:
+			void onContact(const PxContactPairHeader& header, const PxContactPair* pairs, PxU32 count) override;
+			void onTrigger(PxTriggerPair* pairs, PxU32 count) override;
+			void onWake(PxActor** actors, PxU32 count) override;
+			void onSleep(PxActor** actors, PxU32 count) override;
+			void onConstraintBreak(PxConstraintInfo*, PxU32) override {}
+			void onAdvance(const PxRigidBody* const*, const PxTransform*, const PxU32) override {}
+	};
+}
+
+// These line are required to use as a singleton
+std::unique_ptr<SimulationEventCallback> ManagerSimulationEvents::callback;
+std::unique_ptr<SimulationEventRing> ManagerSimulationEvents::ring;
+uint32_t ManagerSimulationEvents::types = 0;
+float ManagerSimulationEvents::min_impulse = 0;
+float ManagerSimulationEvents::force_threshold = 0;
+std::atomic<uint64_t> ManagerSimulationEvents::filtered(0);
+
+namespace {
+	// Most contact points looked at per pair, the rest only add to the impulse a little
+	const PxU32 MAX_PAIR_POINTS = 16;
+
+	// Spawned objects keep their binding in userData, static geometry keeps its WO there instead
+	int idOf(const PxActor* actor) {
+		if (actor == nullptr || !actor->is<PxRigidDynamic>() || actor->userData == nullptr) return -1;
+		return static_cast<WORigidActor*>(actor->userData)->id;
+	}
+
+	uint64_t currentStep() {
+		return ManagerPhysics::getStepCount() + 1; // The step being fetched isn't counted yet
+	}
+}
+
+void SimulationEventCallback::onContact(const PxContactPairHeader& header, const PxContactPair* pairs, PxU32 count) {
+	if (header.flags & (PxContactPairHeaderFlag::eREMOVED_ACTOR_0 | PxContactPairHeaderFlag::eREMOVED_ACTOR_1)) return;
+	PxContactPairPoint points[MAX_PAIR_POINTS];
+	for (PxU32 i = 0; i < count; i++) {
+		SimulationEvent event;
+		event.type = SimulationEventType::Contact;
+		event.id0 = idOf(header.actors[0]);
+		event.id1 = idOf(header.actors[1]);
+		event.step = currentStep();
+		PxU32 found = pairs[i].extractContacts(points, MAX_PAIR_POINTS);
+		for (PxU32 j = 0; j < found; j++) {
+			event.position += points[j].position;
+			event.impulse += points[j].impulse.magnitude();
+		}
+		if (found > 0) event.position *= 1.0f / found;
+		ManagerSimulationEvents::publish(event);
+	}
+}
+
+void SimulationEventCallback::onTrigger(PxTriggerPair* pairs, PxU32 count) {
+	for (PxU32 i = 0; i < count; i++) {
+		// A removed shape still leaves the trigger, but its actor can't be looked at anymore
+		bool removed_trigger = pairs[i].flags & PxTriggerPairFlag::eREMOVED_SHAPE_TRIGGER;
+		bool removed_other = pairs[i].flags & PxTriggerPairFlag::eREMOVED_SHAPE_OTHER;
+		SimulationEvent event;
+		event.type = pairs[i].status == PxPairFlag::eNOTIFY_TOUCH_LOST ? SimulationEventType::TriggerExit : SimulationEventType::TriggerEnter;
+		event.id0 = removed_trigger ? -1 : idOf(pairs[i].triggerActor);
+		event.id1 = removed_other ? -1 : idOf(pairs[i].otherActor);
+		event.actor0 = pairs[i].triggerActor;
+		event.actor1 = pairs[i].otherActor;
+		event.step = currentStep();
+		ManagerSimulationEvents::publish(event);
+	}
+}
+
+void SimulationEventCallback::onWake(PxActor** actors, PxU32 count) {
+	for (PxU32 i = 0; i < count; i++) {
+		SimulationEvent event;
+		event.type = SimulationEventType::Wake;
+		event.id0 = idOf(actors[i]);
+		event.step = currentStep();
+		ManagerSimulationEvents::publish(event);
+	}
+}
+
+void SimulationEventCallback::onSleep(PxActor** actors, PxU32 count) {
+	for (PxU32 i = 0; i < count; i++) {
+		SimulationEvent event;
+		event.type = SimulationEventType::Sleep;
+		event.id0 = idOf(actors[i]);
+		event.step = currentStep();
+		ManagerSimulationEvents::publish(event);
+	}
+}
+
+void ManagerSimulationEvents::init() {
+	size_t capacity = 8192;
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("SimEventCapacity");
+	if (!value.empty()) capacity = std::max(1ul, std::stoul(value));
+	value = ManagerEnvironmentConfiguration::getVariableValue("SimEventMinImpulse");
+	if (!value.empty()) min_impulse = std::stof(value);
+	value = ManagerEnvironmentConfiguration::getVariableValue("SimEventForceThreshold");
+	if (!value.empty()) force_threshold = std::stof(value);
+
+	// SimEventTypes is a comma separated list, everything is reported if it isn't given
+	value = ManagerEnvironmentConfiguration::getVariableValue("SimEventTypes");
+	if (value.empty()) value = "contact,trigger,wake,sleep";
+	std::stringstream list(value);
+	std::string entry;
+	types = 0;
+	while (std::getline(list, entry, ',')) {
+		if (entry == "contact") types |= 1u << (uint32_t)SimulationEventType::Contact;
+		else if (entry == "trigger") types |= (1u << (uint32_t)SimulationEventType::TriggerEnter) | (1u << (uint32_t)SimulationEventType::TriggerExit);
+		else if (entry == "wake") types |= 1u << (uint32_t)SimulationEventType::Wake;
+		else if (entry == "sleep") types |= 1u << (uint32_t)SimulationEventType::Sleep;
+	}
+
+	ring = std::make_unique<SimulationEventRing>(capacity);
+	callback = std::make_unique<SimulationEventCallback>();
+	ManagerPhysics::scene->setSimulationEventCallback(callback.get());
+	// Contact reports are asked for pair by pair in the filter shader. With a force threshold PhysX drops the
+	// light touches itself, so the callback never sees them
+	if (reportsContacts()) {
+		PxPairFlags report = PxPairFlag::eNOTIFY_CONTACT_POINTS;
+		report |= force_threshold > 0 ? PxPairFlag::eNOTIFY_THRESHOLD_FORCE_FOUND : PxPairFlag::eNOTIFY_TOUCH_FOUND;
+		ManagerPhysics::setReportFlags(report);
+	}
+}
+
+void ManagerSimulationEvents::shutdown() {
+	if (ring == nullptr) return;
+	std::cout << "Simulation events: " << getWritten() << " written, " << getDropped() << " dropped, " << getFiltered() << " filtered" << std::endl;
+	// The shards were handed the same callback
+	if (ManagerPhysics::scene != nullptr) ManagerPhysics::scene->setSimulationEventCallback(nullptr);
+	for (PxScene* shard : ManagerShards::getScenes())
+		shard->setSimulationEventCallback(nullptr);
+	callback.reset();
+	ring.reset();
+}
+
+bool ManagerSimulationEvents::wants(SimulationEventType type) {
+	return (types & (1u << (uint32_t)type)) != 0;
+}
+
+bool ManagerSimulationEvents::reportsContacts() {
+	return ring != nullptr && wants(SimulationEventType::Contact);
+}
+
+bool ManagerSimulationEvents::reportsTriggers() {
+	return ring != nullptr && wants(SimulationEventType::TriggerEnter);
+}
+
+void ManagerSimulationEvents::watch(PxRigidDynamic* body) {
+	if (ring == nullptr) return;
+	if (wants(SimulationEventType::Wake) || wants(SimulationEventType::Sleep))
+		body->setActorFlag(PxActorFlag::eSEND_SLEEP_NOTIFIES, true);
+	if (reportsContacts() && force_threshold > 0)
+		body->setContactReportThreshold(force_threshold);
+}
+
+void ManagerSimulationEvents::publish(const SimulationEvent& event) {
+	if (!wants(event.type) || (event.type == SimulationEventType::Contact && event.impulse < min_impulse)) {
+		filtered.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring->push(event);
+}
+
+int ManagerSimulationEvents::subscribe() {
+	return ring != nullptr ? ring->subscribe() : -1;
+}
+
+void ManagerSimulationEvents::unsubscribe(int reader) {
+	if (ring != nullptr) ring->unsubscribe(reader);
+}
+
+size_t ManagerSimulationEvents::read(int reader, std::vector<SimulationEvent>& out) {
+	return ring != nullptr ? ring->read(reader, out) : 0;
+}
+
+uint64_t ManagerSimulationEvents::getWritten() {
+	return ring != nullptr ? ring->getWritten() : 0;
+}
+
+uint64_t ManagerSimulationEvents::getDropped() {
+	return ring != nullptr ? ring->getDropped() : 0;
+}
+
+uint64_t ManagerSimulationEvents::getFiltered() {
+	return filtered.load(std::memory_order_relaxed);
+}
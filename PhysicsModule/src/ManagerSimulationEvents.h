@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "SimulationEventRing.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Aftr
+{
+	class SimulationEventCallback;
+
+	// This manager is meant to be a singleton that turns the scene's contact, trigger, wake and sleep reports into
+	// SimulationEvents. The callback only filters and copies into a preallocated ring during fetchResults, so it
+	// stays cheap. Consumers subscribe once and read whenever they like, from whatever thread they run on
+	class ManagerSimulationEvents {
+		protected:
+			friend class SimulationEventCallback;
+			static std::unique_ptr<SimulationEventCallback> callback;
+			static std::unique_ptr<SimulationEventRing> ring;
+			static uint32_t types; // Bit per SimulationEventType that is reported
+			static float min_impulse; // Contacts softer than this are filtered in the callback
+			static float force_threshold; // Contacts are only reported once PhysX sees this much force, 0 reports every touch
+			static std::atomic<uint64_t> filtered;
+
+			static bool wants(SimulationEventType type);
+			// Called from fetchResults
+			static void publish(const SimulationEvent& event);
+
+		public:
+			// Reads SimEventCapacity, SimEventTypes, SimEventMinImpulse and SimEventForceThreshold from aftr.conf and
+			// hooks the callback into the scene. Call before anything is spawned, pairs only pick up report flags when they form
+			static void init();
+			// Prints the counters and unhooks the callback
+			static void shutdown();
+			// A new body reports wakes, sleeps and contacts according to the configuration
+			static void watch(physx::PxRigidDynamic* body);
+			static bool reportsContacts();
+			static bool reportsTriggers();
+
+			// Main thread, with the scene idle. Returns a reader for read, -1 if every reader is taken
+			static int subscribe();
+			static void unsubscribe(int reader);
+			// Any thread, one thread per reader. Appends every event since this reader's last read
+			static size_t read(int reader, std::vector<SimulationEvent>& out);
+
+			static uint64_t getWritten();
+			// Lost because the slowest reader was a whole ring behind
+			static uint64_t getDropped();
+			// Left out by the type and impulse filters
+			static uint64_t getFiltered();
+	};
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <chrono>
+#include "ManagerTerrain.h"
+#include "ManagerPhysics.h"
+#include "ManagerLookahead.h"
+#include "ManagerReplication.h"
+#include "ManagerSceneQueries.h"
+#include "ManagerShards.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+TerrainTiles ManagerTerrain::tiles;
+PxHeightField* ManagerTerrain::heightfield = nullptr;
+PxRigidStatic* ManagerTerrain::actor = nullptr;
+PxShape* ManagerTerrain::shape = nullptr;
+PxMaterial* ManagerTerrain::material = nullptr;
+float ManagerTerrain::height_scale = 1;
+
+bool ManagerTerrain::init(WorldContainer* world) {
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!tiles.loadConfigured(world))
+		return false;
+	// Heights run from -max_height, the deepest a crater goes, to max_height across half the PxI16 range
+	height_scale = tiles.getMaxHeight() / 16384.0f;
+
+	std::vector<PxHeightFieldSample> samples((size_t)tiles.getRows() * tiles.getCols());
+	for (unsigned int row = 0; row < tiles.getRows(); row++) {
+		for (unsigned int col = 0; col < tiles.getCols(); col++)
+			samples[(size_t)row * tiles.getCols() + col] = toSample(tiles.getHeight(row, col));
+	}
+	PxHeightFieldDesc desc;
+	desc.format = PxHeightFieldFormat::eS16_TM;
+	desc.nbRows = tiles.getRows();
+	desc.nbColumns = tiles.getCols();
+	desc.samples.data = samples.data();
+	desc.samples.stride = sizeof(PxHeightFieldSample);
+	PxCooking* cooking = PxCreateCooking(PX_PHYSICS_VERSION, ManagerPhysics::gPhysics->getFoundation(), PxCookingParams(ManagerPhysics::gPhysics->getTolerancesScale()));
+	heightfield = cooking->createHeightField(desc, ManagerPhysics::gPhysics->getPhysicsInsertionCallback());
+	cooking->release();
+	if (heightfield == nullptr) {
+		std::cout << "Unable to create the terrain heightfield" << std::endl;
+		return false;
+	}
+
+	// Heightfields are y up with rows along x and columns along z. Turned to z up, columns run along -y
+	Vector origin = tiles.getOrigin();
+	material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	actor = ManagerPhysics::gPhysics->createRigidStatic(PxTransform(PxVec3(origin.x, origin.y, origin.z), PxQuat(PxHalfPi, PxVec3(1, 0, 0))));
+	shape = PxRigidActorExt::createExclusiveShape(*actor, PxHeightFieldGeometry(heightfield, PxMeshGeometryFlags(), height_scale, tiles.getSpacing(), tiles.getSpacing()), *material);
+	ManagerPhysics::addActorBind(nullptr, actor); // Spread over many tile WOs, so no single one to bind
+	std::cout << "Terrain: " << tiles.getRows() << "x" << tiles.getCols() << " samples loaded in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+	return true;
+}
+
+void ManagerTerrain::shutdown() {
+	if (actor != nullptr) {
+		if (actor->getScene() != nullptr) actor->getScene()->removeActor(*actor);
+		actor->release();
+	}
+	actor = nullptr;
+	shape = nullptr;
+	if (heightfield != nullptr) heightfield->release();
+	heightfield = nullptr;
+	if (material != nullptr) material->release();
+	material = nullptr;
+}
+
+bool ManagerTerrain::isLoaded() {
+	return actor != nullptr;
+}
+
+bool ManagerTerrain::isTerrain(const PxRigidActor* other) {
+	return other != nullptr && other == actor;
+}
+
+PxHeightFieldSample ManagerTerrain::toSample(float height) {
+	PxHeightFieldSample sample;
+	sample.height = (PxI16)PxClamp(height / height_scale, -32767.0f, 32767.0f);
+	sample.materialIndex0 = 0;
+	sample.materialIndex1 = 0;
+	return sample;
+}
+
+void ManagerTerrain::crater(const Vector& center, float radius, float depth) {
+	if (!isLoaded()) return;
+	TerrainRegion region = tiles.crater(center.x, center.y, radius, depth);
+	if (region.rows == 0) return;
+
+	// Only the changed rectangle goes back to PhysX
+	std::vector<PxHeightFieldSample> samples((size_t)region.rows * region.cols);
+	for (unsigned int row = 0; row < region.rows; row++) {
+		for (unsigned int col = 0; col < region.cols; col++)
+			samples[(size_t)row * region.cols + col] = toSample(tiles.getHeight(region.row + row, region.col + col));
+	}
+	PxHeightFieldDesc desc;
+	desc.format = PxHeightFieldFormat::eS16_TM;
+	desc.nbRows = region.rows;
+	desc.nbColumns = region.cols;
+	desc.samples.data = samples.data();
+	desc.samples.stride = sizeof(PxHeightFieldSample);
+	{
+		std::unique_lock<std::mutex> lock = ManagerLookahead::lockGeometry();
+		// Bounds only ever grow, recomputing them would walk every sample
+		heightfield->modifySamples((PxI32)region.col, (PxI32)region.row, desc, false);
+		// PhysX doesn't track which shapes use a heightfield, so the shape is told it changed
+		shape->setGeometry(PxHeightFieldGeometry(heightfield, PxMeshGeometryFlags(), height_scale, tiles.getSpacing(), tiles.getSpacing()));
+		ManagerShards::refreshStatic(actor);
+	}
+
+	// Sleeping bodies don't notice the ground leaving, so wake everything over the crater
+	ManagerSceneQueries::overlap(PxBoxGeometry(radius, radius, radius + depth), PxTransform(PxVec3(center.x, center.y, center.z)),
+		[](const std::vector<SceneQueryHit>& hits) {
+			for (const SceneQueryHit& hit : hits) {
+				PxRigidDynamic* dynamic = hit.actor->is<PxRigidDynamic>();
+				if (dynamic != nullptr && !(dynamic->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+					dynamic->wakeUp();
+			}
+		}, PxQueryFlag::eDYNAMIC);
+	ManagerReplication::digCrater(center, radius, depth);
+}
+
+void ManagerTerrain::update() {
+	tiles.uploadDirty();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "TerrainTiles.h"
+#include "Vector.h"
+
+namespace Aftr
+{
+	class WorldContainer;
+
+	// This manager is meant to be a singleton for the heightfield terrain that stands in for the flat ground.
+	// The same heights back a PxHeightField and a tiled render mesh. Craters rewrite only the samples they
+	// touch through modifySamples and rebuild only the tiles those samples are on
+	class ManagerTerrain {
+		protected:
+			static TerrainTiles tiles;
+			static physx::PxHeightField* heightfield;
+			static physx::PxRigidStatic* actor;
+			static physx::PxShape* shape;
+			static physx::PxMaterial* material;
+			static float height_scale; // World height of one heightfield unit
+
+			static physx::PxHeightFieldSample toSample(float height);
+
+		public:
+			// Loads the terrain aftr.conf names into the world and the scene. Returns false if no terrain is
+			// configured or it couldn't be loaded
+			static bool init(WorldContainer* world);
+			static void shutdown();
+			static bool isLoaded();
+			static bool isTerrain(const physx::PxRigidActor* other);
+
+			// Main thread, with the scene idle. Digs a crater into the heightfield, wakes what rests on it
+			// and sends it to every viewer. The render tiles catch up on the next update
+			static void crater(const Vector& center, float radius, float depth);
+			// Call once per frame, rebuilds the tiles craters touched since the last call
+			static void update();
+	};
+}
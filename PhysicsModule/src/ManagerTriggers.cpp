@@ -0,0 +1,117 @@
+#include <iostream>
+#include <algorithm>
+#include "ManagerTriggers.h"
+#include "ManagerPhysics.h"
+#include "ManagerSimulationEvents.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "WOWayPointSpherical.h"
+
+using namespace Aftr;
+using namespace physx;
+
+// These line are required to use as a singleton
+std::vector<ManagerTriggers::Volume> ManagerTriggers::volumes;
+std::unordered_map<const PxActor*, size_t> ManagerTriggers::by_actor;
+std::vector<size_t> ManagerTriggers::occupied;
+PxRigidDynamic* ManagerTriggers::camera = nullptr;
+PxMaterial* ManagerTriggers::material = nullptr;
+int ManagerTriggers::reader = -1;
+std::vector<SimulationEvent> ManagerTriggers::events;
+
+void ManagerTriggers::addWayPoint(WOWayPointSpherical* waypoint, float radius, unsigned int frequency_ms, bool dynamic_objects) {
+	if (material == nullptr) material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	Vector at = waypoint->getPosition();
+	PxRigidStatic* actor = ManagerPhysics::gPhysics->createRigidStatic(PxTransform(PxVec3(at.x, at.y, at.z)));
+	// Only a trigger, queries and contacts go straight through it
+	PxRigidActorExt::createExclusiveShape(*actor, PxSphereGeometry(radius), *material, PxShapeFlag::eTRIGGER_SHAPE | PxShapeFlag::eVISUALIZATION);
+	ManagerPhysics::addActorBind(waypoint, actor);
+
+	Volume volume;
+	volume.waypoint = waypoint;
+	volume.actor = actor;
+	volume.frequency_ms = frequency_ms;
+	volume.dynamic_objects = dynamic_objects;
+	by_actor[actor] = volumes.size();
+	volumes.push_back(volume);
+}
+
+void ManagerTriggers::init(const Vector& camera_position) {
+	float radius = 0.5f;
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("TriggerCameraRadius");
+	if (!value.empty()) radius = std::max(0.01f, std::stof(value));
+
+	reader = ManagerSimulationEvents::reportsTriggers() ? ManagerSimulationEvents::subscribe() : -1;
+	if (reader < 0 && !volumes.empty())
+		std::cout << "Waypoints need trigger events in SimEventTypes and a free event reader, they won't fire" << std::endl;
+
+	if (material == nullptr) material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	camera = ManagerPhysics::gPhysics->createRigidDynamic(PxTransform(PxVec3(camera_position.x, camera_position.y, camera_position.z)));
+	camera->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
+	PxShape* shape = PxRigidActorExt::createExclusiveShape(*camera, PxSphereGeometry(radius), *material);
+	shape->setFlag(PxShapeFlag::eSCENE_QUERY_SHAPE, false); // Picks and blasts start inside it
+	shape->setSimulationFilterData(PxFilterData(0, ManagerPhysics::SENSOR_FILTER, 0, 0)); // Flies through objects like the camera does
+	ManagerPhysics::scene->addActor(*camera); // No userData, it has no aftr side
+}
+
+void ManagerTriggers::shutdown() {
+	ManagerSimulationEvents::unsubscribe(reader);
+	reader = -1;
+	for (Volume& volume : volumes) {
+		if (volume.actor->getScene() != nullptr) volume.actor->getScene()->removeActor(*volume.actor);
+		volume.actor->release();
+	}
+	volumes.clear();
+	by_actor.clear();
+	occupied.clear();
+	if (camera != nullptr) {
+		if (camera->getScene() != nullptr) camera->getScene()->removeActor(*camera);
+		camera->release();
+	}
+	camera = nullptr;
+	if (material != nullptr) material->release();
+	material = nullptr;
+}
+
+void ManagerTriggers::moveCamera(const Vector& position) {
+	if (camera != nullptr) camera->setKinematicTarget(PxTransform(PxVec3(position.x, position.y, position.z)));
+}
+
+void ManagerTriggers::update() {
+	if (reader < 0) return;
+	events.clear();
+	ManagerSimulationEvents::read(reader, events);
+	for (const SimulationEvent& event : events) {
+		if (event.type != SimulationEventType::TriggerEnter && event.type != SimulationEventType::TriggerExit) continue;
+		auto found = by_actor.find(event.actor0);
+		if (found == by_actor.end()) continue; // Some other trigger
+		if (event.type == SimulationEventType::TriggerEnter)
+			enter(volumes[found->second], found->second, event);
+		else
+			exit(volumes[found->second], found->second, event);
+	}
+
+	// Like the engine's own check, fires on the way in and then every frequency_ms while something stays
+	auto now = std::chrono::steady_clock::now();
+	for (size_t index : occupied) {
+		Volume& volume = volumes[index];
+		if (volume.triggered && now - volume.last_trigger < std::chrono::milliseconds(volume.frequency_ms)) continue;
+		volume.triggered = true;
+		volume.last_trigger = now;
+		volume.waypoint->onTrigger();
+	}
+}
+
+void ManagerTriggers::enter(Volume& volume, size_t index, const SimulationEvent& event) {
+	if (event.actor1 != camera && !(volume.dynamic_objects && event.id1 >= 0)) return;
+	if (volume.inside.empty()) occupied.push_back(index);
+	volume.inside.push_back(event.actor1);
+}
+
+void ManagerTriggers::exit(Volume& volume, size_t index, const SimulationEvent& event) {
+	// Removed objects have no id anymore, but their actor pointer still matches the one that went in
+	auto found = std::find(volume.inside.begin(), volume.inside.end(), event.actor1);
+	if (found == volume.inside.end()) return;
+	volume.inside.erase(found);
+	if (volume.inside.empty())
+		occupied.erase(std::find(occupied.begin(), occupied.end(), index));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "SimulationEventRing.h"
+#include "Vector.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+namespace Aftr
+{
+	class WOWayPointSpherical;
+
+	// This manager is meant to be a singleton that backs waypoints with PhysX trigger spheres. The camera is a
+	// kinematic sensor sphere that follows it every frame, so the broadphase finds what is inside which waypoint
+	// and the cost no longer grows with the number of waypoints. Enter and exit come through ManagerSimulationEvents
+	class ManagerTriggers {
+		protected:
+			struct Volume {
+				WOWayPointSpherical* waypoint = nullptr;
+				physx::PxRigidStatic* actor = nullptr;
+				unsigned int frequency_ms = 0; // Least time between two onTriggers while something stays inside
+				bool dynamic_objects = false; // Spawned objects set it off too, not only the camera
+				std::vector<const physx::PxActor*> inside;
+				std::chrono::steady_clock::time_point last_trigger;
+				bool triggered = false; // Ever, last_trigger means nothing before
+			};
+
+			static std::vector<Volume> volumes;
+			static std::unordered_map<const physx::PxActor*, size_t> by_actor;
+			static std::vector<size_t> occupied; // Volumes with anything inside
+			static physx::PxRigidDynamic* camera;
+			static physx::PxMaterial* material;
+			static int reader;
+			static std::vector<SimulationEvent> events;
+
+			static void enter(Volume& volume, size_t index, const SimulationEvent& event);
+			static void exit(Volume& volume, size_t index, const SimulationEvent& event);
+
+		public:
+			// Any time after ManagerPhysics::init, usually from loadMap. The waypoint stays where it is now, and
+			// should be made without useCamera so the engine doesn't check it every frame as well
+			static void addWayPoint(WOWayPointSpherical* waypoint, float radius, unsigned int frequency_ms, bool dynamic_objects = false);
+			// After ManagerSimulationEvents::init. Reads TriggerCameraRadius from aftr.conf and makes the camera sensor
+			static void init(const Vector& camera_position);
+			static void shutdown();
+
+			// Once per frame before the physics steps, the sensor reaches the camera over the first one
+			static void moveCamera(const Vector& position);
+			// Once per frame after the physics steps, fires onTrigger for the waypoints that are due
+			static void update();
+	};
+}
@@ -0,0 +1,318 @@
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include "ManagerVehicles.h"
+#include "ManagerPhysics.h"
+#include "ManagerShards.h"
+#include "ManagerEnvironmentConfiguration.h"
+#include "vehicle/PxVehicleUtilSetup.h"
+
+using namespace Aftr;
+using namespace physx;
+
+namespace Aftr {
+	// One slice of the vehicles, run on a dispatcher thread
+	class VehicleUpdateTask : public PxBaseTask {
+		public:
+			size_t first = 0;
+			size_t count = 0;
+			float step_s = 0;
+
+			void run() override { ManagerVehicles::updateRange(first, count, step_s); }
+			const char* getName() const override { return "VehicleUpdateTask"; }
+			void addReference() override {}
+			void removeReference() override {}
+			int32_t getReference() const override { return 1; }
+			// The dispatcher calls this once run returns
+			void release() override {
+				std::lock_guard<std::mutex> lock(ManagerVehicles::tasks_mutex);
+				if (--ManagerVehicles::tasks_running == 0)
+					ManagerVehicles::tasks_done.notify_one();
+			}
+	};
+}
+
+// These line are required to use as a singleton
+std::vector<ManagerVehicles::Vehicle> ManagerVehicles::vehicles;
+std::vector<PxVehicleWheels*> ManagerVehicles::wheels;
+bool ManagerVehicles::started = false;
+PxVehicleDrivableSurfaceToTireFrictionPairs* ManagerVehicles::friction = nullptr;
+PxBatchQuery* ManagerVehicles::batch = nullptr;
+PxU32 ManagerVehicles::raycast_capacity = 0;
+std::vector<PxRaycastQueryResult> ManagerVehicles::raycast_results;
+std::vector<PxRaycastHit> ManagerVehicles::raycast_hits;
+std::vector<PxWheelQueryResult> ManagerVehicles::wheel_results;
+std::vector<PxVehicleWheelQueryResult> ManagerVehicles::vehicle_results;
+std::vector<PxVehicleWheelConcurrentUpdateData> ManagerVehicles::wheel_updates;
+std::vector<PxVehicleConcurrentUpdateData> ManagerVehicles::vehicle_updates;
+PxDefaultCpuDispatcher* ManagerVehicles::dispatcher = nullptr;
+std::vector<VehicleUpdateTask> ManagerVehicles::tasks;
+int ManagerVehicles::tasks_running = 0;
+std::mutex ManagerVehicles::tasks_mutex;
+std::condition_variable ManagerVehicles::tasks_done;
+float ManagerVehicles::throttle = 0;
+float ManagerVehicles::steer = 0;
+size_t ManagerVehicles::min_per_task = 4;
+
+namespace {
+	// Four road wheels a side, even ones on the left as the tank drive expects
+	const PxU32 WHEELS = 8;
+	const PxVec3 CHASSIS_HALF_EXTENTS(2.0f, 1.25f, 0.5f);
+	const float CHASSIS_DENSITY = 150; // About 1500 kg
+	const float WHEEL_RADIUS = 0.5f;
+	const float WHEEL_WIDTH = 0.4f;
+	const float WHEEL_MASS = 20;
+	// In the chassis shape's query filter data. Suspension rays go through vehicles, their own and the others
+	const PxU32 UNDRIVABLE = 1;
+}
+
+void ManagerVehicles::init() {
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("VehicleTaskMinimum");
+	if (!value.empty()) min_per_task = std::max(1ul, std::stoul(value));
+	// The main thread always takes a share too
+	unsigned int threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	value = ManagerEnvironmentConfiguration::getVariableValue("VehicleThreads");
+	if (!value.empty()) threads = (unsigned int)std::stoul(value);
+	if (threads > 0) dispatcher = PxDefaultCpuDispatcherCreate(threads);
+	started = PxInitVehicleSDK(*ManagerPhysics::gPhysics);
+	PxVehicleSetBasisVectors(PxVec3(0, 0, 1), PxVec3(1, 0, 0));
+	PxVehicleSetUpdateMode(PxVehicleUpdateMode::eVELOCITY_CHANGE);
+}
+
+void ManagerVehicles::setupSurfaces() {
+	// One tire and one surface type, shared by the materials of the level, terrain or plane the tanks drive on
+	PxScene* scene = ManagerPhysics::scene;
+	std::vector<PxActor*> statics(scene->getNbActors(PxActorTypeFlag::eRIGID_STATIC));
+	scene->getActors(PxActorTypeFlag::eRIGID_STATIC, statics.data(), (PxU32)statics.size());
+	std::vector<const PxMaterial*> surfaces;
+	std::vector<PxShape*> shapes;
+	std::vector<PxMaterial*> materials;
+	for (PxActor* actor : statics) {
+		PxRigidStatic* ground = actor->is<PxRigidStatic>();
+		shapes.resize(ground->getNbShapes());
+		ground->getShapes(shapes.data(), (PxU32)shapes.size());
+		for (PxShape* shape : shapes) {
+			if (!(shape->getFlags() & PxShapeFlag::eSIMULATION_SHAPE)) continue; // Waypoints aren't driven on
+			materials.resize(shape->getNbMaterials());
+			shape->getMaterials(materials.data(), (PxU32)materials.size());
+			for (PxMaterial* material : materials) {
+				if (std::find(surfaces.begin(), surfaces.end(), material) == surfaces.end() && surfaces.size() < PxVehicleDrivableSurfaceToTireFrictionPairs::eMAX_NB_SURFACE_TYPES)
+					surfaces.push_back(material);
+			}
+		}
+	}
+	if (surfaces.empty()) return;
+	std::vector<PxVehicleDrivableSurfaceType> surface_types(surfaces.size());
+	for (PxVehicleDrivableSurfaceType& type : surface_types)
+		type.mType = 0;
+	friction = PxVehicleDrivableSurfaceToTireFrictionPairs::allocate(1, (PxU32)surfaces.size());
+	friction->setup(1, (PxU32)surfaces.size(), surfaces.data(), surface_types.data());
+}
+
+void ManagerVehicles::shutdown() {
+	for (Vehicle& vehicle : vehicles)
+		vehicle.tank->free();
+	vehicles.clear();
+	wheels.clear();
+	if (batch != nullptr) batch->release();
+	batch = nullptr;
+	raycast_capacity = 0;
+	if (friction != nullptr) friction->release();
+	friction = nullptr;
+	if (started) PxCloseVehicleSDK();
+	started = false;
+	if (dispatcher != nullptr) dispatcher->release();
+	dispatcher = nullptr;
+}
+
+SceneSpawn ManagerVehicles::describe(const Vector& location) {
+	SceneSpawn spawn;
+	spawn.model_path = ManagerEnvironmentConfiguration::getSMM() + "/models/rcx_treads.wrl";
+	spawn.half_extents = Vector(CHASSIS_HALF_EXTENTS.x, CHASSIS_HALF_EXTENTS.y, CHASSIS_HALF_EXTENTS.z);
+	spawn.density = CHASSIS_DENSITY;
+	spawn.location = location;
+	spawn.on_spawned = [](int id) { attach(id); };
+	return spawn;
+}
+
+void ManagerVehicles::attach(int id) {
+	WORigidActor* binding = ManagerSceneCommands::getBinding(id);
+	PxRigidDynamic* body = binding != nullptr ? binding->actor->is<PxRigidDynamic>() : nullptr;
+	if (body == nullptr || !started) return;
+	// The level is in the scene by the first drop
+	if (friction == nullptr) setupSurfaces();
+	if (friction == nullptr) return;
+	// The suspension batch query only sees the home scene, so that's where the tank has to stay
+	ManagerShards::pinHome(body);
+	PxShape* chassis = nullptr;
+	body->getShapes(&chassis, 1);
+	chassis->setQueryFilterData(PxFilterData(0, 0, 0, UNDRIVABLE));
+	// Low, so it doesn't roll over in turns
+	body->setCMassLocalPose(PxTransform(PxVec3(0, 0, -CHASSIS_HALF_EXTENTS.z / 2)));
+	PxVec3 center_of_mass = body->getCMassLocalPose().p;
+	float mass = body->getMass();
+
+	// Wheel centres along the bottom edges of the chassis, as offsets from the center of mass
+	PxVec3 offsets[WHEELS];
+	float length = 2 * (CHASSIS_HALF_EXTENTS.x - WHEEL_RADIUS);
+	for (PxU32 i = 0; i < WHEELS; i++) {
+		float side = i % 2 == 0 ? 1.0f : -1.0f;
+		float x = CHASSIS_HALF_EXTENTS.x - WHEEL_RADIUS - length * (i / 2) / (WHEELS / 2 - 1);
+		offsets[i] = PxVec3(x, side * (CHASSIS_HALF_EXTENTS.y - WHEEL_WIDTH / 2), -CHASSIS_HALF_EXTENTS.z) - center_of_mass;
+	}
+	PxF32 sprung_masses[WHEELS];
+	PxVehicleComputeSprungMasses(WHEELS, offsets, PxVec3(0, 0, 0), mass, 2, sprung_masses);
+
+	PxVehicleWheelsSimData* wheels_data = PxVehicleWheelsSimData::allocate(WHEELS);
+	for (PxU32 i = 0; i < WHEELS; i++) {
+		PxVehicleWheelData wheel;
+		wheel.mRadius = WHEEL_RADIUS;
+		wheel.mWidth = WHEEL_WIDTH;
+		wheel.mMass = WHEEL_MASS;
+		wheel.mMOI = 0.5f * WHEEL_MASS * WHEEL_RADIUS * WHEEL_RADIUS;
+		wheel.mMaxBrakeTorque = 4000;
+		PxVehicleTireData tire;
+		tire.mType = 0;
+		PxVehicleSuspensionData suspension;
+		suspension.mSpringStrength = 35000;
+		suspension.mSpringDamperRate = 4500;
+		suspension.mMaxCompression = 0.3f;
+		suspension.mMaxDroop = 0.1f;
+		suspension.mSprungMass = sprung_masses[i];
+		wheels_data->setWheelData(i, wheel);
+		wheels_data->setTireData(i, tire);
+		wheels_data->setSuspensionData(i, suspension);
+		wheels_data->setSuspTravelDirection(i, PxVec3(0, 0, -1));
+		wheels_data->setWheelCentreOffset(i, offsets[i]);
+		wheels_data->setSuspForceAppPointOffset(i, PxVec3(offsets[i].x, offsets[i].y, -0.3f));
+		wheels_data->setTireForceAppPointOffset(i, PxVec3(offsets[i].x, offsets[i].y, -0.3f));
+		wheels_data->setSceneQueryFilterData(i, PxFilterData());
+		wheels_data->setWheelShapeMapping(i, -1); // Tracks have no wheel shapes, the rays do the work
+	}
+	wheels_data->setChassisMass(mass);
+
+	PxVehicleDriveSimData drive;
+	PxVehicleEngineData engine;
+	engine.mPeakTorque = 1000;
+	drive.setEngineData(engine);
+	PxVehicleGearsData gears;
+	gears.mSwitchTime = 0.5f;
+	drive.setGearsData(gears);
+	PxVehicleClutchData clutch;
+	clutch.mStrength = 10;
+	drive.setClutchData(clutch);
+
+	PxVehicleDriveTank* tank = PxVehicleDriveTank::allocate(WHEELS);
+	tank->setup(ManagerPhysics::gPhysics, body, *wheels_data, drive, WHEELS);
+	wheels_data->free();
+	tank->setDriveModel(PxVehicleDriveTankControlModel::eSPECIAL); // Tracks turn in opposite directions to spin in place
+	tank->setToRestState();
+	tank->mDriveDynData.forceGearChange(PxVehicleGearsData::eFIRST);
+	tank->mDriveDynData.setUseAutoGears(true);
+
+	Vehicle vehicle;
+	vehicle.id = id;
+	vehicle.tank = tank;
+	vehicles.push_back(vehicle);
+	wheels.push_back(tank);
+	reserve();
+}
+
+void ManagerVehicles::detach(PxRigidActor* actor) {
+	for (size_t i = 0; i < vehicles.size(); i++) {
+		if (vehicles[i].tank->getRigidDynamicActor() != actor) continue;
+		vehicles[i].tank->free();
+		vehicles.erase(vehicles.begin() + i);
+		wheels.erase(wheels.begin() + i);
+		reserve();
+		return;
+	}
+}
+
+void ManagerVehicles::reserve() {
+	PxU32 needed = (PxU32)vehicles.size() * WHEELS;
+	if (batch == nullptr || needed > raycast_capacity) {
+		// Doubled so a stream of spawns doesn't rebuild the batch every time
+		raycast_capacity = std::max(needed, 2 * raycast_capacity);
+		raycast_results.resize(raycast_capacity);
+		raycast_hits.resize(raycast_capacity);
+		if (batch != nullptr) batch->release();
+		PxBatchQueryDesc desc(raycast_capacity, 0, 0);
+		desc.queryMemory.userRaycastResultBuffer = raycast_results.data();
+		desc.queryMemory.userRaycastTouchBuffer = raycast_hits.data();
+		desc.queryMemory.raycastTouchBufferSize = raycast_capacity;
+		desc.preFilterShader = suspensionFilter;
+		batch = ManagerPhysics::scene->createBatchQuery(desc);
+	}
+
+	// Every vehicle's slice of the per wheel buffers, which move when they grow
+	wheel_results.resize(needed);
+	wheel_updates.resize(needed);
+	vehicle_results.resize(vehicles.size());
+	vehicle_updates.resize(vehicles.size());
+	for (size_t i = 0; i < vehicles.size(); i++) {
+		vehicle_results[i].wheelQueryResults = &wheel_results[i * WHEELS];
+		vehicle_results[i].nbWheelQueryResults = WHEELS;
+		vehicle_updates[i].concurrentWheelUpdates = &wheel_updates[i * WHEELS];
+		vehicle_updates[i].nbConcurrentWheelUpdates = WHEELS;
+	}
+}
+
+PxQueryHitType::Enum ManagerVehicles::suspensionFilter(PxFilterData, PxFilterData object_data, const void*, PxU32, PxHitFlags&) {
+	return (object_data.word3 & UNDRIVABLE) ? PxQueryHitType::eNONE : PxQueryHitType::eBLOCK;
+}
+
+void ManagerVehicles::drive(float throttle, float steer) {
+	ManagerVehicles::throttle = PxClamp(throttle, -1.0f, 1.0f);
+	ManagerVehicles::steer = PxClamp(steer, -1.0f, 1.0f);
+}
+
+void ManagerVehicles::update(float step_s) {
+	if (vehicles.empty()) return;
+	// Standing still holds the brakes. Otherwise the engine runs and the tracks split its torque between them
+	bool idle = throttle == 0 && steer == 0;
+	for (Vehicle& vehicle : vehicles) {
+		PxVehicleDriveDynData& input = vehicle.tank->mDriveDynData;
+		input.setAnalogInput(PxVehicleDriveTankControl::eANALOG_INPUT_ACCEL, idle ? 0.0f : 1.0f);
+		input.setAnalogInput(PxVehicleDriveTankControl::eANALOG_INPUT_THRUST_LEFT, PxClamp(throttle - steer, -1.0f, 1.0f));
+		input.setAnalogInput(PxVehicleDriveTankControl::eANALOG_INPUT_THRUST_RIGHT, PxClamp(throttle + steer, -1.0f, 1.0f));
+		input.setAnalogInput(PxVehicleDriveTankControl::eANALOG_INPUT_BRAKE_LEFT, idle ? 1.0f : 0.0f);
+		input.setAnalogInput(PxVehicleDriveTankControl::eANALOG_INPUT_BRAKE_RIGHT, idle ? 1.0f : 0.0f);
+	}
+
+	// Every wheel of every vehicle in one batch
+	PxVehicleSuspensionRaycasts(batch, (PxU32)wheels.size(), wheels.data(), (PxU32)raycast_results.size(), raycast_results.data());
+
+	size_t count = vehicles.size();
+	size_t pieces = dispatcher != nullptr ? std::min((size_t)dispatcher->getWorkerCount() + 1, count / min_per_task) : 1;
+	if (pieces <= 1) {
+		// Few enough to update in place
+		PxVehicleUpdates(step_s, ManagerPhysics::scene->getGravity(), *friction, (PxU32)count, wheels.data(), vehicle_results.data());
+		return;
+	}
+	// The main thread takes the first slice, the dispatcher the rest. Body changes are held back until all are done
+	size_t per_piece = (count + pieces - 1) / pieces;
+	pieces = (count + per_piece - 1) / per_piece;
+	tasks.resize(pieces - 1);
+	tasks_running = (int)tasks.size(); // Nothing is submitted yet, so nothing else touches it
+	for (size_t i = 0; i < tasks.size(); i++) {
+		tasks[i].first = (i + 1) * per_piece;
+		tasks[i].count = std::min(per_piece, count - tasks[i].first);
+		tasks[i].step_s = step_s;
+		dispatcher->submitTask(tasks[i]);
+	}
+	updateRange(0, per_piece, step_s);
+	{
+		std::unique_lock<std::mutex> lock(tasks_mutex);
+		tasks_done.wait(lock, []() { return tasks_running == 0; });
+	}
+	PxVehiclePostUpdates(vehicle_updates.data(), (PxU32)count, wheels.data());
+}
+
+void ManagerVehicles::updateRange(size_t first, size_t count, float step_s) {
+	PxVehicleUpdates(step_s, ManagerPhysics::scene->getGravity(), *friction, (PxU32)count, &wheels[first], &vehicle_results[first], &vehicle_updates[first]);
+}
+
+size_t ManagerVehicles::getCount() {
+	return vehicles.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "vehicle/PxVehicleSDK.h"
+#include "vehicle/PxVehicleDriveTank.h"
+#include "vehicle/PxVehicleUpdate.h"
+#include "vehicle/PxVehicleTireFriction.h"
+#include "ManagerSceneCommands.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace Aftr
+{
+	class VehicleUpdateTask;
+
+	// This manager is meant to be a singleton for the tracked vehicles. Each one is a spawned object with a
+	// PxVehicleDriveTank on its body, so it replicates like any other. Before every step the suspension raycasts of
+	// every vehicle go out as one batch query, and the vehicle updates are split across a dispatcher of their own
+	class ManagerVehicles {
+		protected:
+			friend class VehicleUpdateTask;
+			struct Vehicle {
+				int id = -1;
+				physx::PxVehicleDriveTank* tank = nullptr;
+			};
+
+			static std::vector<Vehicle> vehicles;
+			static std::vector<physx::PxVehicleWheels*> wheels; // Same order as vehicles, for the batch calls
+			static bool started;
+			static physx::PxVehicleDrivableSurfaceToTireFrictionPairs* friction;
+			static physx::PxBatchQuery* batch;
+			static physx::PxU32 raycast_capacity;
+			static std::vector<physx::PxRaycastQueryResult> raycast_results;
+			static std::vector<physx::PxRaycastHit> raycast_hits;
+			static std::vector<physx::PxWheelQueryResult> wheel_results;
+			static std::vector<physx::PxVehicleWheelQueryResult> vehicle_results;
+			static std::vector<physx::PxVehicleWheelConcurrentUpdateData> wheel_updates;
+			static std::vector<physx::PxVehicleConcurrentUpdateData> vehicle_updates;
+			static physx::PxDefaultCpuDispatcher* dispatcher;
+			static std::vector<VehicleUpdateTask> tasks;
+			static int tasks_running; // Guarded by tasks_mutex
+			static std::mutex tasks_mutex;
+			static std::condition_variable tasks_done;
+			static float throttle;
+			static float steer;
+			static size_t min_per_task; // Fewer vehicles than this are updated on the main thread alone
+
+			// Pairs the tire with every material the statics in the scene use
+			static void setupSurfaces();
+			// Grows the batch query and the per wheel buffers to fit every vehicle
+			static void reserve();
+			// Runs PxVehicleUpdates on vehicles [first, first + count)
+			static void updateRange(size_t first, size_t count, float step_s);
+			static physx::PxQueryHitType::Enum suspensionFilter(physx::PxFilterData query_data, physx::PxFilterData object_data,
+				const void* constant_block, physx::PxU32 constant_block_size, physx::PxHitFlags& flags);
+
+		public:
+			// Reads VehicleTaskMinimum and VehicleThreads from aftr.conf and starts the vehicle SDK, after ManagerPhysics::init
+			static void init();
+			static void shutdown();
+
+			// What '2' would drop, but a tank of the rcx_treads model. Its tracks come to life once it is spawned
+			static SceneSpawn describe(const Vector& location);
+			// Main thread, with the scene idle. Turns a spawned object made from describe into a vehicle
+			static void attach(int id);
+			// Main thread, with the scene idle, before the body is released
+			static void detach(physx::PxRigidActor* actor);
+
+			// Every vehicle gets the same input. Throttle and steer run from -1 to 1, positive is forward and left
+			static void drive(float throttle, float steer);
+			// Main thread, with the scene idle, before every simulateStep
+			static void update(float step_s);
+			static size_t getCount();
+	};
+}
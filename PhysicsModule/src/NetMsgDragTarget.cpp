@@ -0,0 +1,31 @@
+#include <sstream>
+
+#include "NetMsgDragTarget.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgDragTarget);
+
+// Payload is packed from the NetSchema
+bool NetMsgDragTarget::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgDragTarget>::toStream(*this, os);
+}
+
+bool NetMsgDragTarget::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgDragTarget>::fromStream(*this, is);
+}
+
+// Only the authority drags, nothing to do
+void NetMsgDragTarget::onMessageArrived() {
+}
+
+// For debug purposes
+std::string NetMsgDragTarget::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Id: " << object_id << "\n"
+		<< "Target: x = " << target.x << " y = " << target.y << " z = " << target.z << "\n";
+	return ss.str();
+}
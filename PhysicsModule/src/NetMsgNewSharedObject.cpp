@@ -10,18 +10,13 @@ using namespace Aftr;
 
 NetMsgMacroDefinition(NetMsgNewSharedObject);
 
-// Send model path, scale, and location as payload
+// Payload is packed from the NetSchema
 bool NetMsgNewSharedObject::toStream(NetMessengerStreamBuffer& os) const {
-	os << model_path << size_scale.x << size_scale.y << size_scale.z;
-	os << location.x << location.y << location.z;
-	return true;
+	return NetSchemaCodec<NetMsgNewSharedObject>::toStream(*this, os);
 }
 
-// Get model path, scale, and location as payload
 bool NetMsgNewSharedObject::fromStream(NetMessengerStreamBuffer& is) {
-	is >> model_path >> size_scale.x >> size_scale.y >> size_scale.z;
-	is >> location.x >> location.y >> location.z;
-	return true;
+	return NetSchemaCodec<NetMsgNewSharedObject>::fromStream(*this, is);
 }
 
 // Add new object at the position
@@ -37,6 +32,7 @@ std::string NetMsgNewSharedObject::toString() const {
 
 	ss << NetMsg::toString();
 	ss << "  Payload: \n"
+		<< "Id: " << object_id << "\n"
 		<< "Model: " << model_path << "\n"
 		<< "Size: x = " << size_scale.x << " y = " << size_scale.y << " z = " << size_scale.z << "\n"
 		<< "Position: x = " << location.x << " y = " << location.y << " z = " << location.z << "\n";
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "NetMsg.h"
+#include "NetMsgSchema.h"
 #include "Vector.h"
 
 #ifdef AFTR_CONFIG_USE_BOOST
@@ -17,11 +18,24 @@ namespace Aftr {
 			virtual void onMessageArrived();
 			virtual std::string toString() const;
 
+			int object_id = -1; // Id used by later pose updates
 			std::string model_path;
 			Vector size_scale;
 			Vector location;
 		protected:
 	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgNewSharedObject> {
+		static constexpr const char* name = "NetMsgNewSharedObject";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgNewSharedObject, object_id),
+				NET_FIELD(NetMsgNewSharedObject, model_path),
+				NET_FIELD(NetMsgNewSharedObject, size_scale),
+				NET_FIELD(NetMsgNewSharedObject, location));
+		}
+	};
 }
 
 #endif
\ No newline at end of file
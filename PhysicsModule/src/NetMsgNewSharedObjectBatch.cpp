@@ -0,0 +1,44 @@
+#include <sstream>
+#include <cstring>
+
+#include "NetMsgNewSharedObjectBatch.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgNewSharedObjectBatch);
+
+// Payload is packed from the NetSchema
+bool NetMsgNewSharedObjectBatch::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgNewSharedObjectBatch>::toStream(*this, os);
+}
+
+bool NetMsgNewSharedObjectBatch::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgNewSharedObjectBatch>::fromStream(*this, is);
+}
+
+// Only the authority spawns, nothing to do
+void NetMsgNewSharedObjectBatch::onMessageArrived() {
+}
+
+void NetMsgNewSharedObjectBatch::encode(const SnapshotRecord* records, size_t count) {
+	payload.resize(count * sizeof(SnapshotRecord));
+	if (count > 0)
+		std::memcpy(&payload[0], records, payload.size());
+}
+
+std::vector<SnapshotRecord> NetMsgNewSharedObjectBatch::decode() const {
+	std::vector<SnapshotRecord> records(payload.size() / sizeof(SnapshotRecord));
+	if (!records.empty())
+		std::memcpy(records.data(), payload.data(), records.size() * sizeof(SnapshotRecord));
+	return records;
+}
+
+// For debug purposes
+std::string NetMsgNewSharedObjectBatch::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Models: " << models.size() << " Objects: " << payload.size() / sizeof(SnapshotRecord) << " (" << payload.size() << " bytes)\n";
+	return ss.str();
+}
@@ -11,26 +11,13 @@ using namespace Aftr;
 
 NetMsgMacroDefinition(NetMsgObjectOrientation);
 
-// Send location, orientation, and the index as payload
+// Payload is packed from the NetSchema
 bool NetMsgObjectOrientation::toStream(NetMessengerStreamBuffer& os) const {
-	os << orientation[0] << orientation[1] << orientation[2] << orientation[3];
-	os << orientation[4] << orientation[5] << orientation[6] << orientation[7];
-	os << orientation[8] << orientation[9] << orientation[10]<< orientation[11];
-	os << orientation[12] << orientation[13] << orientation[14] << orientation[15];
-	os << location.x << location.y << location.z;
-	os << wo_index;
-	return true;
+	return NetSchemaCodec<NetMsgObjectOrientation>::toStream(*this, os);
 }
 
-// Receive location, orientation, and the index as payload
 bool NetMsgObjectOrientation::fromStream(NetMessengerStreamBuffer& is) {
-	is >> orientation[0] >> orientation[1] >> orientation[2] >> orientation[3];
-	is >> orientation[4] >> orientation[5] >> orientation[6] >> orientation[7];
-	is >> orientation[8] >> orientation[9] >> orientation[10] >> orientation[11];
-	is >> orientation[12] >> orientation[13] >> orientation[14] >> orientation[15];
-	is >> location.x >> location.y >> location.z;
-	is >> wo_index;
-	return true;
+	return NetSchemaCodec<NetMsgObjectOrientation>::fromStream(*this, is);
 }
 
 // Update position and orientation
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "NetMsg.h"
+#include "NetMsgSchema.h"
 #include "Vector.h"
 #include "Mat4.h"
 #include "WO.h"
@@ -23,6 +24,17 @@ namespace Aftr {
 		Mat4 orientation;
 		int wo_index;
 	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgObjectOrientation> {
+		static constexpr const char* name = "NetMsgObjectOrientation";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgObjectOrientation, orientation),
+				NET_FIELD(NetMsgObjectOrientation, location),
+				NET_FIELD(NetMsgObjectOrientation, wo_index));
+		}
+	};
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include <sstream>
+#include <cstring>
+
+#include "NetMsgRagdollPose.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgRagdollPose);
+
+// Payload is packed from the NetSchema
+bool NetMsgRagdollPose::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgRagdollPose>::toStream(*this, os);
+}
+
+bool NetMsgRagdollPose::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgRagdollPose>::fromStream(*this, is);
+}
+
+// The authority owns the poses, nothing to apply here
+void NetMsgRagdollPose::onMessageArrived() {
+}
+
+void NetMsgRagdollPose::encode(const std::vector<PoseRecord>& links) {
+	payload.resize(links.size() * sizeof(PoseRecord));
+	if (!links.empty())
+		std::memcpy(&payload[0], links.data(), payload.size());
+}
+
+size_t NetMsgRagdollPose::getRecordCount() const {
+	return payload.size() / sizeof(PoseRecord);
+}
+
+// For debug purposes
+std::string NetMsgRagdollPose::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Sequence: " << sequence << " Links: " << getRecordCount() << " (" << payload.size() << " bytes)\n";
+	return ss.str();
+}
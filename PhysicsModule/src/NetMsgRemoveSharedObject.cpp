@@ -0,0 +1,30 @@
+#include <sstream>
+
+#include "NetMsgRemoveSharedObject.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgRemoveSharedObject);
+
+// Payload is packed from the NetSchema
+bool NetMsgRemoveSharedObject::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgRemoveSharedObject>::toStream(*this, os);
+}
+
+bool NetMsgRemoveSharedObject::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgRemoveSharedObject>::fromStream(*this, is);
+}
+
+// Only the authority despawns, nothing to do
+void NetMsgRemoveSharedObject::onMessageArrived() {
+}
+
+// For debug purposes
+std::string NetMsgRemoveSharedObject::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Id: " << object_id << "\n";
+	return ss.str();
+}
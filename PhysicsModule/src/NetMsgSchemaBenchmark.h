@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Aftr
+{
+	// Measures toStream/fromStream round trips of the generated serializers against the
+	// old hand-written style of streaming one field at a time. The generated side counts
+	// toward the message telemetry like any other send
+	class NetMsgSchemaBenchmark {
+		public:
+			// Prints round trips per second for both styles
+			static void run(size_t messages);
+	};
+}
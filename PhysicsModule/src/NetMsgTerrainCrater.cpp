@@ -0,0 +1,32 @@
+#include <sstream>
+
+#include "NetMsgTerrainCrater.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgTerrainCrater);
+
+// Payload is packed from the NetSchema
+bool NetMsgTerrainCrater::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgTerrainCrater>::toStream(*this, os);
+}
+
+bool NetMsgTerrainCrater::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgTerrainCrater>::fromStream(*this, is);
+}
+
+// Only the authority digs, nothing to do
+void NetMsgTerrainCrater::onMessageArrived() {
+}
+
+// For debug purposes
+std::string NetMsgTerrainCrater::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Index: " << index << "\n"
+		<< "Center: x = " << center.x << " y = " << center.y << " z = " << center.z << "\n"
+		<< "Radius: " << radius << " Depth: " << depth << "\n";
+	return ss.str();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "Vector.h"
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// A crater the authority dug into the terrain. Craters are numbered in the order they were dug, so a
+	// viewer that has them replayed after a snapshot skips the ones it already has
+	class NetMsgTerrainCrater : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgTerrainCrater);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		unsigned int index = 0;
+		Vector center;
+		float radius = 0;
+		float depth = 0;
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgTerrainCrater> {
+		static constexpr const char* name = "NetMsgTerrainCrater";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgTerrainCrater, index),
+				NET_FIELD(NetMsgTerrainCrater, center),
+				NET_FIELD(NetMsgTerrainCrater, radius),
+				NET_FIELD(NetMsgTerrainCrater, depth));
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,34 @@
+#include <sstream>
+
+#include "NetMsgViewerCamera.h"
+#include "ManagerReplication.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgViewerCamera);
+
+// Payload is packed from the NetSchema
+bool NetMsgViewerCamera::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgViewerCamera>::toStream(*this, os);
+}
+
+bool NetMsgViewerCamera::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgViewerCamera>::fromStream(*this, is);
+}
+
+// Re-center the viewer's priorities on its camera
+void NetMsgViewerCamera::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	ManagerReplication::setViewerFocus(host, port, focus);
+}
+
+// For debug purposes
+std::string NetMsgViewerCamera::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Viewer: " << host << ":" << port << "\n"
+		<< "Focus: x = " << focus.x << " y = " << focus.y << " z = " << focus.z << "\n";
+	return ss.str();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "Vector.h"
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Sent by a joined viewer whenever its camera moves, so the authority can prioritize around it
+	class NetMsgViewerCamera : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgViewerCamera);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		std::string host; // Identifies the viewer, same as in its NetMsgViewerJoin
+		std::string port;
+		Vector focus; // Viewer camera position
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgViewerCamera> {
+		static constexpr const char* name = "NetMsgViewerCamera";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgViewerCamera, host),
+				NET_FIELD(NetMsgViewerCamera, port),
+				NET_FIELD(NetMsgViewerCamera, focus));
+		}
+	};
+}
+
+#endif
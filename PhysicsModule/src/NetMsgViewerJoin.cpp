@@ -0,0 +1,81 @@
+#include <sstream>
+#include <iostream>
+
+#include "NetMsgViewerJoin.h"
+#include "NetMsgViewerReject.h"
+#include "NetMsgMoveSphere.h"
+#include "NetMsgNewSharedObject.h"
+#include "NetMsgObjectOrientation.h"
+#include "NetMsgObjectOrientationBatch.h"
+#include "NetMsgWorldSnapshot.h"
+#include "NetMsgViewerCamera.h"
+#include "NetMsgRemoveSharedObject.h"
+#include "NetMsgNewSharedObjectBatch.h"
+#include "NetMsgDragTarget.h"
+#include "NetMsgTerrainCrater.h"
+#include "NetMsgRagdollPose.h"
+#include "ManagerReplication.h"
+#include "NetMessengerClient.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgViewerJoin);
+
+uint32_t Aftr::netSchemaVersion() {
+	uint32_t h = 2166136261u;
+	h = netHashValue(h, NetSchemaCodec<NetMsgMoveSphere>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgNewSharedObject>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgObjectOrientation>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgObjectOrientationBatch>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgWorldSnapshot>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgViewerJoin>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgViewerCamera>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgRemoveSharedObject>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgNewSharedObjectBatch>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgDragTarget>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgTerrainCrater>::hash());
+	h = netHashValue(h, NetSchemaCodec<NetMsgRagdollPose>::hash());
+	// Records are packed raw inside payloads, so their layouts count too
+	h = netHashValue(h, sizeof(PoseRecord));
+	h = netHashValue(h, sizeof(SnapshotRecord));
+	return h;
+}
+
+// Payload is packed from the NetSchema
+bool NetMsgViewerJoin::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgViewerJoin>::toStream(*this, os);
+}
+
+bool NetMsgViewerJoin::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgViewerJoin>::fromStream(*this, is);
+}
+
+// Start replicating to the viewer, the snapshot doubles as the acknowledgement
+void NetMsgViewerJoin::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	if (schema_version != netSchemaVersion()) {
+		std::cout << "Refusing viewer " << host << ":" << port << ", its message schema " << std::hex << schema_version
+			<< " does not match ours " << netSchemaVersion() << std::dec << std::endl;
+		// Otherwise the viewer keeps asking every second and never learns why
+		NetMessengerClient* client = NetMessengerClient::New(host, port);
+		NetMsgViewerReject reject;
+		reject.schema_version = netSchemaVersion();
+		client->sendNetMsgSynchronousTCP(reject);
+		delete client;
+		return;
+	}
+	ManagerReplication::addViewer(host, port, focus, transport);
+}
+
+// For debug purposes
+std::string NetMsgViewerJoin::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Schema: " << std::hex << schema_version << std::dec << "\n"
+		<< "Viewer: " << host << ":" << port << "\n"
+		<< "Focus: x = " << focus.x << " y = " << focus.y << " z = " << focus.z << "\n"
+		<< "Transport: " << (transport.empty() ? "tcp" : transport) << "\n";
+	return ss.str();
+}
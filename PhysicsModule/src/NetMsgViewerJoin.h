@@ -0,0 +1,44 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "Vector.h"
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Sent by a viewer to the authority to ask to be replicated to
+	class NetMsgViewerJoin : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgViewerJoin);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		uint32_t schema_version = 0; // netSchemaVersion() of the viewer's build
+		std::string host; // Where the viewer's NetMessenger server listens
+		std::string port;
+		Vector focus; // Viewer camera position, used for its interest set
+		std::string transport; // "shm:<segment>" to be sent to through shared memory, empty for TCP
+	};
+
+	// Hash of every replicated message and record layout, both sides must agree to talk
+	uint32_t netSchemaVersion();
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgViewerJoin> {
+		static constexpr const char* name = "NetMsgViewerJoin";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgViewerJoin, schema_version),
+				NET_FIELD(NetMsgViewerJoin, host),
+				NET_FIELD(NetMsgViewerJoin, port),
+				NET_FIELD(NetMsgViewerJoin, focus),
+				NET_FIELD(NetMsgViewerJoin, transport));
+		}
+	};
+}
+
+#endif
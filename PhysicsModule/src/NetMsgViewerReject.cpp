@@ -0,0 +1,30 @@
+#include <sstream>
+
+#include "NetMsgViewerReject.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgViewerReject);
+
+// Payload is packed from the NetSchema
+bool NetMsgViewerReject::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgViewerReject>::toStream(*this, os);
+}
+
+bool NetMsgViewerReject::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgViewerReject>::fromStream(*this, is);
+}
+
+// Only viewers get refused, nothing to do
+void NetMsgViewerReject::onMessageArrived() {
+}
+
+// For debug purposes
+std::string NetMsgViewerReject::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Schema: " << std::hex << schema_version << std::dec << "\n";
+	return ss.str();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Sent by the authority to a viewer whose NetMsgViewerJoin it refused, so the viewer stops asking.
+	// Left out of netSchemaVersion(), it has to arrive when the versions differ
+	class NetMsgViewerReject : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgViewerReject);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		uint32_t schema_version = 0; // netSchemaVersion() of the authority's build
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgViewerReject> {
+		static constexpr const char* name = "NetMsgViewerReject";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgViewerReject, schema_version));
+		}
+	};
+}
+
+#endif
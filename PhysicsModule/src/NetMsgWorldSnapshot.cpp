@@ -0,0 +1,46 @@
+#include <sstream>
+#include <cstring>
+
+#include "NetMsgWorldSnapshot.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgWorldSnapshot);
+
+// Payload is packed from the NetSchema
+bool NetMsgWorldSnapshot::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgWorldSnapshot>::toStream(*this, os);
+}
+
+bool NetMsgWorldSnapshot::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgWorldSnapshot>::fromStream(*this, is);
+}
+
+// The authority is the source of snapshots, nothing to apply here
+void NetMsgWorldSnapshot::onMessageArrived() {
+}
+
+void NetMsgWorldSnapshot::encode(const SnapshotRecord* records, size_t count) {
+	payload.resize(count * sizeof(SnapshotRecord));
+	if (count > 0)
+		std::memcpy(&payload[0], records, payload.size());
+}
+
+std::vector<SnapshotRecord> NetMsgWorldSnapshot::decode() const {
+	std::vector<SnapshotRecord> records(payload.size() / sizeof(SnapshotRecord));
+	if (!records.empty())
+		std::memcpy(records.data(), payload.data(), records.size() * sizeof(SnapshotRecord));
+	return records;
+}
+
+// For debug purposes
+std::string NetMsgWorldSnapshot::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Sequence: " << sequence << " Chunk: " << chunk_index + 1 << " of " << chunk_count << "\n"
+		<< "Models: " << models.size() << " Records: " << payload.size() / sizeof(SnapshotRecord) << "\n"
+		<< "Drop zone: x = " << drop_pos.x << " y = " << drop_pos.y << " z = " << drop_pos.z << "\n";
+	return ss.str();
+}
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include "NetTelemetry.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+
+std::string NetTelemetry::module;
+std::map<std::string, NetTypeCounters> NetTelemetry::types;
+NetHistogram NetTelemetry::send_latency;
+NetHistogram NetTelemetry::apply_time;
+NetHistogram NetTelemetry::step_time;
+size_t NetTelemetry::queue_depth_max = 0;
+size_t NetTelemetry::applied_this_frame = 0;
+size_t NetTelemetry::backlog_max = 0;
+unsigned int NetTelemetry::period_ms = 1000;
+double NetTelemetry::ms_in_period = 0;
+double NetTelemetry::ms_total = 0;
+std::ofstream NetTelemetry::dump;
+std::vector<std::string> NetTelemetry::summary;
+size_t NetTelemetry::periods = 0;
+
+namespace {
+	int64_t nowNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+void NetHistogram::record(double ms) {
+	double us = ms * 1000.0;
+	int bucket = 0;
+	while (bucket < bucket_count - 1 && us >= (double)(1u << bucket))
+		bucket++;
+	buckets[bucket]++;
+	samples++;
+	max_ms = std::max(max_ms, ms);
+}
+
+void NetHistogram::reset() {
+	std::fill(buckets, buckets + bucket_count, 0);
+	samples = 0;
+	max_ms = 0;
+}
+
+size_t NetHistogram::count() const {
+	return samples;
+}
+
+double NetHistogram::percentile(double fraction) const {
+	size_t wanted = (size_t)(fraction * samples);
+	size_t seen = 0;
+	for (int bucket = 0; bucket < bucket_count; bucket++) {
+		seen += buckets[bucket];
+		if (seen > wanted)
+			return std::min(max_ms, (double)(1u << bucket) / 1000.0);
+	}
+	return max_ms;
+}
+
+double NetHistogram::max() const {
+	return max_ms;
+}
+
+void NetTelemetry::init(const std::string& module_name) {
+	module = module_name;
+	std::string period = ManagerEnvironmentConfiguration::getVariableValue("NetTelemetryPeriodMs");
+	if (!period.empty()) period_ms = std::max(1ul, std::stoul(period));
+	std::string file = ManagerEnvironmentConfiguration::getVariableValue("NetTelemetryFile");
+	if (!file.empty()) {
+		dump.open(file, std::ios::out | std::ios::app);
+		if (!dump.is_open())
+			std::cout << "Unable to open telemetry file " << file << std::endl;
+	}
+}
+
+void NetTelemetry::shutdown() {
+	if (dump.is_open()) dump.close();
+	types.clear();
+}
+
+void NetTelemetry::countSent(const char* type, size_t bytes) {
+	NetTypeCounters& counters = types[type];
+	counters.sent_msgs++;
+	counters.sent_bytes += bytes;
+}
+
+void NetTelemetry::countReceived(const char* type, size_t bytes) {
+	NetTypeCounters& counters = types[type];
+	counters.recv_msgs++;
+	counters.recv_bytes += bytes;
+}
+
+void NetTelemetry::recordSendLatency(double ms) {
+	send_latency.record(ms);
+}
+
+void NetTelemetry::recordQueueDepth(size_t depth) {
+	queue_depth_max = std::max(queue_depth_max, depth);
+}
+
+void NetTelemetry::recordApply(double ms) {
+	apply_time.record(ms);
+	applied_this_frame++;
+}
+
+void NetTelemetry::recordStep(double ms) {
+	step_time.record(ms);
+}
+
+void NetTelemetry::update(double frame_ms) {
+	backlog_max = std::max(backlog_max, applied_this_frame);
+	applied_this_frame = 0;
+	ms_in_period += frame_ms;
+	ms_total += frame_ms;
+	if (ms_in_period >= period_ms)
+		endPeriod();
+}
+
+const std::vector<std::string>& NetTelemetry::getSummary() {
+	return summary;
+}
+
+size_t NetTelemetry::getPeriods() {
+	return periods;
+}
+
+void NetTelemetry::endPeriod() {
+	double seconds = ms_in_period / 1000.0;
+	std::stringstream json;
+	json << std::fixed << std::setprecision(3);
+	json << "{\"module\":\"" << module << "\",\"t_ms\":" << ms_total << ",\"period_ms\":" << ms_in_period << ",\"types\":{";
+
+	summary.clear();
+	std::stringstream line;
+	line << std::fixed << std::setprecision(1);
+	bool first = true;
+	for (auto& type : types) {
+		const NetTypeCounters& c = type.second;
+		json << (first ? "" : ",") << "\"" << type.first << "\":{"
+			<< "\"sent_msgs_s\":" << c.sent_msgs / seconds << ",\"sent_bytes_s\":" << c.sent_bytes / seconds << ","
+			<< "\"recv_msgs_s\":" << c.recv_msgs / seconds << ",\"recv_bytes_s\":" << c.recv_bytes / seconds << "}";
+		first = false;
+
+		line.str("");
+		line << type.first << " out " << c.sent_msgs / seconds << " msg/s " << c.sent_bytes / seconds / 1024.0 << " KiB/s"
+			<< " in " << c.recv_msgs / seconds << " msg/s " << c.recv_bytes / seconds / 1024.0 << " KiB/s";
+		summary.push_back(line.str());
+		type.second = NetTypeCounters();
+	}
+	json << "},\"send_ms\":{\"count\":" << send_latency.count() << ",\"p50\":" << send_latency.percentile(0.5)
+		<< ",\"p99\":" << send_latency.percentile(0.99) << ",\"max\":" << send_latency.max() << "}"
+		<< ",\"queue_depth_max\":" << queue_depth_max
+		<< ",\"apply_ms\":{\"count\":" << apply_time.count() << ",\"p50\":" << apply_time.percentile(0.5)
+		<< ",\"p99\":" << apply_time.percentile(0.99) << ",\"max\":" << apply_time.max() << "}"
+		<< ",\"backlog_max\":" << backlog_max
+		<< ",\"step_ms\":{\"count\":" << step_time.count() << ",\"p50\":" << step_time.percentile(0.5)
+		<< ",\"p99\":" << step_time.percentile(0.99) << ",\"max\":" << step_time.max() << "}}";
+
+	line.str("");
+	line << std::setprecision(3) << "send ms p50 " << send_latency.percentile(0.5) << " p99 " << send_latency.percentile(0.99)
+		<< " max " << send_latency.max() << "  queue max " << queue_depth_max;
+	summary.push_back(line.str());
+	line.str("");
+	line << "apply ms p50 " << apply_time.percentile(0.5) << " p99 " << apply_time.percentile(0.99)
+		<< " max " << apply_time.max() << "  msgs/frame max " << backlog_max;
+	summary.push_back(line.str());
+	if (step_time.count() > 0) {
+		line.str("");
+		line << "step ms p50 " << step_time.percentile(0.5) << " p99 " << step_time.percentile(0.99)
+			<< " max " << step_time.max() << "  steps " << step_time.count();
+		summary.push_back(line.str());
+	}
+
+	if (dump.is_open())
+		dump << json.str() << std::endl;
+
+	send_latency.reset();
+	apply_time.reset();
+	step_time.reset();
+	queue_depth_max = 0;
+	backlog_max = 0;
+	ms_in_period = 0;
+	periods++;
+}
+
+NetTelemetryApplyTimer::NetTelemetryApplyTimer() {
+	start_ns = nowNs();
+}
+
+NetTelemetryApplyTimer::~NetTelemetryApplyTimer() {
+	NetTelemetry::recordApply((nowNs() - start_ns) / 1.0e6);
+}
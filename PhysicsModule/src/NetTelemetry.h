@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+	// Power of two buckets of microseconds, cheap enough to record every call
+	class NetHistogram {
+		public:
+			void record(double ms);
+			void reset();
+			size_t count() const;
+			// Upper edge of the bucket holding the given fraction of samples, in milliseconds
+			double percentile(double fraction) const;
+			double max() const;
+		protected:
+			static const int bucket_count = 24;
+			uint32_t buckets[bucket_count] = {};
+			size_t samples = 0;
+			double max_ms = 0;
+	};
+
+	// Transport counters for one message type
+	struct NetTypeCounters {
+		size_t sent_msgs = 0;
+		size_t sent_bytes = 0;
+		size_t recv_msgs = 0;
+		size_t recv_bytes = 0;
+	};
+
+	// This is meant to be a singleton that collects network counters for the module.
+	// Every period it refreshes the overlay text and appends one JSON line to the dump file
+	class NetTelemetry {
+		protected:
+			static std::string module;
+			static std::map<std::string, NetTypeCounters> types;
+			static NetHistogram send_latency;
+			static NetHistogram apply_time;
+			static NetHistogram step_time;
+			static size_t queue_depth_max;
+			static size_t applied_this_frame;
+			static size_t backlog_max; // Most messages applied in a single frame
+			static unsigned int period_ms;
+			static double ms_in_period;
+			static double ms_total;
+			static std::ofstream dump;
+			static std::vector<std::string> summary;
+			static size_t periods;
+
+			static void endPeriod();
+
+		public:
+			// Reads NetTelemetryPeriodMs and NetTelemetryFile from aftr.conf
+			static void init(const std::string& module_name);
+			static void shutdown();
+
+			// Called by the generated serializers
+			static void countSent(const char* type, size_t bytes);
+			static void countReceived(const char* type, size_t bytes);
+			// Time spent inside one blocking send call
+			static void recordSendLatency(double ms);
+			// Messages waiting to be sent at the start of a flush
+			static void recordQueueDepth(size_t depth);
+			// Time a receiver spent applying one message
+			static void recordApply(double ms);
+			// Time one physics step took, only the authority steps
+			static void recordStep(double ms);
+
+			// Call once per frame
+			static void update(double frame_ms);
+			// Latest period, one line per entry, for the on-screen overlay
+			static const std::vector<std::string>& getSummary();
+			// Changes every time the summary is refreshed
+			static size_t getPeriods();
+	};
+
+	// Times a receiver's onMessageArrived for the telemetry
+	class NetTelemetryApplyTimer {
+		public:
+			NetTelemetryApplyTimer();
+			~NetTelemetryApplyTimer();
+		protected:
+			int64_t start_ns;
+	};
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include "NetTransportBenchmark.h"
+#include "NetShmRing.h"
+#include "NetMsgObjectOrientationBatch.h"
+#include "NetMessengerClient.h"
+#include "NetTelemetry.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+
+namespace {
+	int64_t nowNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void printResult(const char* transport, const NetHistogram& latency, size_t frames, size_t bytes, double seconds) {
+		std::cout << "  " << transport << " ms p50 = " << latency.percentile(0.5) << " p99 = " << latency.percentile(0.99)
+			<< " max = " << latency.max() << "  frames/s = " << frames / seconds
+			<< " MiB/s = " << bytes * frames / seconds / (1024.0 * 1024.0) << std::endl;
+	}
+}
+
+void NetTransportBenchmark::run(size_t objects, size_t frames) {
+	std::vector<PoseRecord> records(objects);
+	for (size_t i = 0; i < objects; i++) {
+		records[i].id = (int)i;
+		for (int j = 0; j < 3; j++) records[i].location[j] = (float)(i + j);
+		for (int j = 0; j < 9; j++) records[i].rotation[j] = (j % 4 == 0) ? 1.0f : 0.0f;
+	}
+	NetMsgObjectOrientationBatch batch;
+	batch.encode(records);
+	std::string payload = NetSchemaCodec<NetMsgObjectOrientationBatch>::encode(batch);
+	uint32_t type = NetSchemaCodec<NetMsgObjectOrientationBatch>::hash();
+	std::cout << "Transport benchmark, " << frames << " frames of " << objects << " poses (" << payload.size() << " bytes each)" << std::endl;
+
+	// Both transports are timed the same way, from encoding the batch until the send returns, which is what a
+	// flush waits on. Shared memory also reports when a reader thread has walked every record in place, TCP can't
+	// since our own main loop would be the reader
+	NetShmRing* reader = NetShmRing::create("aftr_transport_benchmark", 4096, (uint32_t)(4 * payload.size() / 4096 + 16));
+	NetShmRing* writer = reader != nullptr ? NetShmRing::open("aftr_transport_benchmark") : nullptr;
+	if (writer != nullptr) {
+		std::vector<int64_t> written_ns(frames);
+		NetHistogram latency;
+		NetHistogram delivered;
+		size_t checksum = 0;
+		std::thread consumer([&]() {
+			uint32_t got_type;
+			const char* data;
+			size_t bytes;
+			for (size_t frame = 0; frame < frames; ) {
+				if (!reader->peek(got_type, data, bytes)) {
+					std::this_thread::yield();
+					continue;
+				}
+				NetByteReader r(data, bytes);
+				unsigned int sequence = 0;
+				uint32_t size = 0;
+				r.readBytes(&sequence, sizeof(sequence));
+				r.readBytes(&size, sizeof(size));
+				const char* at = r.view(size);
+				for (size_t i = 0; at != nullptr && i < size / sizeof(PoseRecord); i++) {
+					PoseRecord pose;
+					std::memcpy(&pose, at + i * sizeof(PoseRecord), sizeof(PoseRecord));
+					checksum += pose.id;
+				}
+				delivered.record((nowNs() - written_ns[sequence]) / 1.0e6);
+				reader->pop();
+				frame++;
+			}
+		});
+		auto start = std::chrono::steady_clock::now();
+		for (size_t frame = 0; frame < frames; frame++) {
+			batch.sequence = (unsigned int)frame;
+			int64_t sent_ns = nowNs();
+			written_ns[frame] = sent_ns;
+			std::string bytes = NetSchemaCodec<NetMsgObjectOrientationBatch>::encode(batch);
+			while (!writer->tryWrite(type, bytes.data(), bytes.size()))
+				std::this_thread::yield();
+			latency.record((nowNs() - sent_ns) / 1.0e6);
+		}
+		consumer.join();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printResult("shared memory", latency, frames, payload.size(), seconds);
+		std::cout << "    delivered to the reader ms p50 = " << delivered.percentile(0.5) << " p99 = " << delivered.percentile(0.99)
+			<< " (checksum " << checksum << ")" << std::endl;
+	}
+	else {
+		std::cout << "  shared memory unavailable on this host" << std::endl;
+	}
+	delete writer;
+	delete reader;
+
+	// Loopback TCP: the blocking send to our own NetMessenger server, which encodes through toStream
+	std::string port = ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort");
+	NetMessengerClient* client = NetMessengerClient::New("127.0.0.1", port);
+	NetHistogram latency;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		batch.sequence = (unsigned int)frame;
+		int64_t sent_ns = nowNs();
+		client->sendNetMsgSynchronousTCP(batch);
+		latency.record((nowNs() - sent_ns) / 1.0e6);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printResult("loopback TCP ", latency, frames, payload.size(), seconds);
+	delete client;
+}
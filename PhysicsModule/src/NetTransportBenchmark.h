@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Aftr
+{
+	// Compares the shared memory ring against loopback TCP for one pose batch per frame
+	class NetTransportBenchmark {
+		public:
+			// Prints latency percentiles and throughput for both transports
+			static void run(size_t objects, size_t frames);
+	};
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstring>
+#include "PoseSnapshotBuffer.h"
+
+using namespace Aftr;
+
+PoseSnapshotRead::PoseSnapshotRead(std::atomic<int>* readers, const PoseSnapshot* snapshot) {
+	this->readers = readers;
+	this->snapshot = snapshot;
+}
+
+PoseSnapshotRead::PoseSnapshotRead(PoseSnapshotRead&& other) {
+	readers = other.readers;
+	snapshot = other.snapshot;
+	other.readers = nullptr;
+	other.snapshot = nullptr;
+}
+
+PoseSnapshotRead::~PoseSnapshotRead() {
+	if (readers != nullptr) readers->fetch_sub(1);
+}
+
+PoseSnapshotBuffer::PoseSnapshotBuffer(size_t buffer_count) : latest(-1), subscribers(0), skipped(0) {
+	buffer_count = std::max<size_t>(buffer_count, 2);
+	buffers.resize(buffer_count);
+	readers.reset(new std::atomic<int>[buffer_count]);
+	for (size_t i = 0; i < buffer_count; i++)
+		readers[i] = 0;
+}
+
+void PoseSnapshotBuffer::update(const PoseSnapshotRecord& record) {
+	if (record.id < 0) return;
+	if ((size_t)record.id >= staging.size()) {
+		size_t old_size = staging.size();
+		staging.resize(record.id + 1);
+		// Not seen yet, so nothing is known but the id
+		for (size_t id = old_size; id < staging.size(); id++) {
+			std::memset(&staging[id], 0, sizeof(PoseSnapshotRecord));
+			staging[id].id = (int)id;
+			staging[id].sleeping = 1;
+		}
+	}
+	awake.push_back(record.id); // Duplicates are dropped at publish
+	staging[record.id] = record;
+}
+
+bool PoseSnapshotBuffer::publish(uint64_t step, double time_s) {
+	// PhysX only reports actors that moved, so anything that moved last step but not this one went to sleep
+	std::sort(awake.begin(), awake.end());
+	awake.erase(std::unique(awake.begin(), awake.end()), awake.end());
+	for (int id : was_awake) {
+		if (std::binary_search(awake.begin(), awake.end(), id)) continue;
+		staging[id].sleeping = 1;
+		std::fill(staging[id].velocity, staging[id].velocity + 3, 0.0f);
+	}
+	was_awake.swap(awake);
+	awake.clear();
+
+	// Nobody to read it, so don't copy the step. Whatever was published before is out of date from here on
+	if (subscribers.load() == 0) {
+		latest.store(-1);
+		return false;
+	}
+
+	// Any buffer that isn't the latest and that no reader holds can be overwritten
+	int current = latest.load();
+	int target = -1;
+	for (int i = 0; i < (int)buffers.size() && target < 0; i++) {
+		if (i != current && readers[i].load() == 0)
+			target = i;
+	}
+	if (target < 0) {
+		skipped.fetch_add(1);
+		return false;
+	}
+	PoseSnapshot& snapshot = buffers[target];
+	snapshot.step = step;
+	snapshot.time_s = time_s;
+	snapshot.records.assign(staging.begin(), staging.end());
+	latest.store(target);
+	return true;
+}
+
+void PoseSnapshotBuffer::subscribe() {
+	subscribers.fetch_add(1);
+}
+
+void PoseSnapshotBuffer::unsubscribe() {
+	subscribers.fetch_sub(1);
+}
+
+uint64_t PoseSnapshotBuffer::getSkipped() const {
+	return skipped.load();
+}
+
+PoseSnapshotRead PoseSnapshotBuffer::acquire() const {
+	while (true) {
+		int index = latest.load();
+		if (index < 0)
+			return PoseSnapshotRead(nullptr, nullptr);
+		readers[index].fetch_add(1);
+		// Still the latest after claiming it, so the writer can't have picked it to overwrite
+		if (latest.load() == index)
+			return PoseSnapshotRead(&readers[index], &buffers[index]);
+		readers[index].fetch_sub(1);
+	}
+}
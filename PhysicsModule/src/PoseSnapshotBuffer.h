@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Aftr
+{
+	// State of one dynamic actor at the end of a physics step
+	struct PoseSnapshotRecord {
+		int id; // Object id, same as the replication id
+		float location[3];
+		float rotation[9]; // Upper 3x3 of the pose, same layout as PoseRecord
+		float velocity[3];
+		uint32_t sleeping; // Nonzero if the actor didn't move this step
+	};
+
+	// Every actor's state after one completed step, indexed by object id
+	struct PoseSnapshot {
+		uint64_t step = 0;
+		double time_s = 0; // Simulated time at the end of the step
+		std::vector<PoseSnapshotRecord> records;
+	};
+
+	class PoseSnapshotBuffer;
+
+	// A snapshot held for reading. The writer won't reuse its buffer until this is destroyed
+	class PoseSnapshotRead {
+		public:
+			PoseSnapshotRead(PoseSnapshotRead&& other);
+			PoseSnapshotRead(const PoseSnapshotRead&) = delete;
+			PoseSnapshotRead& operator=(const PoseSnapshotRead&) = delete;
+			~PoseSnapshotRead();
+
+			// False until the first step has been published
+			explicit operator bool() const { return snapshot != nullptr; }
+			const PoseSnapshot* operator->() const { return snapshot; }
+			const PoseSnapshot& operator*() const { return *snapshot; }
+
+		protected:
+			friend class PoseSnapshotBuffer;
+			PoseSnapshotRead(std::atomic<int>* readers, const PoseSnapshot* snapshot);
+			std::atomic<int>* readers;
+			const PoseSnapshot* snapshot;
+	};
+
+	// The simulation thread publishes each completed step here. Any number of threads can read the latest
+	// complete snapshot at the same time, without locks and without touching the PhysX scene. Steps are only
+	// copied out while some reader is subscribed
+	class PoseSnapshotBuffer {
+		public:
+			// Three buffers let the writer fill one while readers hold the latest and the one before it
+			PoseSnapshotBuffer(size_t buffer_count = 3);
+
+			// Writer only. Record an actor that moved this step
+			void update(const PoseSnapshotRecord& record);
+			// Writer only. Publish everything updated so far as the latest snapshot. Actors that weren't
+			// updated since the last publish are marked asleep. Returns false if nobody is subscribed or if
+			// readers held every spare buffer
+			bool publish(uint64_t step, double time_s);
+
+			// Any thread. A reader subscribes before its first acquire and unsubscribes when done
+			void subscribe();
+			void unsubscribe();
+			// Any thread. The latest complete snapshot, empty until a step is published after subscribing
+			PoseSnapshotRead acquire() const;
+			// Any thread. Publishes dropped so far because readers held every spare buffer
+			uint64_t getSkipped() const;
+
+		protected:
+			std::vector<PoseSnapshot> buffers;
+			std::unique_ptr<std::atomic<int>[]> readers; // Readers holding each buffer
+			std::atomic<int> latest; // Index of the newest complete buffer, -1 before the first publish
+			std::atomic<int> subscribers;
+			std::atomic<uint64_t> skipped;
+			std::vector<PoseSnapshotRecord> staging; // Writer's working copy, indexed by object id
+			std::vector<int> awake; // Ids updated since the last publish
+			std::vector<int> was_awake; // Ids updated before the last publish
+	};
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ReplicationBenchmark.h"
+#include "ManagerReplication.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+
+namespace {
+	const double TICK_MS = 1000.0 / 60.0;
+
+	// Objects on a square grid, each bobbing with its own phase so every pose changes every tick
+	PoseRecord poseAt(size_t index, size_t side, size_t tick) {
+		PoseRecord pose = {};
+		pose.location[0] = (float)(index % side) * 5;
+		pose.location[1] = (float)(index / side) * 5;
+		pose.location[2] = 10 + 2 * std::sin(0.1f * tick + 0.37f * index);
+		pose.rotation[0] = pose.rotation[4] = pose.rotation[8] = 1;
+		return pose;
+	}
+}
+
+void ReplicationBenchmark::run(size_t objects, size_t ticks) {
+	// ReplicationBenchmarkViewers is a comma separated list of host:port pairs, like NetViewers
+	std::vector<std::pair<std::string, std::string>> receivers;
+	std::stringstream list(ManagerEnvironmentConfiguration::getVariableValue("ReplicationBenchmarkViewers"));
+	std::string entry;
+	while (std::getline(list, entry, ',')) {
+		size_t colon = entry.find(':');
+		if (colon == std::string::npos) continue;
+		receivers.push_back(std::make_pair(entry.substr(0, colon), entry.substr(colon + 1)));
+	}
+	std::string cube = ManagerEnvironmentConfiguration::getSMM() + "/models/cube4x4x4redShinyPlastic_pp.wrl";
+	size_t side = (size_t)std::ceil(std::sqrt((double)objects));
+	std::cout << "Replication benchmark, " << objects << " moving objects for " << ticks << " ticks over TCP" << std::endl;
+	if (receivers.empty()) {
+		// Viewers are told apart by host, and every 127.x.x.x address reaches our own server
+		std::string port = ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort");
+		for (size_t i = 0; i < 32; i++)
+			receivers.push_back(std::make_pair("127.0.0." + std::to_string(i + 1), port));
+		std::cout << "  No ReplicationBenchmarkViewers, sending to this module's own server on loopback. Receiving shares"
+			<< " this process, so the numbers only compare viewer counts with each other" << std::endl;
+	}
+
+	// The live registry sits this out untouched, its viewers just miss the benchmark's flushes
+	ReplicationState live = ManagerReplication::takeState();
+	for (size_t viewer_count : { 1, 8, 32 }) {
+		if (viewer_count > receivers.size()) {
+			std::cout << "  " << viewer_count << " viewer(s): skipped, only " << receivers.size() << " listed in ReplicationBenchmarkViewers" << std::endl;
+			continue;
+		}
+		ManagerReplication::shutdown();
+		for (size_t i = 0; i < objects; i++)
+			ManagerReplication::addObject(cube, Vector(1, 1, 1), poseAt(i, side, 0));
+		std::vector<ReplicationViewer*> viewers;
+		for (size_t i = 0; i < viewer_count; i++) {
+			ReplicationViewer* viewer = ManagerReplication::addViewer(receivers[i].first, receivers[i].second, Vector(0, 0, 0));
+			viewer->interest_radius = 0;
+			viewer->bytes_per_tick = 0;
+			viewers.push_back(viewer);
+		}
+
+		// Stream the snapshots first, only the steady state is timed. No time passes for the periodic report,
+		// so it can't reset the counters in the middle of a run
+		bool streaming = true;
+		while (streaming) {
+			ManagerReplication::flush(0);
+			streaming = false;
+			for (ReplicationViewer* viewer : viewers)
+				streaming = streaming || viewer->snapshot != nullptr;
+		}
+		ManagerReplication::flush(0);
+		for (ReplicationViewer* viewer : viewers) {
+			viewer->msgs_sent = 0;
+			viewer->bytes_sent = 0;
+			viewer->send_ms = 0;
+		}
+
+		double flush_ms = 0;
+		for (size_t tick = 1; tick <= ticks; tick++) {
+			for (size_t i = 0; i < objects; i++) {
+				PoseRecord pose = poseAt(i, side, tick);
+				pose.id = (int)i;
+				ManagerReplication::stagePose(pose, 1.0f);
+			}
+			auto start = std::chrono::high_resolution_clock::now();
+			ManagerReplication::flush(0);
+			flush_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		size_t bytes = 0;
+		double send_ms = 0;
+		for (ReplicationViewer* viewer : viewers) {
+			bytes += viewer->bytes_sent;
+			send_ms += viewer->send_ms;
+		}
+		double per_viewer_tick = 1.0 / ((double)viewer_count * ticks);
+		std::cout << "  " << viewer_count << " viewer(s): flush ms/tick = " << flush_ms / ticks
+			<< " (budget " << TICK_MS << ")  ms/viewer/tick = " << flush_ms * per_viewer_tick
+			<< " of which sending = " << send_ms * per_viewer_tick
+			<< "  pose bytes/viewer/tick = " << bytes * per_viewer_tick << std::endl;
+	}
+
+	ManagerReplication::restoreState(live);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Aftr
+{
+	// Replicates the same moving scene to 1, 8 and 32 viewers over TCP, through the real flush. The viewers are the
+	// headless PseudoPhysicsModules in ReplicationBenchmarkViewers, or this module's own server if none are listed
+	class ReplicationBenchmark {
+		public:
+			// Prints flush time and pose bytes per viewer per tick. Runs on an empty registry, whatever was
+			// replicated before is handed back afterwards
+			static void run(size_t objects, size_t ticks);
+	};
+}
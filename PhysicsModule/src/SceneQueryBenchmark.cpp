@@ -0,0 +1,94 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include "SceneQueryBenchmark.h"
+#include "ManagerSceneQueries.h"
+#include "ManagerPhysics.h"
+
+using namespace Aftr;
+using namespace physx;
+
+namespace {
+	void printResult(const char* method, size_t rays, size_t frames, size_t hits, double seconds) {
+		std::cout << "  " << method << " ms/frame = " << seconds * 1000.0 / frames
+			<< " rays/s = " << rays * frames / seconds << " hits/frame = " << hits / frames << std::endl;
+	}
+}
+
+void SceneQueryBenchmark::run(size_t rays, size_t frames) {
+	// A field of static boxes, so most rays hit something other than the ground
+	const int side = 64;
+	PxMaterial* material = ManagerPhysics::gPhysics->createMaterial(0.5f, 0.3f, 0.2f);
+	PxShape* shape = ManagerPhysics::gPhysics->createShape(PxBoxGeometry(1, 1, 1), *material);
+	std::vector<PxActor*> boxes;
+	for (int x = 0; x < side; x++) {
+		for (int y = 0; y < side; y++) {
+			PxRigidStatic* box = ManagerPhysics::gPhysics->createRigidStatic(PxTransform(PxVec3(x * 3.0f - 96, y * 3.0f - 96, 1.0f + (x * y) % 5)));
+			box->attachShape(*shape);
+			boxes.push_back(box);
+		}
+	}
+	shape->release();
+	ManagerPhysics::scene->addActors(boxes.data(), (PxU32)boxes.size());
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> spread(-100, 100);
+	std::vector<PxVec3> origins(rays);
+	for (PxVec3& origin : origins)
+		origin = PxVec3(spread(rng), spread(rng), 50);
+	const PxVec3 down(0, 0, -1);
+	std::cout << "Scene query benchmark, " << frames << " frames of " << rays << " rays against " << boxes.size() << " boxes" << std::endl;
+
+	// Through the service: queue every ray with a callback, then one batched run
+	size_t hits = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		for (const PxVec3& origin : origins)
+			ManagerSceneQueries::raycast(origin, down, 100, [&hits](const SceneQueryHit* hit) { if (hit != nullptr) hits++; });
+		ManagerSceneQueries::run();
+	}
+	printResult("batched service", rays, frames, hits, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	// One blocking scene raycast per ray on this thread
+	hits = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		for (const PxVec3& origin : origins) {
+			PxRaycastBuffer hit;
+			if (ManagerPhysics::scene->raycast(origin, down, 100, hit)) hits++;
+		}
+	}
+	printResult("scene raycast", rays, frames, hits, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	// The same split across threads, reads are safe while nothing writes to the scene
+	size_t threads = std::max(2u, std::thread::hardware_concurrency());
+	std::atomic<size_t> thread_hits(0);
+	start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		std::vector<std::thread> workers;
+		for (size_t t = 0; t < threads; t++) {
+			workers.emplace_back([&, t]() {
+				size_t found = 0;
+				for (size_t i = t; i < origins.size(); i += threads) {
+					PxRaycastBuffer hit;
+					if (ManagerPhysics::scene->raycast(origins[i], down, 100, hit)) found++;
+				}
+				thread_hits += found;
+			});
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+	std::string method = "scene raycast x" + std::to_string(threads) + " threads";
+	printResult(method.c_str(), rays, frames, thread_hits, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	ManagerPhysics::scene->removeActors(boxes.data(), (PxU32)boxes.size());
+	for (PxActor* box : boxes)
+		box->release();
+	material->release();
+}
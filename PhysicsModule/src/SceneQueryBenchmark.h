@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Aftr
+{
+	// Measures raycast throughput through the batched query service against other ways of running them
+	class SceneQueryBenchmark {
+		public:
+			// Casts this many rays per frame down onto a field of temporary boxes and prints the time per frame
+			// for the batched service, one scene raycast at a time, and scene raycasts split across threads
+			static void run(size_t rays, size_t frames);
+	};
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include "SimulationEventRing.h"
+
+using namespace Aftr;
+
+SimulationEventRing::SimulationEventRing(size_t capacity) {
+	size_t size = 1;
+	while (size < capacity) size <<= 1;
+	events.resize(size);
+	mask = size - 1;
+}
+
+bool SimulationEventRing::push(const SimulationEvent& event) {
+	uint64_t h = head.load(std::memory_order_relaxed);
+	if (h - known_tail >= events.size()) {
+		known_tail = slowestTail(h);
+		if (h - known_tail >= events.size()) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+	}
+	events[h & mask] = event;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+uint64_t SimulationEventRing::slowestTail(uint64_t h) const {
+	uint64_t slowest = h; // Nobody reading, nothing to keep
+	for (const Reader& reader : readers) {
+		if (reader.active.load(std::memory_order_acquire))
+			slowest = std::min(slowest, reader.tail.load(std::memory_order_acquire));
+	}
+	return slowest;
+}
+
+int SimulationEventRing::subscribe() {
+	for (int i = 0; i < MAX_READERS; i++) {
+		if (readers[i].active.load(std::memory_order_relaxed)) continue;
+		readers[i].tail.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		readers[i].active.store(true, std::memory_order_release);
+		return i;
+	}
+	return -1;
+}
+
+void SimulationEventRing::unsubscribe(int reader) {
+	if (reader >= 0 && reader < MAX_READERS)
+		readers[reader].active.store(false, std::memory_order_release);
+}
+
+size_t SimulationEventRing::read(int reader, std::vector<SimulationEvent>& out) {
+	if (reader < 0 || reader >= MAX_READERS) return 0;
+	uint64_t t = readers[reader].tail.load(std::memory_order_relaxed);
+	uint64_t h = head.load(std::memory_order_acquire);
+	for (uint64_t i = t; i < h; i++)
+		out.push_back(events[i & mask]);
+	// The producer may reuse these slots once it sees the new tail
+	readers[reader].tail.store(h, std::memory_order_release);
+	return (size_t)(h - t);
+}
+
+uint64_t SimulationEventRing::getWritten() const {
+	return head.load(std::memory_order_relaxed);
+}
+
+uint64_t SimulationEventRing::getDropped() const {
+	return dropped.load(std::memory_order_relaxed);
+}
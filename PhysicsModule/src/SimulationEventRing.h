@@ -0,0 +1,65 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+	enum class SimulationEventType : uint32_t { Contact, TriggerEnter, TriggerExit, Wake, Sleep };
+
+	// Something the scene reported during fetchResults
+	struct SimulationEvent {
+		SimulationEventType type = SimulationEventType::Contact;
+		int id0 = -1; // Object ids, -1 for anything that isn't a spawned object
+		int id1 = -1; // Contacts and triggers only, the trigger is id0
+		physx::PxVec3 position = physx::PxVec3(0, 0, 0); // Average contact point, contacts only
+		float impulse = 0; // Total normal impulse of the contact, contacts only
+		// Triggers only, the trigger is actor0. Only for comparing, the actors may be gone by the time the event is read
+		const physx::PxActor* actor0 = nullptr;
+		const physx::PxActor* actor1 = nullptr;
+		uint64_t step = 0; // Physics step it happened in
+	};
+
+	// Single producer ring that any number of readers drain from their own threads, each seeing every event.
+	// Neither side ever takes a lock. When the slowest reader falls a whole ring behind, new events are
+	// dropped and counted instead of overwriting ones it hasn't read
+	class SimulationEventRing {
+		public:
+			static const int MAX_READERS = 8;
+
+			// Capacity is rounded up to a power of two
+			SimulationEventRing(size_t capacity);
+
+			// Producer. False if the event was dropped
+			bool push(const SimulationEvent& event);
+
+			// Main thread, with the scene idle. A reader that starts with the next event, -1 if all are taken
+			int subscribe();
+			void unsubscribe(int reader);
+			// The reader's thread. Appends every event since its last read, returns how many
+			size_t read(int reader, std::vector<SimulationEvent>& out);
+
+			uint64_t getWritten() const;
+			uint64_t getDropped() const;
+
+		protected:
+			struct Reader {
+				alignas(64) std::atomic<uint64_t> tail{ 0 }; // Events read, only the reader stores
+				std::atomic<bool> active{ false };
+			};
+
+			// Oldest event any reader still needs
+			uint64_t slowestTail(uint64_t head) const;
+
+			std::vector<SimulationEvent> events;
+			uint64_t mask;
+			alignas(64) std::atomic<uint64_t> head{ 0 }; // Events written, only the producer stores
+			uint64_t known_tail = 0; // Producer's last look at the slowest reader, only refreshed when the ring seems full
+			std::atomic<uint64_t> dropped{ 0 };
+			Reader readers[MAX_READERS];
+	};
+}
@@ -8,6 +8,8 @@ namespace Aftr {
 		public:
 			physx::PxRigidActor* actor; // Px actor
 			WO* wo; // Aftr object
+			int id = -1; // Replication id
+			physx::PxVec3 last_velocity = physx::PxVec3(0, 0, 0); // Linear velocity after the previous step
 
 			// New up a pointer
 			static WORigidActor* New(WO* wo, physx::PxRigidActor* actor) {
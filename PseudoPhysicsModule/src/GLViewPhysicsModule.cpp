@@ -31,6 +31,7 @@
 #include "WONVPhysX.h"
 #include "WONVDynSphere.h"
 #include "AftrGLRendererBase.h"
+#include "WOGUILabel.h"
 
 //If we want to use way points, we need to include this.
 #include "PhysicsModuleWayPoints.h"
@@ -41,6 +42,21 @@
 #include "NetMsgNewSharedObject.h"
 #include "NetMsgMoveSphere.h"
 #include "NetMsgObjectOrientation.h"
+#include "NetMsgObjectOrientationBatch.h"
+#include "NetTelemetry.h"
+#include "NetMsgViewerJoin.h"
+#include "NetMsgViewerCamera.h"
+#include "NetMsgWorldSnapshot.h"
+#include "NetShmRing.h"
+#include "NetMsgRemoveSharedObject.h"
+#include "NetMsgNewSharedObjectBatch.h"
+#include "NetMsgDragTarget.h"
+#include "NetMsgTerrainCrater.h"
+#include "NetMsgRagdollPose.h"
+
+#include <chrono>
+#include <iostream>
+#include <cstring>
 
 using namespace Aftr;
 
@@ -86,18 +102,79 @@ void GLViewPhysicsModule::onCreate()
    //this->setNumPhysicsStepsPerRender( 0 ); //pause physics engine on start up; will remain paused till set to 1
 
 	// Set up the NetMessenger Client. Must be done here due to reliance on the managers
-   if (ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort") == "12683") {
+   NetTelemetry::init("PseudoPhysicsModule");
+   predicting = ManagerEnvironmentConfiguration::getVariableValue("ViewerPrediction") == "1";
+   if (predicting)
+	   predictor.init(&terrain);
+   // NetAuthority is the host:port of the PhysicsModule, otherwise use the other local port like before
+   std::string authority = ManagerEnvironmentConfiguration::getVariableValue("NetAuthority");
+   size_t colon = authority.find(':');
+   if (colon != std::string::npos) {
+	   client = NetMessengerClient::New(authority.substr(0, colon), authority.substr(colon + 1));
+   }
+   else if (ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort") == "12683") {
 	   client = NetMessengerClient::New("127.0.0.1", "12682");
    }
    else {
 	   client = NetMessengerClient::New("127.0.0.1", "12683");
    }
+   // NetTransport=shm asks a PhysicsModule on this host to write into shared memory instead of sending over TCP
+   if (ManagerEnvironmentConfiguration::getVariableValue("NetTransport") == "shm") {
+	   std::string frame_bytes = ManagerEnvironmentConfiguration::getVariableValue("NetShmFrameBytes");
+	   std::string frames = ManagerEnvironmentConfiguration::getVariableValue("NetShmFrames");
+	   ring = NetShmRing::create("aftr_viewer_" + ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort"),
+		   frame_bytes.empty() ? 4096 : std::stoul(frame_bytes), frames.empty() ? 4096 : std::stoul(frames));
+	   if (ring == nullptr)
+		   std::cout << "Unable to create shared memory, using TCP" << std::endl;
+   }
+   sendJoin();
+}
+
+
+void GLViewPhysicsModule::sendJoin()
+{
+   NetMsgViewerJoin msg;
+   msg.schema_version = netSchemaVersion();
+   msg.host = viewerHost();
+   msg.port = ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort");
+   msg.focus = this->cam->getPosition();
+   if (ring != nullptr)
+	   msg.transport = "shm:" + ring->getName();
+   auto start = std::chrono::high_resolution_clock::now();
+   client->sendNetMsgSynchronousTCP(msg);
+   NetTelemetry::recordSendLatency( std::chrono::duration< double, std::milli >( std::chrono::high_resolution_clock::now() - start ).count() );
+   ms_since_join = 0;
+   sent_focus = msg.focus;
+}
+
+
+void GLViewPhysicsModule::sendCamera()
+{
+   NetMsgViewerCamera msg;
+   msg.host = viewerHost();
+   msg.port = ManagerEnvironmentConfiguration::getVariableValue("NetServerListenPort");
+   msg.focus = this->cam->getPosition();
+   auto start = std::chrono::high_resolution_clock::now();
+   client->sendNetMsgSynchronousTCP(msg);
+   NetTelemetry::recordSendLatency( std::chrono::duration< double, std::milli >( std::chrono::high_resolution_clock::now() - start ).count() );
+   ms_since_camera = 0;
+   sent_focus = msg.focus;
+}
+
+
+std::string GLViewPhysicsModule::viewerHost()
+{
+   std::string host = ManagerEnvironmentConfiguration::getVariableValue("NetViewerHost");
+   if (host.empty())
+	   host = "127.0.0.1";
+   return host;
 }
 
 
 GLViewPhysicsModule::~GLViewPhysicsModule()
 {
    //Implicitly calls GLView::~GLView()
+   delete ring;
 }
 
 
@@ -106,6 +183,215 @@ void GLViewPhysicsModule::updateWorld()
    GLView::updateWorld(); //Just call the parent's update world first.
                           //If you want to add additional functionality, do it after
                           //this call.
+
+   if (ring != nullptr)
+	   pollRing();
+
+   // Keep asking to join until the snapshot is in, the authority may have started after this viewer
+   if (!joined && !rejected) {
+	   ms_since_join += ManagerSDLTime::getTimeSinceLastMainLoopIteration();
+	   if (ms_since_join >= 1000)
+		   sendJoin();
+   }
+   // Camera updates are throttled, a few per second is plenty for priorities
+   else {
+	   ms_since_camera += ManagerSDLTime::getTimeSinceLastMainLoopIteration();
+	   if (ms_since_camera >= 250 && (this->cam->getPosition() - sent_focus).length() > 1.0f)
+		   sendCamera();
+   }
+
+   // Draw where the local prediction has every moving object by now
+   if (predicting && joined) {
+	   predictor.step(ManagerSDLTime::getTimeSinceLastMainLoopIteration());
+	   for (size_t i = 0; i < predictor.size(); i++) {
+		   PoseRecord pose = predictor.getPose(i);
+		   WO* wo = placed_cubes[pose.id];
+		   wo->getModel()->setDisplayMatrix(pose.toDisplayMatrix());
+		   wo->setPosition(Vector(pose.location[0], pose.location[1], pose.location[2]));
+	   }
+   }
+
+   // Tiles that craters dug into since the last frame
+   terrain.uploadDirty();
+
+   NetTelemetry::update(ManagerSDLTime::getTimeSinceLastMainLoopIteration());
+   updateTelemetryOverlay();
+}
+
+
+void GLViewPhysicsModule::placeObject( int id, WO* wo, const std::string& model_path, const Vector& scale )
+{
+   if( id < 0 )
+      return;
+   if( id >= (int)placed_cubes.size() )
+      placed_cubes.resize( id + 1, nullptr );
+   placed_cubes[id] = wo;
+   // Only the plain 4x4x4 cube is a box the prediction can stand in for, tanks and other models go where they're told
+   const std::string cube = "cube4x4x4redShinyPlastic_pp.wrl";
+   if( predicting && model_path.size() >= cube.size() && model_path.compare( model_path.size() - cube.size(), cube.size(), cube ) == 0 )
+      predictor.add( id, scale * 2 );
+}
+
+
+void GLViewPhysicsModule::removeObject( int id )
+{
+   if( id < 0 || id >= (int)placed_cubes.size() || placed_cubes[id] == nullptr )
+      return;
+   worldLst->eraseViaWOptr( placed_cubes[id] );
+   delete placed_cubes[id];
+   placed_cubes[id] = nullptr;
+   predictor.remove( id );
+}
+
+
+void GLViewPhysicsModule::showDragTarget( int id, const Vector& target )
+{
+   drag_marker->isVisible = id >= 0;
+   drag_marker->setPosition( target );
+}
+
+
+void GLViewPhysicsModule::digCrater( unsigned int index, const Vector& center, float radius, float depth )
+{
+   // Replays after a snapshot repeat craters this viewer already has
+   if( index != craters_applied )
+      return;
+   terrain.crater( center.x, center.y, radius, depth );
+   craters_applied++;
+}
+
+
+void GLViewPhysicsModule::clearPlacedObjects()
+{
+   for( WO* wo : placed_cubes )
+   {
+      if( wo != nullptr )
+      {
+         worldLst->eraseViaWOptr( wo );
+         delete wo;
+      }
+   }
+   placed_cubes.clear();
+   predictor.clear();
+}
+
+
+void GLViewPhysicsModule::applyPoses( unsigned int sequence, const char* records, size_t count )
+{
+   // Anything older than the snapshot is already part of it
+   if( !joined || sequence <= last_sequence )
+      return;
+   last_sequence = sequence;
+   applyRecords( records, count, predicting );
+}
+
+
+void GLViewPhysicsModule::applyRagdollPoses( unsigned int sequence, const char* records, size_t count )
+{
+   if( !joined || sequence <= last_sequence )
+      return;
+   // Links are held together by joints the prediction knows nothing about
+   applyRecords( records, count, false );
+}
+
+
+void GLViewPhysicsModule::applyRecords( const char* records, size_t count, bool predict )
+{
+   for( size_t i = 0; i < count; i++ )
+   {
+      PoseRecord pose;
+      std::memcpy( &pose, records + i * sizeof( PoseRecord ), sizeof( PoseRecord ) );
+      // Ignore objects this viewer hasn't been told about
+      if( pose.id < 0 || pose.id >= (int)placed_cubes.size() || placed_cubes[pose.id] == nullptr )
+         continue;
+      // The prediction takes it from here and draws it every frame
+      if( predict && predictor.correct( pose ) )
+         continue;
+      if( predicting )
+         predictor.remove( pose.id );
+      WO* wo = placed_cubes[pose.id];
+      wo->getModel()->setDisplayMatrix( pose.toDisplayMatrix() );
+      wo->setPosition( Vector( pose.location[0], pose.location[1], pose.location[2] ) );
+   }
+}
+
+
+namespace
+{
+   // Decode a ring message of type Msg and run it like NetMessenger would
+   template< class Msg >
+   bool deliverFromRing( uint32_t type, const char* data, size_t bytes )
+   {
+      if( type != NetSchemaCodec< Msg >::hash() )
+         return false;
+      NetTelemetry::countReceived( NetSchema< Msg >::name, bytes );
+      Msg msg;
+      if( NetSchemaCodec< Msg >::decode( msg, data, bytes ) )
+         msg.onMessageArrived();
+      return true;
+   }
+}
+
+
+void GLViewPhysicsModule::pollRing()
+{
+   uint32_t type = 0;
+   const char* data = nullptr;
+   size_t bytes = 0;
+   while( ring->peek( type, data, bytes ) )
+   {
+      if( type == NetSchemaCodec< NetMsgObjectOrientationBatch >::hash() )
+      {
+         // Poses are applied where they sit in the ring, mirrors NetSchema< NetMsgObjectOrientationBatch >
+         NetTelemetryApplyTimer timer;
+         NetTelemetry::countReceived( NetSchema< NetMsgObjectOrientationBatch >::name, bytes );
+         NetByteReader r( data, bytes );
+         unsigned int sequence = 0;
+         uint32_t size = 0;
+         r.readBytes( &sequence, sizeof( sequence ) );
+         r.readBytes( &size, sizeof( size ) );
+         const char* records = r.view( size );
+         if( records != nullptr )
+            applyPoses( sequence, records, size / sizeof( PoseRecord ) );
+      }
+      else if( !deliverFromRing< NetMsgWorldSnapshot >( type, data, bytes )
+         && !deliverFromRing< NetMsgNewSharedObject >( type, data, bytes )
+         && !deliverFromRing< NetMsgMoveSphere >( type, data, bytes )
+         && !deliverFromRing< NetMsgRemoveSharedObject >( type, data, bytes )
+         && !deliverFromRing< NetMsgNewSharedObjectBatch >( type, data, bytes )
+         && !deliverFromRing< NetMsgDragTarget >( type, data, bytes )
+         && !deliverFromRing< NetMsgTerrainCrater >( type, data, bytes )
+         && !deliverFromRing< NetMsgRagdollPose >( type, data, bytes ) )
+      {
+         std::cout << "Unknown message type " << type << " in shared memory" << std::endl;
+      }
+      ring->pop();
+   }
+}
+
+
+void GLViewPhysicsModule::updateTelemetryOverlay()
+{
+   if( telemetry_periods_shown == NetTelemetry::getPeriods() )
+      return;
+   telemetry_periods_shown = NetTelemetry::getPeriods();
+
+   const std::vector< std::string >& summary = NetTelemetry::getSummary();
+   while( telemetry_labels.size() < summary.size() )
+   {
+      WOGUILabel* label = WOGUILabel::New( nullptr );
+      label->setFontPath( ManagerEnvironmentConfiguration::getSMM() + "/fonts/arial.ttf" );
+      label->setFontSize( 14 );
+      label->setColor( 255, 255, 0, 255 );
+      label->setPosition( Vector( 0.01f, 0.98f - 0.03f * telemetry_labels.size(), 0 ) );
+      worldLst->push_back( label );
+      telemetry_labels.push_back( label );
+   }
+   for( size_t i = 0; i < telemetry_labels.size(); i++ )
+   {
+      telemetry_labels[i]->setText( i < summary.size() ? summary[i] : "" );
+      telemetry_labels[i]->isVisible = show_telemetry;
+   }
 }
 
 
@@ -138,6 +424,14 @@ void GLViewPhysicsModule::onKeyDown( const SDL_KeyboardEvent& key )
    GLView::onKeyDown( key );
    if( key.keysym.sym == SDLK_0 )
       this->setNumPhysicsStepsPerRender( 1 );
+
+   // Toggle the network telemetry overlay
+   if( key.keysym.sym == SDLK_3 )
+   {
+      show_telemetry = !show_telemetry;
+      for( WOGUILabel* label : telemetry_labels )
+         label->isVisible = show_telemetry;
+   }
 }
 
 
@@ -225,10 +519,17 @@ void Aftr::GLViewPhysicsModule::loadMap()
    grassSkin.setSpecularCoefficient( 10 ); // How "sharp" are the specular highlights (bigger is sharper, 1000 is very sharp, 10 is very dull)
    wo->setLabel( "Grass" );
    worldLst->push_back( wo );
+   // Heightfield terrain takes the grass's place when aftr.conf names one
+   if( terrain.loadConfigured( worldLst ) )
+      wo->isVisible = false;
 
    track_sphere = WO::New(yellowSphere, Vector(0.25f, 0.25f, 0.25f), MESH_SHADING_TYPE::mstFLAT);
    track_sphere->setPosition(Vector(20, 20, 100));
    worldLst->push_back(track_sphere);
+
+   drag_marker = WO::New(yellowSphere, Vector(0.1f, 0.1f, 0.1f), MESH_SHADING_TYPE::mstFLAT);
+   drag_marker->isVisible = false;
+   worldLst->push_back(drag_marker);
    
    //createPhysicsModuleWayPoints();
 }
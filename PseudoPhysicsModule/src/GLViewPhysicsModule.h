@@ -2,12 +2,16 @@
 
 #include "GLView.h"
 #include "NetMessengerClient.h"
+#include "PosePredictor.h"
+#include "TerrainTiles.h"
 
 #include <vector>
 
 namespace Aftr
 {
    class Camera;
+   class WOGUILabel;
+   class NetShmRing;
 
 /**
    \class GLViewPhysicsModule
@@ -37,13 +41,54 @@ public:
    virtual void onKeyUp( const SDL_KeyboardEvent& key );
 
    WO* track_sphere;
-   std::vector<WO*> placed_cubes; // Store the cubes placed. Doesn't need a map since we obtain index
+   WO* drag_marker = nullptr; // Where the authority is dragging an object to, hidden while nothing is dragged
+   std::vector<WO*> placed_cubes; // Store the cubes placed, indexed by the authority's object id
+   bool joined = false; // Has the whole snapshot arrived
+   bool rejected = false; // The authority refused this viewer's message schema, stop asking to join
+   unsigned int last_sequence = 0; // Newest authority flush applied
+   unsigned int ms_since_join = 0; // Time since the last join request or snapshot chunk
+   bool predicting = false; // ViewerPrediction=1, objects move locally between authority updates
+   PosePredictor predictor;
+   TerrainTiles terrain; // Same terrain as the authority, if aftr.conf names one
+   unsigned int craters_applied = 0; // Craters dug into the terrain so far, in the authority's order
+
+   // Store an object under the authority's id, created from this model and scale
+   void placeObject(int id, WO* wo, const std::string& model_path, const Vector& scale);
+   // Remove one replicated object the authority despawned
+   void removeObject(int id);
+   // Move the drag marker to the target, an id of -1 hides it
+   void showDragTarget(int id, const Vector& target);
+   // Dig the authority's crater with this index, unless it's already been dug
+   void digCrater( unsigned int index, const Vector& center, float radius, float depth );
+   // Remove every replicated object, used before a fresh snapshot
+   void clearPlacedObjects();
+   // Apply one authority flush worth of packed PoseRecords, straight from wherever they arrived
+   void applyPoses( unsigned int sequence, const char* records, size_t count );
+   // Apply every link of one ragdoll. Sent ahead of the flush's batch, so it doesn't advance last_sequence itself
+   void applyRagdollPoses( unsigned int sequence, const char* records, size_t count );
 
 protected:
    GLViewPhysicsModule( const std::vector< std::string >& args );
    virtual void onCreate();  
+   // Network telemetry overlay, toggled with '3'
+   void updateTelemetryOverlay();
+   std::vector<WOGUILabel*> telemetry_labels;
+   size_t telemetry_periods_shown = 0;
+   bool show_telemetry = false;
+   void sendJoin(); // Ask the authority to replicate to this viewer
+   void sendCamera(); // Tell the authority where the camera is, it prioritizes nearby objects
+   std::string viewerHost(); // Where the authority reaches this viewer
+   Vector sent_focus; // Camera position the authority last heard about
+   unsigned int ms_since_camera = 0;
+
+   // Move the objects in a run of packed PoseRecords, through the prediction if predict is set
+   void applyRecords( const char* records, size_t count, bool predict );
+
+   // Deliver everything the authority wrote into the shared memory ring since last frame
+   void pollRing();
 
    NetMessengerClient* client;
+   NetShmRing* ring = nullptr; // Set when NetTransport=shm, the authority then sends through it instead of TCP
 };
 
 /** \} */
@@ -0,0 +1,35 @@
+#include <sstream>
+
+#include "NetMsgDragTarget.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgDragTarget);
+
+// Payload is packed from the NetSchema
+bool NetMsgDragTarget::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgDragTarget>::toStream(*this, os);
+}
+
+bool NetMsgDragTarget::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgDragTarget>::fromStream(*this, is);
+}
+
+// Show where the object is being pulled, or hide the marker once it's let go
+void NetMsgDragTarget::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	ManagerGLView::getGLView<GLViewPhysicsModule>()->showDragTarget(object_id, target);
+}
+
+// For debug purposes
+std::string NetMsgDragTarget::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Id: " << object_id << "\n"
+		<< "Target: x = " << target.x << " y = " << target.y << " z = " << target.z << "\n";
+	return ss.str();
+}
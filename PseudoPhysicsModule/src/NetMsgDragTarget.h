@@ -0,0 +1,35 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "Vector.h"
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Where the authority is dragging an object to, sent once per replication tick while it changes
+	class NetMsgDragTarget : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgDragTarget);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		int object_id = -1; // -1 once the object is let go
+		Vector target;
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgDragTarget> {
+		static constexpr const char* name = "NetMsgDragTarget";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgDragTarget, object_id),
+				NET_FIELD(NetMsgDragTarget, target));
+		}
+	};
+}
+
+#endif
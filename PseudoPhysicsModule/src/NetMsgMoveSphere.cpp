@@ -10,20 +10,18 @@ using namespace Aftr;
 
 NetMsgMacroDefinition(NetMsgMoveSphere);
 
-// Send location as payload
+// Payload is packed from the NetSchema
 bool NetMsgMoveSphere::toStream(NetMessengerStreamBuffer& os) const {
-	os << location.x << location.y << location.z;
-	return true;
+	return NetSchemaCodec<NetMsgMoveSphere>::toStream(*this, os);
 }
 
-// Receive location as payload
 bool NetMsgMoveSphere::fromStream(NetMessengerStreamBuffer& is) {
-	is >> location.x >> location.y >> location.z;
-	return true;
+	return NetSchemaCodec<NetMsgMoveSphere>::fromStream(*this, is);
 }
 
 // Update position
 void NetMsgMoveSphere::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
 	ManagerGLView::getGLView<GLViewPhysicsModule>()->track_sphere->setPosition(location);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "NetMsg.h"
+#include "NetMsgSchema.h"
 #include "Vector.h"
 #include "WO.h"
 
@@ -20,6 +21,15 @@ namespace Aftr {
 
 		Vector location;
 	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgMoveSphere> {
+		static constexpr const char* name = "NetMsgMoveSphere";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgMoveSphere, location));
+		}
+	};
 }
 
 #endif
\ No newline at end of file
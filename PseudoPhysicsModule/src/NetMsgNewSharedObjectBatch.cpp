@@ -0,0 +1,58 @@
+#include <sstream>
+#include <cstring>
+
+#include "NetMsgNewSharedObjectBatch.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+#include "WorldContainer.h"
+#include "Model.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgNewSharedObjectBatch);
+
+// Payload is packed from the NetSchema
+bool NetMsgNewSharedObjectBatch::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgNewSharedObjectBatch>::toStream(*this, os);
+}
+
+bool NetMsgNewSharedObjectBatch::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgNewSharedObjectBatch>::fromStream(*this, is);
+}
+
+// Add every new object under the authority's ids
+void NetMsgNewSharedObjectBatch::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	GLViewPhysicsModule* glv = ManagerGLView::getGLView<GLViewPhysicsModule>();
+	for (const SnapshotRecord& record : decode()) {
+		if (record.model_id < 0 || record.model_id >= (int)models.size()) continue;
+		WO* wo = WO::New(models[record.model_id], Vector(record.scale[0], record.scale[1], record.scale[2]));
+		wo->setPosition(Vector(record.pose.location[0], record.pose.location[1], record.pose.location[2]));
+		wo->getModel()->setDisplayMatrix(record.pose.toDisplayMatrix());
+		glv->getWorldContainer()->push_back(wo);
+		glv->placeObject(record.pose.id, wo, models[record.model_id], Vector(record.scale[0], record.scale[1], record.scale[2]));
+	}
+}
+
+void NetMsgNewSharedObjectBatch::encode(const SnapshotRecord* records, size_t count) {
+	payload.resize(count * sizeof(SnapshotRecord));
+	if (count > 0)
+		std::memcpy(&payload[0], records, payload.size());
+}
+
+std::vector<SnapshotRecord> NetMsgNewSharedObjectBatch::decode() const {
+	std::vector<SnapshotRecord> records(payload.size() / sizeof(SnapshotRecord));
+	if (!records.empty())
+		std::memcpy(records.data(), payload.data(), records.size() * sizeof(SnapshotRecord));
+	return records;
+}
+
+// For debug purposes
+std::string NetMsgNewSharedObjectBatch::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Models: " << models.size() << " Objects: " << payload.size() / sizeof(SnapshotRecord) << " (" << payload.size() << " bytes)\n";
+	return ss.str();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "NetMsgWorldSnapshot.h"
+
+#include <string>
+#include <vector>
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Every object spawned since the last flush in a single message
+	class NetMsgNewSharedObjectBatch : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgNewSharedObjectBatch);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		void encode(const SnapshotRecord* records, size_t count);
+		std::vector<SnapshotRecord> decode() const;
+
+		std::vector<std::string> models; // Model table, SnapshotRecord::model_id indexes it
+		std::string payload;
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgNewSharedObjectBatch> {
+		static constexpr const char* name = "NetMsgNewSharedObjectBatch";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgNewSharedObjectBatch, models),
+				NET_FIELD(NetMsgNewSharedObjectBatch, payload));
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include <sstream>
+#include <cstring>
+
+#include "NetMsgObjectOrientationBatch.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+#include "Model.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgObjectOrientationBatch);
+
+Mat4 PoseRecord::toDisplayMatrix() const {
+	float convert[16] = {rotation[0], rotation[1], rotation[2], 0,
+						 rotation[3], rotation[4], rotation[5], 0,
+						 rotation[6], rotation[7], rotation[8], 0,
+						 0, 0, 0, 1};
+	return Mat4(convert);
+}
+
+// Payload is packed from the NetSchema
+bool NetMsgObjectOrientationBatch::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgObjectOrientationBatch>::toStream(*this, os);
+}
+
+bool NetMsgObjectOrientationBatch::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgObjectOrientationBatch>::fromStream(*this, is);
+}
+
+// Update position and orientation of every object in the batch
+void NetMsgObjectOrientationBatch::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	ManagerGLView::getGLView<GLViewPhysicsModule>()->applyPoses(sequence, payload.data(), getRecordCount());
+}
+
+void NetMsgObjectOrientationBatch::encode(const std::vector<PoseRecord>& records) {
+	payload.resize(records.size() * sizeof(PoseRecord));
+	if (!records.empty())
+		std::memcpy(&payload[0], records.data(), payload.size());
+}
+
+std::vector<PoseRecord> NetMsgObjectOrientationBatch::decode() const {
+	std::vector<PoseRecord> records(getRecordCount());
+	if (!records.empty())
+		std::memcpy(records.data(), payload.data(), records.size() * sizeof(PoseRecord));
+	return records;
+}
+
+size_t NetMsgObjectOrientationBatch::getRecordCount() const {
+	return payload.size() / sizeof(PoseRecord);
+}
+
+// For debug purposes
+std::string NetMsgObjectOrientationBatch::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Sequence: " << sequence << " Records: " << getRecordCount() << " (" << payload.size() << " bytes)\n";
+	return ss.str();
+}
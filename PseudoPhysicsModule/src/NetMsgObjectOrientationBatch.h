@@ -0,0 +1,56 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "Vector.h"
+#include "Mat4.h"
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Pose of one replicated object, packed as-is into a batch payload
+	struct PoseRecord {
+		int id; // Object id shared between the authority and the viewers
+		float location[3];
+		float rotation[9]; // Upper 3x3 of the display matrix, same layout as NetMsgObjectOrientation
+
+		// Rebuild the aftr display matrix from the packed rotation
+		Mat4 toDisplayMatrix() const;
+	};
+	static_assert(std::is_trivially_copyable<PoseRecord>::value, "PoseRecord is copied into payloads byte for byte");
+
+	// Every pose update for one frame in a single message
+	class NetMsgObjectOrientationBatch : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgObjectOrientationBatch);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		// Pack the records once; the same message is then sent to every viewer that wants these records
+		void encode(const std::vector<PoseRecord>& records);
+		std::vector<PoseRecord> decode() const;
+		size_t getRecordCount() const;
+
+		unsigned int sequence = 0; // Increases by one every authority flush
+		std::string payload;
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgObjectOrientationBatch> {
+		static constexpr const char* name = "NetMsgObjectOrientationBatch";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgObjectOrientationBatch, sequence),
+				NET_FIELD(NetMsgObjectOrientationBatch, payload));
+		}
+	};
+}
+
+#endif
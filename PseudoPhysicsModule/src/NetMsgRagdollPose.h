@@ -0,0 +1,42 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "NetMsgObjectOrientationBatch.h"
+
+#include <string>
+#include <vector>
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Every link of one ragdoll for one authority flush. The links are ordinary replicated objects, but they
+	// only look right together, so they travel as one message instead of through the per object scheduling
+	class NetMsgRagdollPose : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgRagdollPose);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		void encode(const std::vector<PoseRecord>& links);
+		size_t getRecordCount() const;
+
+		unsigned int sequence = 0; // The flush it was sent in, same numbering as NetMsgObjectOrientationBatch
+		std::string payload; // Packed PoseRecords, root link first
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgRagdollPose> {
+		static constexpr const char* name = "NetMsgRagdollPose";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgRagdollPose, sequence),
+				NET_FIELD(NetMsgRagdollPose, payload));
+		}
+	};
+}
+
+#endif
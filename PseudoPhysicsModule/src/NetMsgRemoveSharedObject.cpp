@@ -0,0 +1,34 @@
+#include <sstream>
+
+#include "NetMsgRemoveSharedObject.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgRemoveSharedObject);
+
+// Payload is packed from the NetSchema
+bool NetMsgRemoveSharedObject::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgRemoveSharedObject>::toStream(*this, os);
+}
+
+bool NetMsgRemoveSharedObject::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgRemoveSharedObject>::fromStream(*this, is);
+}
+
+// Drop the object from the world
+void NetMsgRemoveSharedObject::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	ManagerGLView::getGLView<GLViewPhysicsModule>()->removeObject(object_id);
+}
+
+// For debug purposes
+std::string NetMsgRemoveSharedObject::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Id: " << object_id << "\n";
+	return ss.str();
+}
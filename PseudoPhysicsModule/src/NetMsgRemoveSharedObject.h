@@ -0,0 +1,32 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// An object the authority despawned, its id is never reused
+	class NetMsgRemoveSharedObject : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgRemoveSharedObject);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		int object_id = -1;
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgRemoveSharedObject> {
+		static constexpr const char* name = "NetMsgRemoveSharedObject";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgRemoveSharedObject, object_id));
+		}
+	};
+}
+
+#endif
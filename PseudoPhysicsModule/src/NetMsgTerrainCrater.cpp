@@ -0,0 +1,36 @@
+#include <sstream>
+
+#include "NetMsgTerrainCrater.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgTerrainCrater);
+
+// Payload is packed from the NetSchema
+bool NetMsgTerrainCrater::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgTerrainCrater>::toStream(*this, os);
+}
+
+bool NetMsgTerrainCrater::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgTerrainCrater>::fromStream(*this, is);
+}
+
+// Dig the same crater into our copy of the terrain
+void NetMsgTerrainCrater::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	ManagerGLView::getGLView<GLViewPhysicsModule>()->digCrater(index, center, radius, depth);
+}
+
+// For debug purposes
+std::string NetMsgTerrainCrater::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Index: " << index << "\n"
+		<< "Center: x = " << center.x << " y = " << center.y << " z = " << center.z << "\n"
+		<< "Radius: " << radius << " Depth: " << depth << "\n";
+	return ss.str();
+}
@@ -0,0 +1,31 @@
+#include <sstream>
+
+#include "NetMsgViewerCamera.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgViewerCamera);
+
+// Payload is packed from the NetSchema
+bool NetMsgViewerCamera::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgViewerCamera>::toStream(*this, os);
+}
+
+bool NetMsgViewerCamera::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgViewerCamera>::fromStream(*this, is);
+}
+
+// Only the authority schedules, nothing to do
+void NetMsgViewerCamera::onMessageArrived() {
+}
+
+// For debug purposes
+std::string NetMsgViewerCamera::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Viewer: " << host << ":" << port << "\n"
+		<< "Focus: x = " << focus.x << " y = " << focus.y << " z = " << focus.z << "\n";
+	return ss.str();
+}
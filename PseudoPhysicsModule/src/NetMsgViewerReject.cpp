@@ -0,0 +1,39 @@
+#include <sstream>
+#include <iostream>
+
+#include "NetMsgViewerReject.h"
+#include "NetMsgViewerJoin.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgViewerReject);
+
+// Payload is packed from the NetSchema
+bool NetMsgViewerReject::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgViewerReject>::toStream(*this, os);
+}
+
+bool NetMsgViewerReject::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgViewerReject>::fromStream(*this, is);
+}
+
+// The authority won't replicate to a build with another message schema, so stop asking
+void NetMsgViewerReject::onMessageArrived() {
+	GLViewPhysicsModule* glv = ManagerGLView::getGLView<GLViewPhysicsModule>();
+	if (glv->rejected) return;
+	glv->rejected = true;
+	std::cout << "Authority refused to replicate, its message schema " << std::hex << schema_version
+		<< " does not match ours " << netSchemaVersion() << std::dec << ". Rebuild both modules from the same source" << std::endl;
+}
+
+// For debug purposes
+std::string NetMsgViewerReject::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Schema: " << std::hex << schema_version << std::dec << "\n";
+	return ss.str();
+}
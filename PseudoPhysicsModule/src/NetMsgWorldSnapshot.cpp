@@ -0,0 +1,71 @@
+#include <sstream>
+#include <cstring>
+
+#include "NetMsgWorldSnapshot.h"
+#include "ManagerGLView.h"
+#include "GLViewPhysicsModule.h"
+#include "WorldContainer.h"
+#include "Model.h"
+
+using namespace Aftr;
+
+NetMsgMacroDefinition(NetMsgWorldSnapshot);
+
+// Payload is packed from the NetSchema
+bool NetMsgWorldSnapshot::toStream(NetMessengerStreamBuffer& os) const {
+	return NetSchemaCodec<NetMsgWorldSnapshot>::toStream(*this, os);
+}
+
+bool NetMsgWorldSnapshot::fromStream(NetMessengerStreamBuffer& is) {
+	return NetSchemaCodec<NetMsgWorldSnapshot>::fromStream(*this, is);
+}
+
+// Create every object in the chunk, the last chunk completes the join
+void NetMsgWorldSnapshot::onMessageArrived() {
+	NetTelemetryApplyTimer timer;
+	GLViewPhysicsModule* glv = ManagerGLView::getGLView<GLViewPhysicsModule>();
+	glv->ms_since_join = 0; // Still streaming, don't ask again
+	if (chunk_index == 0) {
+		glv->clearPlacedObjects();
+		glv->track_sphere->setPosition(drop_pos);
+	}
+
+	for (const SnapshotRecord& record : decode()) {
+		if (record.model_id < 0 || record.model_id >= (int)models.size()) continue;
+		WO* wo = WO::New(models[record.model_id], Vector(record.scale[0], record.scale[1], record.scale[2]));
+		wo->setPosition(Vector(record.pose.location[0], record.pose.location[1], record.pose.location[2]));
+		wo->getModel()->setDisplayMatrix(record.pose.toDisplayMatrix());
+		glv->getWorldContainer()->push_back(wo);
+		glv->placeObject(record.pose.id, wo, models[record.model_id], Vector(record.scale[0], record.scale[1], record.scale[2]));
+	}
+
+	if (chunk_index + 1 == chunk_count) {
+		glv->joined = true;
+		glv->last_sequence = sequence;
+	}
+}
+
+void NetMsgWorldSnapshot::encode(const SnapshotRecord* records, size_t count) {
+	payload.resize(count * sizeof(SnapshotRecord));
+	if (count > 0)
+		std::memcpy(&payload[0], records, payload.size());
+}
+
+std::vector<SnapshotRecord> NetMsgWorldSnapshot::decode() const {
+	std::vector<SnapshotRecord> records(payload.size() / sizeof(SnapshotRecord));
+	if (!records.empty())
+		std::memcpy(records.data(), payload.data(), records.size() * sizeof(SnapshotRecord));
+	return records;
+}
+
+// For debug purposes
+std::string NetMsgWorldSnapshot::toString() const {
+	std::stringstream ss;
+
+	ss << NetMsg::toString();
+	ss << "  Payload: \n"
+		<< "Sequence: " << sequence << " Chunk: " << chunk_index + 1 << " of " << chunk_count << "\n"
+		<< "Models: " << models.size() << " Records: " << payload.size() / sizeof(SnapshotRecord) << "\n"
+		<< "Drop zone: x = " << drop_pos.x << " y = " << drop_pos.y << " z = " << drop_pos.z << "\n";
+	return ss.str();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "NetMsgSchema.h"
+#include "Vector.h"
+#include "NetMsgObjectOrientationBatch.h"
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+namespace Aftr {
+	// Everything a late viewer needs to create one replicated object
+	struct SnapshotRecord {
+		int model_id; // Index into the snapshot's model table
+		float scale[3];
+		PoseRecord pose;
+	};
+	static_assert(std::is_trivially_copyable<SnapshotRecord>::value, "SnapshotRecord is copied into payloads byte for byte");
+
+	// One chunk of the full world, streamed to a viewer that joins mid-session
+	class NetMsgWorldSnapshot : public NetMsg {
+	public:
+		NetMsgMacroDeclaration(NetMsgWorldSnapshot);
+
+		virtual bool toStream(NetMessengerStreamBuffer& os) const;
+		virtual bool fromStream(NetMessengerStreamBuffer& is);
+		virtual void onMessageArrived();
+		virtual std::string toString() const;
+
+		void encode(const SnapshotRecord* records, size_t count);
+		std::vector<SnapshotRecord> decode() const;
+
+		unsigned int sequence = 0; // Batches after this sequence apply on top of the snapshot
+		unsigned int chunk_index = 0;
+		unsigned int chunk_count = 0;
+		std::vector<std::string> models; // Model table, small enough to repeat in every chunk
+		Vector drop_pos;
+		std::string payload;
+	};
+
+	// Payload layout, the serializers are generated from this
+	template<> struct NetSchema<NetMsgWorldSnapshot> {
+		static constexpr const char* name = "NetMsgWorldSnapshot";
+		static constexpr auto fields() {
+			return std::make_tuple(
+				NET_FIELD(NetMsgWorldSnapshot, sequence),
+				NET_FIELD(NetMsgWorldSnapshot, chunk_index),
+				NET_FIELD(NetMsgWorldSnapshot, chunk_count),
+				NET_FIELD(NetMsgWorldSnapshot, models),
+				NET_FIELD(NetMsgWorldSnapshot, drop_pos),
+				NET_FIELD(NetMsgWorldSnapshot, payload));
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include "NetShmRing.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Aftr;
+
+namespace {
+	const uint32_t RING_MAGIC = 0x52544641; // "AFTR"
+
+	size_t headerBytes() {
+		return (sizeof(NetShmRingHeader) + 63) / 64 * 64;
+	}
+}
+
+NetShmRing* NetShmRing::create(const std::string& name, uint32_t frame_bytes, uint32_t frame_count) {
+	// Frames hold at least their own header and stay aligned for the records packed after it
+	frame_bytes = (std::max<uint32_t>(frame_bytes, 2 * sizeof(NetShmFrameHeader)) + 63) / 64 * 64;
+	NetShmRing* ring = new NetShmRing();
+	ring->name = name;
+	ring->owner = true;
+	if (frame_count == 0 || !ring->map(true, headerBytes() + (size_t)frame_bytes * frame_count)) {
+		delete ring;
+		return nullptr;
+	}
+	ring->header = new (ring->header) NetShmRingHeader();
+	ring->header->frame_bytes = frame_bytes;
+	ring->header->frame_count = frame_count;
+	ring->header->head.store(0, std::memory_order_relaxed);
+	ring->header->tail.store(0, std::memory_order_relaxed);
+	// Published last, so a producer never sees a half built header
+	std::atomic_thread_fence(std::memory_order_release);
+	ring->header->magic = RING_MAGIC;
+	return ring;
+}
+
+NetShmRing* NetShmRing::open(const std::string& name) {
+	NetShmRing* ring = new NetShmRing();
+	ring->name = name;
+	if (!ring->map(false, 0) || ring->header->magic != RING_MAGIC
+		|| ring->size < headerBytes() + (size_t)ring->header->frame_bytes * ring->header->frame_count) {
+		delete ring;
+		return nullptr;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return ring;
+}
+
+#ifdef _WIN32
+bool NetShmRing::map(bool create, size_t size) {
+	HANDLE mapping = create
+		? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, name.c_str())
+		: OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+	if (mapping == NULL) return false;
+	handle = mapping;
+	void* at = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (at == NULL) return false;
+	if (!create) {
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery(at, &info, sizeof(info));
+		size = info.RegionSize;
+	}
+	this->size = size;
+	header = static_cast<NetShmRingHeader*>(at);
+	frames = static_cast<char*>(at) + headerBytes();
+	return size >= headerBytes();
+}
+
+NetShmRing::~NetShmRing() {
+	if (header != nullptr) UnmapViewOfFile(header);
+	if (handle != nullptr) CloseHandle(static_cast<HANDLE>(handle));
+}
+#else
+bool NetShmRing::map(bool create, size_t size) {
+	std::string path = "/" + name;
+	if (create) shm_unlink(path.c_str()); // Left behind by a viewer that crashed
+	int fd = shm_open(path.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+	if (fd < 0) return false;
+	if (create && ftruncate(fd, (off_t)size) != 0) {
+		close(fd);
+		return false;
+	}
+	if (!create) {
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			return false;
+		}
+		size = (size_t)info.st_size;
+	}
+	void* at = size >= headerBytes() ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd); // The mapping keeps the segment alive
+	if (at == MAP_FAILED) return false;
+	this->size = size;
+	header = static_cast<NetShmRingHeader*>(at);
+	frames = static_cast<char*>(at) + headerBytes();
+	return true;
+}
+
+NetShmRing::~NetShmRing() {
+	if (header != nullptr) munmap(header, size);
+	if (owner) shm_unlink(("/" + name).c_str());
+}
+#endif
+
+uint32_t NetShmRing::framesFor(size_t bytes) const {
+	return (uint32_t)((sizeof(NetShmFrameHeader) + bytes + header->frame_bytes - 1) / header->frame_bytes);
+}
+
+char* NetShmRing::frame(uint64_t index) const {
+	return frames + (size_t)(index % header->frame_count) * header->frame_bytes;
+}
+
+bool NetShmRing::fits(size_t bytes) const {
+	return framesFor(bytes) <= header->frame_count;
+}
+
+bool NetShmRing::tryWrite(uint32_t type, const void* data, size_t bytes) {
+	uint32_t needed = framesFor(bytes);
+	uint64_t head = header->head.load(std::memory_order_relaxed);
+	uint64_t tail = header->tail.load(std::memory_order_acquire);
+	uint32_t slot = (uint32_t)(head % header->frame_count);
+	// Messages are never split across the end, pad out to it instead. The padding goes out on its own, so the
+	// message only ever has to fit the frames from the start of the ring
+	if (slot + needed > header->frame_count) {
+		uint32_t padding = header->frame_count - slot;
+		if (padding > header->frame_count - (head - tail))
+			return false;
+		NetShmFrameHeader pad = {0, 0, padding, 0};
+		std::memcpy(frame(head), &pad, sizeof(pad));
+		head += padding;
+		header->head.store(head, std::memory_order_release);
+	}
+	if (needed > header->frame_count - (head - tail))
+		return false;
+
+	NetShmFrameHeader msg = {type, (uint32_t)bytes, needed, 0};
+	char* at = frame(head);
+	std::memcpy(at, &msg, sizeof(msg));
+	if (bytes > 0) std::memcpy(at + sizeof(msg), data, bytes);
+	header->head.store(head + needed, std::memory_order_release);
+	return true;
+}
+
+bool NetShmRing::peek(uint32_t& type, const char*& data, size_t& bytes) {
+	uint64_t tail = header->tail.load(std::memory_order_relaxed);
+	uint64_t head = header->head.load(std::memory_order_acquire);
+	while (tail != head) {
+		NetShmFrameHeader msg;
+		std::memcpy(&msg, frame(tail), sizeof(msg));
+		if (msg.type == 0) {
+			tail += msg.frames;
+			header->tail.store(tail, std::memory_order_release);
+			continue;
+		}
+		type = msg.type;
+		bytes = msg.bytes;
+		data = frame(tail) + sizeof(msg);
+		peeked_frames = msg.frames;
+		return true;
+	}
+	return false;
+}
+
+void NetShmRing::pop() {
+	uint64_t tail = header->tail.load(std::memory_order_relaxed);
+	header->tail.store(tail + peeked_frames, std::memory_order_release);
+	peeked_frames = 0;
+}
+
+const std::string& NetShmRing::getName() const {
+	return name;
+}
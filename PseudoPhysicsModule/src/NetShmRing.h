@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Aftr
+{
+	// Start of the shared segment. Producer and consumer each own one counter, so neither ever takes a lock
+	struct NetShmRingHeader {
+		uint32_t magic;
+		uint32_t frame_bytes;
+		uint32_t frame_count;
+		alignas(64) std::atomic<uint64_t> head; // Frames written, only the producer stores
+		alignas(64) std::atomic<uint64_t> tail; // Frames consumed, only the consumer stores
+	};
+
+	// Leads every message in the ring. A message spans as many consecutive frames as it needs
+	struct NetShmFrameHeader {
+		uint32_t type; // 0 marks padding up to the end of the ring
+		uint32_t bytes;
+		uint32_t frames;
+		uint32_t reserved;
+	};
+
+	// Single producer, single consumer ring of fixed size frames in a named shared memory segment.
+	// The viewer creates the segment and reads from it, the authority opens it and writes
+	class NetShmRing {
+		public:
+			// Create (or replace) a segment, nullptr if shared memory isn't available
+			static NetShmRing* create(const std::string& name, uint32_t frame_bytes, uint32_t frame_count);
+			// Open a segment another process created, nullptr if it doesn't exist
+			static NetShmRing* open(const std::string& name);
+			~NetShmRing();
+
+			// Producer. Copies the message in, false if there isn't room right now
+			bool tryWrite(uint32_t type, const void* data, size_t bytes);
+			// Producer. True if a message this size could ever fit
+			bool fits(size_t bytes) const;
+
+			// Consumer. Points at the next message in place, false if the ring is empty
+			bool peek(uint32_t& type, const char*& data, size_t& bytes);
+			// Consumer. Release the message returned by the last peek
+			void pop();
+
+			const std::string& getName() const;
+
+		protected:
+			NetShmRing() = default;
+			bool map(bool create, size_t size);
+			uint32_t framesFor(size_t bytes) const;
+			char* frame(uint64_t index) const;
+
+			std::string name;
+			bool owner = false; // The creator removes the segment when done
+			size_t size = 0;
+			void* handle = nullptr;
+			NetShmRingHeader* header = nullptr;
+			char* frames = nullptr;
+			uint32_t peeked_frames = 0;
+	};
+}
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cmath>
+#include "PosePredictor.h"
+#include "TerrainTiles.h"
+#include "AftrGlobals.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+
+namespace {
+	const float SUBSTEP_S = 1.0f / 120.0f;
+	const int MAX_SUBSTEPS = 8; // Past this a long frame just loses time instead of catching up
+	const float RESTITUTION = 0.2f; // Same as the authority's box material
+	const float FRICTION = 0.3f;
+	const float ROLLING_DAMPING = 4.0f; // Spin lost per second while touching the ground
+	const float SNAP_DISTANCE = 10.0f; // Corrections bigger than this are shown at once rather than blended
+
+	// Rotation matrix laid out like PoseRecord::rotation to a unit quaternion
+	void toQuaternion(const float* m, float& x, float& y, float& z, float& w) {
+		float trace = m[0] + m[4] + m[8];
+		if (trace > 0) {
+			float s = std::sqrt(trace + 1) * 2;
+			w = 0.25f * s; x = (m[7] - m[5]) / s; y = (m[2] - m[6]) / s; z = (m[3] - m[1]) / s;
+		}
+		else if (m[0] > m[4] && m[0] > m[8]) {
+			float s = std::sqrt(1 + m[0] - m[4] - m[8]) * 2;
+			w = (m[7] - m[5]) / s; x = 0.25f * s; y = (m[1] + m[3]) / s; z = (m[2] + m[6]) / s;
+		}
+		else if (m[4] > m[8]) {
+			float s = std::sqrt(1 + m[4] - m[0] - m[8]) * 2;
+			w = (m[2] - m[6]) / s; x = (m[1] + m[3]) / s; y = 0.25f * s; z = (m[5] + m[7]) / s;
+		}
+		else {
+			float s = std::sqrt(1 + m[8] - m[0] - m[4]) * 2;
+			w = (m[3] - m[1]) / s; x = (m[2] + m[6]) / s; y = (m[5] + m[7]) / s; z = 0.25f * s;
+		}
+	}
+
+	// out = a * b
+	void multiply(float ax, float ay, float az, float aw, float bx, float by, float bz, float bw, float& x, float& y, float& z, float& w) {
+		x = aw * bx + ax * bw + ay * bz - az * by;
+		y = aw * by - ax * bz + ay * bw + az * bx;
+		z = aw * bz + ax * by - ay * bx + az * bw;
+		w = aw * bw - ax * bx - ay * by - az * bz;
+	}
+
+	void normalize(float& x, float& y, float& z, float& w) {
+		float scale = 1 / std::sqrt(x * x + y * y + z * z + w * w);
+		x *= scale; y *= scale; z *= scale; w *= scale;
+	}
+}
+
+void PosePredictor::init(const TerrainTiles* terrain) {
+	this->terrain = terrain;
+	std::string smoothing = ManagerEnvironmentConfiguration::getVariableValue("ViewerPredictionSmoothingMs");
+	if (!smoothing.empty()) smoothing_ms = std::stof(smoothing);
+	std::string hold = ManagerEnvironmentConfiguration::getVariableValue("ViewerPredictionHoldMs");
+	if (!hold.empty()) hold_ms = std::stod(hold);
+}
+
+void PosePredictor::add(int id, const Vector& half_extents) {
+	if (id < 0) return;
+	if (id >= (int)shapes.size()) shapes.resize(id + 1, Vector(0, 0, 0));
+	shapes[id] = half_extents;
+}
+
+bool PosePredictor::correct(const PoseRecord& pose) {
+	if (pose.id < 0 || pose.id >= (int)shapes.size() || shapes[pose.id].x <= 0) return false;
+	if (pose.id >= (int)slots.size()) slots.resize(pose.id + 1, -1);
+	float x, y, z, w;
+	toQuaternion(pose.rotation, x, y, z, w);
+	normalize(x, y, z, w);
+
+	int slot = slots[pose.id];
+	if (slot < 0) {
+		slots[pose.id] = (int)ids.size();
+		ids.push_back(pose.id);
+		px.push_back(pose.location[0]); py.push_back(pose.location[1]); pz.push_back(pose.location[2]);
+		qx.push_back(x); qy.push_back(y); qz.push_back(z); qw.push_back(w);
+		vx.push_back(0); vy.push_back(0); vz.push_back(0);
+		wx.push_back(0); wy.push_back(0); wz.push_back(0);
+		const Vector& half = shapes[pose.id];
+		hx.push_back(half.x); hy.push_back(half.y); hz.push_back(half.z);
+		bx.push_back(half.x); by.push_back(half.y); bz.push_back(half.z);
+		ex.push_back(0); ey.push_back(0); ez.push_back(0);
+		rx.push_back(0); ry.push_back(0); rz.push_back(0); rw.push_back(1);
+		ax.push_back(pose.location[0]); ay.push_back(pose.location[1]); az.push_back(pose.location[2]);
+		aqx.push_back(x); aqy.push_back(y); aqz.push_back(z); aqw.push_back(w);
+		awake.push_back(1);
+		updated_ms.push_back(clock_ms);
+		return true;
+	}
+
+	// Pose currently drawn, which the correction has to start from
+	float shown_x = px[slot] + ex[slot], shown_y = py[slot] + ey[slot], shown_z = pz[slot] + ez[slot];
+	float sx, sy, sz, sw;
+	multiply(rx[slot], ry[slot], rz[slot], rw[slot], qx[slot], qy[slot], qz[slot], qw[slot], sx, sy, sz, sw);
+
+	// Velocities from the last two authoritative poses. Several poses in one frame keep the old estimate
+	float gap_s = (float)((clock_ms - updated_ms[slot]) / 1000);
+	if (clock_ms - updated_ms[slot] > hold_ms) {
+		vx[slot] = vy[slot] = vz[slot] = 0;
+		wx[slot] = wy[slot] = wz[slot] = 0;
+	}
+	else if (gap_s > 0.001f) {
+		vx[slot] = (pose.location[0] - ax[slot]) / gap_s;
+		vy[slot] = (pose.location[1] - ay[slot]) / gap_s;
+		// The difference is the average over the gap, gravity has kept pulling since its middle
+		vz[slot] = (pose.location[2] - az[slot]) / gap_s - GRAVITY * gap_s / 2;
+		float dx, dy, dz, dw;
+		multiply(x, y, z, w, -aqx[slot], -aqy[slot], -aqz[slot], aqw[slot], dx, dy, dz, dw);
+		if (dw < 0) {
+			dx = -dx; dy = -dy; dz = -dz; dw = -dw;
+		}
+		float sin_half = std::sqrt(dx * dx + dy * dy + dz * dz);
+		float rate = sin_half > 1e-6f ? 2 * std::atan2(sin_half, dw) / (sin_half * gap_s) : 2 / gap_s;
+		wx[slot] = dx * rate; wy[slot] = dy * rate; wz[slot] = dz * rate;
+	}
+
+	px[slot] = ax[slot] = pose.location[0];
+	py[slot] = ay[slot] = pose.location[1];
+	pz[slot] = az[slot] = pose.location[2];
+	qx[slot] = aqx[slot] = x; qy[slot] = aqy[slot] = y; qz[slot] = aqz[slot] = z; qw[slot] = aqw[slot] = w;
+	awake[slot] = 1;
+	updated_ms[slot] = clock_ms;
+
+	// Keep drawing the old pose for now, the difference is blended out in step
+	ex[slot] = shown_x - px[slot]; ey[slot] = shown_y - py[slot]; ez[slot] = shown_z - pz[slot];
+	if (ex[slot] * ex[slot] + ey[slot] * ey[slot] + ez[slot] * ez[slot] > SNAP_DISTANCE * SNAP_DISTANCE) {
+		ex[slot] = ey[slot] = ez[slot] = 0;
+		rx[slot] = ry[slot] = rz[slot] = 0; rw[slot] = 1;
+	}
+	else {
+		multiply(sx, sy, sz, sw, -x, -y, -z, w, rx[slot], ry[slot], rz[slot], rw[slot]);
+		normalize(rx[slot], ry[slot], rz[slot], rw[slot]);
+	}
+	return true;
+}
+
+void PosePredictor::remove(int id) {
+	if (id >= 0 && id < (int)shapes.size()) shapes[id] = Vector(0, 0, 0);
+	if (id < 0 || id >= (int)slots.size() || slots[id] < 0) return;
+	// Move the last object into the hole
+	size_t slot = slots[id], last = ids.size() - 1;
+	slots[ids[last]] = (int)slot;
+	slots[id] = -1;
+	for (std::vector<float>* component : { &px, &py, &pz, &qx, &qy, &qz, &qw, &vx, &vy, &vz, &wx, &wy, &wz, &hx, &hy, &hz,
+		&bx, &by, &bz, &ex, &ey, &ez, &rx, &ry, &rz, &rw, &ax, &ay, &az, &aqx, &aqy, &aqz, &aqw, &awake }) {
+		(*component)[slot] = (*component)[last];
+		component->pop_back();
+	}
+	ids[slot] = ids[last];
+	ids.pop_back();
+	updated_ms[slot] = updated_ms[last];
+	updated_ms.pop_back();
+}
+
+void PosePredictor::clear() {
+	for (int id : ids) slots[id] = -1;
+	for (std::vector<float>* component : { &px, &py, &pz, &qx, &qy, &qz, &qw, &vx, &vy, &vz, &wx, &wy, &wz, &hx, &hy, &hz,
+		&bx, &by, &bz, &ex, &ey, &ez, &rx, &ry, &rz, &rw, &ax, &ay, &az, &aqx, &aqy, &aqz, &aqw, &awake })
+		component->clear();
+	ids.clear();
+	updated_ms.clear();
+	shapes.clear();
+}
+
+void PosePredictor::step(double ms) {
+	clock_ms += ms;
+	// Anything the authority stopped updating has come to rest where it was last seen
+	for (size_t i = 0; i < ids.size(); i++) {
+		if (awake[i] > 0 && clock_ms - updated_ms[i] > hold_ms) {
+			awake[i] = 0;
+			vx[i] = vy[i] = vz[i] = 0;
+			wx[i] = wy[i] = wz[i] = 0;
+		}
+	}
+
+	accumulator_s += ms / 1000;
+	int substeps = 0;
+	while (accumulator_s >= SUBSTEP_S && substeps < MAX_SUBSTEPS) {
+		// Apart from the loop below so that one still vectorizes
+		ground.resize(ids.size());
+		for (size_t i = 0; i < ids.size(); i++)
+			ground[i] = terrain != nullptr ? terrain->getHeightAt(px[i], py[i]) : 0.0f;
+		integrate(SUBSTEP_S);
+		collideBoxes();
+		accumulator_s -= SUBSTEP_S;
+		substeps++;
+	}
+	if (substeps == MAX_SUBSTEPS) accumulator_s = 0;
+
+	// Blend corrections out
+	const size_t n = ids.size();
+	const float keep = smoothing_ms > 0 ? std::exp(-(float)ms / smoothing_ms) : 0.0f;
+	float* error_x = ex.data(); float* error_y = ey.data(); float* error_z = ez.data();
+	float* turn_x = rx.data(); float* turn_y = ry.data(); float* turn_z = rz.data(); float* turn_w = rw.data();
+	for (size_t i = 0; i < n; i++) {
+		error_x[i] *= keep; error_y[i] *= keep; error_z[i] *= keep;
+		// Rotations are blended toward identity along the short way and renormalized
+		float sign = turn_w[i] < 0 ? -keep : keep;
+		float x = turn_x[i] * sign, y = turn_y[i] * sign, z = turn_z[i] * sign, w = turn_w[i] * sign + (1 - keep);
+		float scale = 1 / std::sqrt(x * x + y * y + z * z + w * w);
+		turn_x[i] = x * scale; turn_y[i] = y * scale; turn_z[i] = z * scale; turn_w[i] = w * scale;
+	}
+}
+
+void PosePredictor::integrate(float dt) {
+	const size_t n = ids.size();
+	const float fall = GRAVITY * dt;
+	float* pos_x = px.data(); float* pos_y = py.data(); float* pos_z = pz.data();
+	float* rot_x = qx.data(); float* rot_y = qy.data(); float* rot_z = qz.data(); float* rot_w = qw.data();
+	float* vel_x = vx.data(); float* vel_y = vy.data(); float* vel_z = vz.data();
+	float* spin_x = wx.data(); float* spin_y = wy.data(); float* spin_z = wz.data();
+	const float* half_x = hx.data(); const float* half_y = hy.data(); const float* half_z = hz.data();
+	float* bound_x = bx.data(); float* bound_y = by.data(); float* bound_z = bz.data();
+	const float* moving = awake.data();
+	const float* ground_z = ground.data();
+
+	// Branch free so the compiler can run it several objects at a time
+	for (size_t i = 0; i < n; i++) {
+		vel_z[i] -= fall * moving[i];
+		pos_x[i] += vel_x[i] * dt; pos_y[i] += vel_y[i] * dt; pos_z[i] += vel_z[i] * dt;
+
+		float x = rot_x[i], y = rot_y[i], z = rot_z[i], w = rot_w[i];
+		float half_dt = 0.5f * dt;
+		x += half_dt * (spin_x[i] * w + spin_y[i] * z - spin_z[i] * y);
+		y += half_dt * (-spin_x[i] * z + spin_y[i] * w + spin_z[i] * x);
+		z += half_dt * (spin_x[i] * y - spin_y[i] * x + spin_z[i] * w);
+		w += half_dt * (-spin_x[i] * x - spin_y[i] * y - spin_z[i] * z);
+		float scale = 1 / std::sqrt(x * x + y * y + z * z + w * w);
+		x *= scale; y *= scale; z *= scale; w *= scale;
+		rot_x[i] = x; rot_y[i] = y; rot_z[i] = z; rot_w[i] = w;
+
+		// Half extents of the box's world aligned bounds
+		float r00 = 1 - 2 * (y * y + z * z), r01 = 2 * (x * y - w * z), r02 = 2 * (x * z + w * y);
+		float r10 = 2 * (x * y + w * z), r11 = 1 - 2 * (x * x + z * z), r12 = 2 * (y * z - w * x);
+		float r20 = 2 * (x * z - w * y), r21 = 2 * (y * z + w * x), r22 = 1 - 2 * (x * x + y * y);
+		bound_x[i] = std::fabs(r00) * half_x[i] + std::fabs(r01) * half_y[i] + std::fabs(r02) * half_z[i];
+		bound_y[i] = std::fabs(r10) * half_x[i] + std::fabs(r11) * half_y[i] + std::fabs(r12) * half_z[i];
+		bound_z[i] = std::fabs(r20) * half_x[i] + std::fabs(r21) * half_y[i] + std::fabs(r22) * half_z[i];
+
+		// Box against a flat ground at the terrain's height under its center: lift out, bounce, then slide and spin down
+		float depth = bound_z[i] + ground_z[i] - pos_z[i];
+		float contact = depth > 0 ? moving[i] : 0.0f;
+		pos_z[i] += depth * contact;
+		vel_z[i] = (contact > 0 && vel_z[i] < 0) ? -vel_z[i] * RESTITUTION : vel_z[i];
+		float speed = std::sqrt(vel_x[i] * vel_x[i] + vel_y[i] * vel_y[i]);
+		float slide = contact > 0 ? std::max(0.0f, 1 - FRICTION * fall / std::max(speed, 1e-4f)) : 1.0f;
+		vel_x[i] *= slide; vel_y[i] *= slide;
+		float roll = 1 - contact * std::min(ROLLING_DAMPING * dt, 1.0f);
+		spin_x[i] *= roll; spin_y[i] *= roll; spin_z[i] *= roll;
+	}
+}
+
+void PosePredictor::collideBoxes() {
+	// Sweep along x so only boxes whose bounds overlap there are compared
+	const size_t n = ids.size();
+	order.resize(n);
+	for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return px[a] - bx[a] < px[b] - bx[b]; });
+
+	std::vector<float>* position[3] = { &px, &py, &pz };
+	std::vector<float>* velocity[3] = { &vx, &vy, &vz };
+	for (size_t i = 0; i < n; i++) {
+		uint32_t a = order[i];
+		float a_high = px[a] + bx[a];
+		for (size_t j = i + 1; j < n; j++) {
+			uint32_t b = order[j];
+			if (px[b] - bx[b] > a_high) break;
+			// Objects at rest only push back
+			float total = awake[a] + awake[b];
+			if (total == 0) continue;
+			float offset[3] = { px[a] - px[b], py[a] - py[b], pz[a] - pz[b] };
+			float overlap[3] = { bx[a] + bx[b] - std::fabs(offset[0]), by[a] + by[b] - std::fabs(offset[1]), bz[a] + bz[b] - std::fabs(offset[2]) };
+			if (overlap[0] <= 0 || overlap[1] <= 0 || overlap[2] <= 0) continue;
+
+			// Separate along the axis they overlap least on, like two equal boxes bumping
+			int axis = overlap[0] < overlap[1] ? (overlap[0] < overlap[2] ? 0 : 2) : (overlap[1] < overlap[2] ? 1 : 2);
+			float sign = offset[axis] < 0 ? -1.0f : 1.0f;
+			float share_a = awake[a] / total, share_b = awake[b] / total;
+			(*position[axis])[a] += sign * overlap[axis] * share_a;
+			(*position[axis])[b] -= sign * overlap[axis] * share_b;
+			float closing = ((*velocity[axis])[a] - (*velocity[axis])[b]) * sign;
+			if (closing < 0) {
+				float impulse = -(1 + RESTITUTION) * closing;
+				(*velocity[axis])[a] += sign * impulse * share_a;
+				(*velocity[axis])[b] -= sign * impulse * share_b;
+			}
+		}
+	}
+}
+
+PoseRecord PosePredictor::getPose(size_t slot) const {
+	PoseRecord pose;
+	pose.id = ids[slot];
+	pose.location[0] = px[slot] + ex[slot];
+	pose.location[1] = py[slot] + ey[slot];
+	pose.location[2] = pz[slot] + ez[slot];
+	float x, y, z, w;
+	multiply(rx[slot], ry[slot], rz[slot], rw[slot], qx[slot], qy[slot], qz[slot], qw[slot], x, y, z, w);
+	normalize(x, y, z, w);
+	pose.rotation[0] = 1 - 2 * (y * y + z * z); pose.rotation[1] = 2 * (x * y - w * z); pose.rotation[2] = 2 * (x * z + w * y);
+	pose.rotation[3] = 2 * (x * y + w * z); pose.rotation[4] = 1 - 2 * (x * x + z * z); pose.rotation[5] = 2 * (y * z - w * x);
+	pose.rotation[6] = 2 * (x * z - w * y); pose.rotation[7] = 2 * (y * z + w * x); pose.rotation[8] = 1 - 2 * (x * x + y * y);
+	return pose;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "NetMsgObjectOrientationBatch.h"
+#include "Vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+	class TerrainTiles;
+
+	// Moves replicated boxes locally between authority updates, so they keep falling, landing and pushing each
+	// other at the render rate however rarely poses arrive. Every authoritative pose resets the object to it and the
+	// jump is blended out of what is drawn over a short time. State is kept as one array per component so the
+	// integration loops vectorize
+	class PosePredictor {
+		public:
+			// Reads ViewerPredictionSmoothingMs and ViewerPredictionHoldMs from aftr.conf. Objects land on the
+			// terrain, which is flat at z = 0 until it loads
+			void init(const TerrainTiles* terrain);
+
+			// Predict this object as a box with these half extents. Anything never added is left to the caller
+			void add(int id, const Vector& half_extents);
+			// Newest authoritative pose of an object, starts tracking it if it's new. False if it wasn't added
+			bool correct(const PoseRecord& pose);
+			// Stops predicting the object until it's added again
+			void remove(int id);
+			void clear();
+			// Advance every tracked object by the time since the last frame
+			void step(double ms);
+
+			size_t size() const { return ids.size(); }
+			int getId(size_t slot) const { return ids[slot]; }
+			// Where the object in this slot should be drawn right now
+			PoseRecord getPose(size_t slot) const;
+
+		protected:
+			float smoothing_ms = 100; // Time for a correction to be mostly blended out
+			double hold_ms = 1000; // An object the authority hasn't updated for this long is left where it is
+			double clock_ms = 0;
+			double accumulator_s = 0;
+			const TerrainTiles* terrain = nullptr;
+
+			std::vector<Vector> shapes; // Half extents by object id, zero if it isn't predicted
+			std::vector<int> slots; // Slot of every object id, -1 if untracked
+			std::vector<int> ids;
+			std::vector<float> px, py, pz; // Position
+			std::vector<float> qx, qy, qz, qw; // Orientation
+			std::vector<float> vx, vy, vz; // Linear velocity
+			std::vector<float> wx, wy, wz; // Angular velocity
+			std::vector<float> hx, hy, hz; // Box half extents
+			std::vector<float> bx, by, bz; // World space half extents of the box's bounds, refreshed every substep
+			std::vector<float> ground; // Terrain height under each slot, sampled every substep
+			std::vector<float> ex, ey, ez; // Position still to blend out, drawn = predicted + error
+			std::vector<float> rx, ry, rz, rw; // Rotation still to blend out, drawn = error * predicted
+			std::vector<float> ax, ay, az, aqx, aqy, aqz, aqw; // Last authoritative pose, velocities are estimated from the next one
+			std::vector<float> awake; // 1 while the authority is still updating the object, 0 once it's left alone
+			std::vector<double> updated_ms; // Clock when the last authoritative pose arrived
+			std::vector<uint32_t> order; // Slots sorted by the low x of their bounds, for box contacts
+
+			void integrate(float dt);
+			void collideBoxes();
+	};
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include "TerrainTiles.h"
+#include "WO.h"
+#include "WorldContainer.h"
+#include "MGLIndexedGeometry.h"
+#include "IndexedGeometryTriangles.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+using namespace Aftr;
+
+namespace {
+	// Next whitespace separated token of a pgm header, skipping comments
+	std::string pgmToken(std::istream& in) {
+		std::string token;
+		char c;
+		while (in.get(c)) {
+			if (c == '#') {
+				while (in.get(c) && c != '\n') {}
+				continue;
+			}
+			if (std::isspace((unsigned char)c)) {
+				if (!token.empty()) break;
+				continue;
+			}
+			token += c;
+		}
+		return token;
+	}
+}
+
+bool TerrainTiles::load(const std::string& path, float spacing, float max_height) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "Unable to open terrain " << path << std::endl;
+		return false;
+	}
+	this->spacing = spacing;
+	this->max_height = max_height;
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	std::vector<float> samples; // 0 to 1
+	if (extension == "pgm") {
+		if (pgmToken(file) != "P5") {
+			std::cout << "Terrain " << path << " is not a binary pgm" << std::endl;
+			return false;
+		}
+		cols = std::stoul(pgmToken(file));
+		rows = std::stoul(pgmToken(file));
+		unsigned int maxval = std::stoul(pgmToken(file));
+		// pgm stores 16 bit samples big endian
+		size_t sample_bytes = maxval < 256 ? 1 : 2;
+		std::vector<unsigned char> data((size_t)rows * cols * sample_bytes);
+		if (!file.read((char*)data.data(), data.size())) return false;
+		samples.resize((size_t)rows * cols);
+		for (size_t i = 0; i < samples.size(); i++) {
+			unsigned int value = sample_bytes == 1 ? data[i] : (data[2 * i] << 8) | data[2 * i + 1];
+			samples[i] = value / (float)maxval;
+		}
+	}
+	else {
+		std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		size_t count = data.size() / 2;
+		rows = cols = (unsigned int)std::lround(std::sqrt((double)count));
+		if ((size_t)rows * cols != count) {
+			std::cout << "Terrain " << path << " is not a square 16 bit raw file" << std::endl;
+			return false;
+		}
+		samples.resize(count);
+		for (size_t i = 0; i < count; i++)
+			samples[i] = (data[2 * i] | (data[2 * i + 1] << 8)) / 65535.0f;
+	}
+	if (rows < 2 || cols < 2) return false;
+
+	heights.resize(samples.size());
+	for (size_t i = 0; i < samples.size(); i++)
+		heights[i] = samples[i] * max_height;
+	origin = Vector(-(rows - 1) * spacing / 2, (cols - 1) * spacing / 2, 0);
+	return true;
+}
+
+bool TerrainTiles::loadConfigured(WorldContainer* world) {
+	std::string file = ManagerEnvironmentConfiguration::getVariableValue("TerrainFile");
+	if (file.empty()) return false;
+	float spacing = 2, max_height = 40;
+	unsigned int tile_quads = 32;
+	std::string value = ManagerEnvironmentConfiguration::getVariableValue("TerrainSpacing");
+	if (!value.empty()) spacing = std::stof(value);
+	value = ManagerEnvironmentConfiguration::getVariableValue("TerrainHeight");
+	if (!value.empty()) max_height = std::stof(value);
+	value = ManagerEnvironmentConfiguration::getVariableValue("TerrainTileQuads");
+	if (!value.empty()) tile_quads = std::stoul(value);
+	if (!load(ManagerEnvironmentConfiguration::getLMM() + "/" + file, spacing, max_height))
+		return false;
+	createTiles(world, tile_quads);
+	return true;
+}
+
+Vector TerrainTiles::toWorld(unsigned int row, unsigned int col) const {
+	return Vector(origin.x + row * spacing, origin.y - col * spacing, getHeight(row, col));
+}
+
+float TerrainTiles::getHeightAt(float x, float y) const {
+	if (rows < 2 || cols < 2) return 0;
+	// Past the edges the outermost samples carry on
+	float row = std::max(0.0f, std::min((x - origin.x) / spacing, (float)(rows - 1)));
+	float col = std::max(0.0f, std::min((origin.y - y) / spacing, (float)(cols - 1)));
+	unsigned int row_low = std::min((unsigned int)row, rows - 2), col_low = std::min((unsigned int)col, cols - 2);
+	float s = row - row_low, t = col - col_low;
+	float low = getHeight(row_low, col_low) * (1 - t) + getHeight(row_low, col_low + 1) * t;
+	float high = getHeight(row_low + 1, col_low) * (1 - t) + getHeight(row_low + 1, col_low + 1) * t;
+	return low * (1 - s) + high * s;
+}
+
+void TerrainTiles::createTiles(WorldContainer* world, unsigned int tile_quads) {
+	this->tile_quads = std::max(1u, tile_quads);
+	tile_rows = (rows - 2) / this->tile_quads + 1;
+	tile_cols = (cols - 2) / this->tile_quads + 1;
+	dirty.assign((size_t)tile_rows * tile_cols, 0);
+	for (unsigned int tile_row = 0; tile_row < tile_rows; tile_row++) {
+		for (unsigned int tile_col = 0; tile_col < tile_cols; tile_col++) {
+			WO* wo = WO::New();
+			wo->setModel(MGLIndexedGeometry::New(wo));
+			wo->setLabel("Terrain");
+			world->push_back(wo);
+			tiles.push_back(wo);
+			buildTile(tile_row, tile_col);
+		}
+	}
+}
+
+void TerrainTiles::buildTile(unsigned int tile_row, unsigned int tile_col) {
+	unsigned int row_first = tile_row * tile_quads, row_last = std::min(row_first + tile_quads, rows - 1);
+	unsigned int col_first = tile_col * tile_quads, col_last = std::min(col_first + tile_quads, cols - 1);
+	unsigned int width = col_last - col_first + 1;
+
+	// Grass green on the low ground fading to dirt up high, craters dig down to dark earth
+	std::vector<Vector> vertices;
+	std::vector<aftrColor4ub> colors;
+	for (unsigned int row = row_first; row <= row_last; row++) {
+		for (unsigned int col = col_first; col <= col_last; col++) {
+			vertices.push_back(toWorld(row, col));
+			float t = std::max(-1.0f, std::min(1.0f, getHeight(row, col) / max_height));
+			if (t >= 0)
+				colors.push_back(aftrColor4ub((unsigned char)(60 + 70 * t), (unsigned char)(140 - 40 * t), (unsigned char)(50 + 10 * t), 255));
+			else
+				colors.push_back(aftrColor4ub((unsigned char)(60 + 10 * t), (unsigned char)(140 + 100 * t), (unsigned char)(50 - 20 * t), 255));
+		}
+	}
+	// Two triangles a quad, wound counter clockwise seen from above
+	std::vector<unsigned int> indices;
+	for (unsigned int row = 0; row < row_last - row_first; row++) {
+		for (unsigned int col = 0; col < width - 1; col++) {
+			unsigned int a = row * width + col, b = a + width, d = a + 1, e = b + 1;
+			indices.insert(indices.end(), { a, d, b, b, d, e });
+		}
+	}
+	WO* wo = tiles[(size_t)tile_row * tile_cols + tile_col];
+	static_cast<MGLIndexedGeometry*>(wo->getModel())->setIndexedGeometry(IndexedGeometryTriangles::New(vertices, indices, colors));
+	dirty[(size_t)tile_row * tile_cols + tile_col] = 0;
+}
+
+TerrainRegion TerrainTiles::crater(float x, float y, float radius, float depth) {
+	TerrainRegion region;
+	if (heights.empty() || radius <= 0) return region;
+	int row_low = (int)std::floor((x - radius - origin.x) / spacing), row_high = (int)std::ceil((x + radius - origin.x) / spacing);
+	int col_low = (int)std::floor((origin.y - y - radius) / spacing), col_high = (int)std::ceil((origin.y - y + radius) / spacing);
+	row_low = std::max(row_low, 0);
+	col_low = std::max(col_low, 0);
+	row_high = std::min(row_high, (int)rows - 1);
+	col_high = std::min(col_high, (int)cols - 1);
+	if (row_low > row_high || col_low > col_high) return region;
+
+	// A bowl, deepest in the middle. Never deeper than the heights can be stored
+	for (int row = row_low; row <= row_high; row++) {
+		for (int col = col_low; col <= col_high; col++) {
+			Vector p = toWorld(row, col);
+			float d2 = ((p.x - x) * (p.x - x) + (p.y - y) * (p.y - y)) / (radius * radius);
+			if (d2 >= 1) continue;
+			float& height = heights[(size_t)row * cols + col];
+			height = std::max(-max_height, height - depth * (1 - d2));
+		}
+	}
+	region.row = row_low;
+	region.col = col_low;
+	region.rows = row_high - row_low + 1;
+	region.cols = col_high - col_low + 1;
+
+	// Samples on a tile edge belong to the tiles on both sides
+	if (!dirty.empty()) {
+		unsigned int tile_row_low = row_low == 0 ? 0 : (row_low - 1) / tile_quads, tile_row_high = std::min((unsigned int)row_high / tile_quads, tile_rows - 1);
+		unsigned int tile_col_low = col_low == 0 ? 0 : (col_low - 1) / tile_quads, tile_col_high = std::min((unsigned int)col_high / tile_quads, tile_cols - 1);
+		for (unsigned int tile_row = tile_row_low; tile_row <= tile_row_high; tile_row++)
+			for (unsigned int tile_col = tile_col_low; tile_col <= tile_col_high; tile_col++)
+				dirty[(size_t)tile_row * tile_cols + tile_col] = 1;
+	}
+	return region;
+}
+
+size_t TerrainTiles::uploadDirty() {
+	size_t uploaded = 0;
+	for (unsigned int tile_row = 0; tile_row < tile_rows; tile_row++) {
+		for (unsigned int tile_col = 0; tile_col < tile_cols; tile_col++) {
+			if (!dirty[(size_t)tile_row * tile_cols + tile_col]) continue;
+			buildTile(tile_row, tile_col);
+			uploaded++;
+		}
+	}
+	return uploaded;
+}
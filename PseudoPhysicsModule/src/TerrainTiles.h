@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Vector.h"
+
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+	class WO;
+	class WorldContainer;
+
+	// A rectangle of samples, rows and cols long
+	struct TerrainRegion {
+		unsigned int row = 0;
+		unsigned int col = 0;
+		unsigned int rows = 0;
+		unsigned int cols = 0;
+	};
+
+	// A regular grid of heights drawn as square tiles, one WO each. Deforming it only rebuilds the tiles it touched.
+	// Rows run along +x and columns along -y, the way a PhysX heightfield lies once it is turned to z up
+	class TerrainTiles {
+		public:
+			// Loads a square 16 bit little endian .raw/.r16 file, or a binary 8 or 16 bit .pgm image. Samples are
+			// spacing apart and their heights go from 0 to max_height, centered on the origin
+			bool load(const std::string& path, float spacing, float max_height);
+			// Loads TerrainFile from under the module's mm directory with TerrainSpacing, TerrainHeight and
+			// TerrainTileQuads from aftr.conf, and creates its tiles. False if none is configured or it didn't load
+			bool loadConfigured(WorldContainer* world);
+			// Creates a WO for every tile of tile_quads by tile_quads quads and adds them to the world
+			void createTiles(WorldContainer* world, unsigned int tile_quads);
+			// Lowers a bowl of this radius and depth into the ground around a world point. Returns the samples that changed
+			TerrainRegion crater(float x, float y, float radius, float depth);
+			// Rebuilds the geometry of every tile touched since the last upload, returns how many
+			size_t uploadDirty();
+
+			unsigned int getRows() const { return rows; }
+			unsigned int getCols() const { return cols; }
+			float getSpacing() const { return spacing; }
+			float getMaxHeight() const { return max_height; }
+			float getHeight(unsigned int row, unsigned int col) const { return heights[row * cols + col]; }
+			// World position of sample (0, 0)
+			Vector getOrigin() const { return origin; }
+			Vector toWorld(unsigned int row, unsigned int col) const;
+			// Height of the ground under a world point, blended between the four samples around it. 0 before a load
+			float getHeightAt(float x, float y) const;
+
+		protected:
+			unsigned int rows = 0;
+			unsigned int cols = 0;
+			float spacing = 1;
+			float max_height = 1;
+			Vector origin;
+			std::vector<float> heights; // Row major
+			unsigned int tile_quads = 32;
+			unsigned int tile_rows = 0; // Tiles along the rows
+			unsigned int tile_cols = 0;
+			std::vector<WO*> tiles;
+			std::vector<unsigned char> dirty; // Per tile
+
+			void buildTile(unsigned int tile_row, unsigned int tile_col);
+	};
+}
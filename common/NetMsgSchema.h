@@ -0,0 +1,270 @@
+#pragma once
+
+#include "NetMsg.h"
+#include "Vector.h"
+#include "Mat4.h"
+#include "NetTelemetry.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef AFTR_CONFIG_USE_BOOST
+
+// Messages describe their payload once with a NetSchema specialization and the
+// serializers are generated from it. The whole payload is packed into one byte
+// buffer that is streamed as a single string, so trivially copyable fields are
+// plain memcpys instead of one operator<< per float.
+//
+//    template<> struct NetSchema<NetMsgMoveSphere> {
+//       static constexpr const char* name = "NetMsgMoveSphere";
+//       static constexpr auto fields() { return std::make_tuple(NET_FIELD(NetMsgMoveSphere, location)); }
+//    };
+
+namespace Aftr {
+	// Appends raw bytes to a payload
+	class NetByteWriter {
+	public:
+		NetByteWriter(std::string& out) : out(out) {}
+		void writeBytes(const void* data, size_t size) {
+			size_t at = out.size();
+			out.resize(at + size);
+			if (size > 0) std::memcpy(&out[at], data, size);
+		}
+		std::string& out;
+	};
+
+	// Reads raw bytes back out of a payload, ok turns false on a short payload
+	class NetByteReader {
+	public:
+		NetByteReader(const std::string& in) : in(in.data()), size(in.size()) {}
+		NetByteReader(const char* in, size_t size) : in(in), size(size) {}
+		bool readBytes(void* data, size_t count) {
+			if (!ok || pos + count > size) return ok = false;
+			if (count > 0) std::memcpy(data, in + pos, count);
+			pos += count;
+			return true;
+		}
+		// Points at the next count bytes without copying them, nullptr on a short payload
+		const char* view(size_t count) {
+			if (!ok || pos + count > size) { ok = false; return nullptr; }
+			const char* at = in + pos;
+			pos += count;
+			return at;
+		}
+		const char* in;
+		size_t size;
+		size_t pos = 0;
+		bool ok = true;
+	};
+
+	// Kind and size of a plain field's elements, so a float and an int32 of the same size hash differently
+	template<class V>
+	constexpr uint32_t netTypeTag() {
+		using E = typename std::remove_all_extents<V>::type;
+		uint32_t kind = std::is_floating_point<E>::value ? 1 : std::is_same<E, bool>::value ? 2
+			: std::is_integral<E>::value ? (std::is_signed<E>::value ? 3 : 4) : std::is_enum<E>::value ? 5 : 6;
+		return (kind << 24) | (uint32_t)sizeof(E);
+	}
+
+	// How one field type is packed. Anything trivially copyable is a single block
+	template<class V>
+	struct NetFieldCodec {
+		static_assert(std::is_trivially_copyable<V>::value, "Add a NetFieldCodec specialization for this field type");
+		static constexpr size_t fixed_size = sizeof(V);
+		static constexpr uint32_t type_tag = netTypeTag<V>();
+		static void write(NetByteWriter& w, const V& v) { w.writeBytes(&v, sizeof(V)); }
+		static bool read(NetByteReader& r, V& v) { return r.readBytes(&v, sizeof(V)); }
+	};
+
+	template<>
+	struct NetFieldCodec<Vector> {
+		static constexpr size_t fixed_size = 3 * sizeof(float);
+		static constexpr uint32_t type_tag = 0x10000000u;
+		static void write(NetByteWriter& w, const Vector& v) {
+			float xyz[3] = {v.x, v.y, v.z};
+			w.writeBytes(xyz, sizeof(xyz));
+		}
+		static bool read(NetByteReader& r, Vector& v) {
+			float xyz[3];
+			if (!r.readBytes(xyz, sizeof(xyz))) return false;
+			v = Vector(xyz[0], xyz[1], xyz[2]);
+			return true;
+		}
+	};
+
+	template<>
+	struct NetFieldCodec<Mat4> {
+		static constexpr size_t fixed_size = 16 * sizeof(float);
+		static constexpr uint32_t type_tag = 0x11000000u;
+		static void write(NetByteWriter& w, const Mat4& m) {
+			float values[16];
+			for (int i = 0; i < 16; i++) values[i] = m[i];
+			w.writeBytes(values, sizeof(values));
+		}
+		static bool read(NetByteReader& r, Mat4& m) {
+			float values[16];
+			if (!r.readBytes(values, sizeof(values))) return false;
+			m = Mat4(values);
+			return true;
+		}
+	};
+
+	template<>
+	struct NetFieldCodec<std::string> {
+		static constexpr size_t fixed_size = sizeof(uint32_t);
+		static constexpr uint32_t type_tag = 0x12000000u;
+		static void write(NetByteWriter& w, const std::string& s) {
+			uint32_t size = (uint32_t)s.size();
+			w.writeBytes(&size, sizeof(size));
+			w.writeBytes(s.data(), s.size());
+		}
+		static bool read(NetByteReader& r, std::string& s) {
+			uint32_t size = 0;
+			if (!r.readBytes(&size, sizeof(size))) return false;
+			const char* at = r.view(size);
+			if (at == nullptr) return false;
+			s.assign(at, size);
+			return true;
+		}
+	};
+
+	template<class E>
+	struct NetFieldCodec<std::vector<E>> {
+		static constexpr size_t fixed_size = sizeof(uint32_t);
+		static constexpr uint32_t type_tag = 0x13000000u ^ NetFieldCodec<E>::type_tag; // The element type counts too
+		static void write(NetByteWriter& w, const std::vector<E>& items) {
+			uint32_t count = (uint32_t)items.size();
+			w.writeBytes(&count, sizeof(count));
+			if constexpr (std::is_trivially_copyable<E>::value)
+				w.writeBytes(items.data(), items.size() * sizeof(E));
+			else
+				for (const E& item : items) NetFieldCodec<E>::write(w, item);
+		}
+		static bool read(NetByteReader& r, std::vector<E>& items) {
+			uint32_t count = 0;
+			if (!r.readBytes(&count, sizeof(count))) return false;
+			if constexpr (std::is_trivially_copyable<E>::value) {
+				if (r.pos + (size_t)count * sizeof(E) > r.size) return r.ok = false;
+				items.resize(count);
+				return r.readBytes(items.data(), items.size() * sizeof(E));
+			}
+			else {
+				items.clear();
+				for (uint32_t i = 0; i < count && r.ok; i++) {
+					items.emplace_back();
+					NetFieldCodec<E>::read(r, items.back());
+				}
+				return r.ok;
+			}
+		}
+	};
+
+	// One described member of a message
+	template<class Msg, class V>
+	struct NetField {
+		const char* name;
+		V Msg::* member;
+	};
+
+#define NET_FIELD(Msg, member) Aftr::NetField<Msg, decltype(Msg::member)>{ #member, &Msg::member }
+
+	// Specialize with a name and a fields() tuple for every message
+	template<class Msg>
+	struct NetSchema;
+
+	// FNV-1a, usable at compile time
+	constexpr uint32_t netHashString(uint32_t hash, const char* s) {
+		while (*s != '\0') {
+			hash ^= (uint8_t)*s++;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	constexpr uint32_t netHashValue(uint32_t hash, uint32_t value) {
+		for (int i = 0; i < 4; i++) {
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Generated serializers for a message with a NetSchema
+	template<class Msg>
+	class NetSchemaCodec {
+	public:
+		static std::string encode(const Msg& msg) {
+			std::string out;
+			out.reserve(fixedSize());
+			NetByteWriter w(out);
+			std::apply([&](const auto&... field) { (writeField(w, msg, field), ...); }, NetSchema<Msg>::fields());
+			return out;
+		}
+
+		static bool decode(Msg& msg, const std::string& in) {
+			return decode(msg, in.data(), in.size());
+		}
+
+		static bool decode(Msg& msg, const char* in, size_t size) {
+			NetByteReader r(in, size);
+			std::apply([&](const auto&... field) { (readField(r, msg, field), ...); }, NetSchema<Msg>::fields());
+			return r.ok && r.pos == size;
+		}
+
+		static bool toStream(const Msg& msg, NetMessengerStreamBuffer& os) {
+			std::string out = encode(msg);
+			NetTelemetry::countSent(NetSchema<Msg>::name, out.size());
+			os << out;
+			return true;
+		}
+
+		static bool fromStream(Msg& msg, NetMessengerStreamBuffer& is) {
+			std::string in;
+			is >> in;
+			NetTelemetry::countReceived(NetSchema<Msg>::name, in.size());
+			return decode(msg, in);
+		}
+
+		// Bytes every instance needs before any variable length data
+		static constexpr size_t fixedSize() {
+			return std::apply([](const auto&... field) { return (size_t(0) + ... + fieldSize(field)); }, NetSchema<Msg>::fields());
+		}
+
+		// Changes whenever a field is renamed, retyped, resized, added or reordered
+		static constexpr uint32_t hash() {
+			return std::apply([](const auto&... field) {
+				uint32_t h = netHashString(2166136261u, NetSchema<Msg>::name);
+				((h = netHashValue(netHashValue(netHashString(h, field.name), (uint32_t)fieldSize(field)), fieldTag(field))), ...);
+				return h;
+			}, NetSchema<Msg>::fields());
+		}
+
+	protected:
+		template<class V>
+		static void writeField(NetByteWriter& w, const Msg& msg, const NetField<Msg, V>& field) {
+			NetFieldCodec<V>::write(w, msg.*(field.member));
+		}
+
+		template<class V>
+		static void readField(NetByteReader& r, Msg& msg, const NetField<Msg, V>& field) {
+			if (r.ok) NetFieldCodec<V>::read(r, msg.*(field.member));
+		}
+
+		template<class V>
+		static constexpr size_t fieldSize(const NetField<Msg, V>&) {
+			return NetFieldCodec<V>::fixed_size;
+		}
+
+		template<class V>
+		static constexpr uint32_t fieldTag(const NetField<Msg, V>&) {
+			return NetFieldCodec<V>::type_tag;
+		}
+	};
+}
+
+#endif